@@ -169,6 +169,117 @@ namespace fs
 		// Do notning
 	}
 
+	u64 file_base::read_at(u64 offset, void* buffer, u64 size)
+	{
+		return -1;
+	}
+
+	const void* file_base::get_mapped_data()
+	{
+		return nullptr;
+	}
+
+	// Read-only memory-mapped file (common part)
+	class mapped_file_base : public file_base
+	{
+	protected:
+		const u8* const m_ptr;
+		const u64 m_size;
+		u64 m_pos = 0;
+
+		// Range already requested from the OS
+		u64 m_prefetch_begin = 0;
+		u64 m_prefetch_end = 0;
+
+		// Prefetch granularity (large page size)
+		static constexpr u64 s_prefetch_size = 0x200000;
+
+		// Ask the OS to page in the specified range (platform-specific, may do nothing)
+		virtual void prefetch(const u8* ptr, u64 size) = 0;
+
+	public:
+		mapped_file_base(const void* ptr, u64 size)
+			: m_ptr(static_cast<const u8*>(ptr))
+			, m_size(size)
+		{
+		}
+
+		bool trunc(u64 length) override
+		{
+			g_tls_error = error::acces;
+			return false;
+		}
+
+		u64 read(void* buffer, u64 count) override
+		{
+			if (m_pos >= m_size)
+			{
+				return 0;
+			}
+
+			const u64 result = std::min<u64>(count, m_size - m_pos);
+
+			// Keep the current and the next large page worth of data requested ahead of the reader
+			if (m_pos < m_prefetch_begin || m_pos + result > m_prefetch_end)
+			{
+				m_prefetch_begin = m_pos & ~(s_prefetch_size - 1);
+				m_prefetch_end = std::min<u64>(((m_pos + result + s_prefetch_size - 1) & ~(s_prefetch_size - 1)) + s_prefetch_size, m_size);
+				prefetch(m_ptr + m_prefetch_begin, m_prefetch_end - m_prefetch_begin);
+			}
+
+			std::memcpy(buffer, m_ptr + m_pos, result);
+			m_pos += result;
+			return result;
+		}
+
+		u64 read_at(u64 offset, void* buffer, u64 count) override
+		{
+			if (offset >= m_size)
+			{
+				return 0;
+			}
+
+			// Doesn't touch the prefetch window (may be called concurrently)
+			const u64 result = std::min<u64>(count, m_size - offset);
+			std::memcpy(buffer, m_ptr + offset, result);
+			return result;
+		}
+
+		u64 write(const void* buffer, u64 count) override
+		{
+			g_tls_error = error::acces;
+			return 0;
+		}
+
+		u64 seek(s64 offset, seek_mode whence) override
+		{
+			const s64 new_pos =
+				whence == seek_set ? offset :
+				whence == seek_cur ? offset + m_pos :
+				whence == seek_end ? offset + m_size :
+				(fmt::raw_error("fs::mapped_file::seek(): invalid whence"), 0);
+
+			if (new_pos < 0)
+			{
+				g_tls_error = error::inval;
+				return -1;
+			}
+
+			m_pos = new_pos;
+			return m_pos;
+		}
+
+		u64 size() override
+		{
+			return m_size;
+		}
+
+		const void* get_mapped_data() override
+		{
+			return m_ptr;
+		}
+	};
+
 	dir_base::~dir_base()
 	{
 	}
@@ -881,6 +992,68 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 		}
 	};
 
+	if (test(mode & fs::mmap) && !test(mode & fs::write))
+	{
+		class windows_mapped_file final : public mapped_file_base
+		{
+			const HANDLE m_handle;
+			const HANDLE m_mapping;
+
+			void prefetch(const u8* ptr, u64 size) override
+			{
+				// PrefetchVirtualMemory is not available on Windows 7
+			}
+
+		public:
+			windows_mapped_file(HANDLE handle, HANDLE mapping, const void* ptr, u64 size)
+				: mapped_file_base(ptr, size)
+				, m_handle(handle)
+				, m_mapping(mapping)
+			{
+			}
+
+			~windows_mapped_file() override
+			{
+				UnmapViewOfFile(m_ptr);
+				CloseHandle(m_mapping);
+				CloseHandle(m_handle);
+			}
+
+			stat_t stat() override
+			{
+				FILE_BASIC_INFO basic_info;
+				verify("file::stat" HERE), GetFileInformationByHandleEx(m_handle, FileBasicInfo, &basic_info, sizeof(FILE_BASIC_INFO));
+
+				stat_t info;
+				info.is_directory = false;
+				info.is_writable = false;
+				info.size = m_size;
+				info.atime = to_time(basic_info.LastAccessTime);
+				info.mtime = to_time(basic_info.ChangeTime);
+				info.ctime = to_time(basic_info.CreationTime);
+
+				return info;
+			}
+		};
+
+		// Empty files can't be mapped, fallback to the regular file in this case
+		LARGE_INTEGER size;
+
+		if (GetFileSizeEx(handle, &size) && size.QuadPart > 0)
+		{
+			if (const HANDLE mapping = CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL))
+			{
+				if (const void* ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))
+				{
+					m_file = std::make_unique<windows_mapped_file>(handle, mapping, ptr, size.QuadPart);
+					return;
+				}
+
+				CloseHandle(mapping);
+			}
+		}
+	}
+
 	m_file = std::make_unique<windows_file>(handle);
 #else
 	int flags = 0;
@@ -957,6 +1130,14 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 			return result;
 		}
 
+		u64 read_at(u64 offset, void* buffer, u64 count) override
+		{
+			const auto result = ::pread(m_fd, buffer, count, offset);
+			verify("file::read_at" HERE), result != -1;
+
+			return result;
+		}
+
 		u64 write(const void* buffer, u64 count) override
 		{
 			const auto result = ::write(m_fd, buffer, count);
@@ -993,6 +1174,62 @@ fs::file::file(const std::string& path, bs_t<open_mode> mode)
 		}
 	};
 
+	if (test(mode & fs::mmap) && !test(mode & fs::write))
+	{
+		class unix_mapped_file final : public mapped_file_base
+		{
+			const int m_fd;
+
+			void prefetch(const u8* ptr, u64 size) override
+			{
+				::madvise(const_cast<u8*>(ptr), size, MADV_WILLNEED);
+			}
+
+		public:
+			unix_mapped_file(int fd, const void* ptr, u64 size)
+				: mapped_file_base(ptr, size)
+				, m_fd(fd)
+			{
+			}
+
+			~unix_mapped_file() override
+			{
+				::munmap(const_cast<u8*>(m_ptr), m_size);
+				::close(m_fd);
+			}
+
+			stat_t stat() override
+			{
+				struct ::stat file_info;
+				verify("file::stat" HERE), ::fstat(m_fd, &file_info) == 0;
+
+				stat_t info;
+				info.is_directory = false;
+				info.is_writable = false;
+				info.size = m_size;
+				info.atime = file_info.st_atime;
+				info.mtime = file_info.st_mtime;
+				info.ctime = file_info.st_ctime;
+
+				return info;
+			}
+		};
+
+		// Empty files can't be mapped, fallback to the regular file in this case
+		struct ::stat file_info;
+
+		if (::fstat(fd, &file_info) == 0 && S_ISREG(file_info.st_mode) && file_info.st_size > 0)
+		{
+			const auto ptr = ::mmap(nullptr, file_info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+			if (ptr != MAP_FAILED)
+			{
+				m_file = std::make_unique<unix_mapped_file>(fd, ptr, file_info.st_size);
+				return;
+			}
+		}
+	}
+
 	m_file = std::make_unique<unix_file>(fd);
 #endif
 }
@@ -19,6 +19,7 @@ namespace fs
 		create,
 		trunc,
 		excl,
+		mmap,
 
 		__bitset_enum_max
 	};
@@ -29,6 +30,7 @@ namespace fs
 	constexpr auto create  = +open_mode::create; // Create file if it doesn't exist
 	constexpr auto trunc   = +open_mode::trunc; // Clear opened file if it's not empty
 	constexpr auto excl    = +open_mode::excl; // Failure if the file already exists (used with `create`)
+	constexpr auto mmap    = +open_mode::mmap; // Map the whole file into memory (only with `read`, ignored if not possible)
 
 	constexpr auto rewrite = open_mode::write + open_mode::create + open_mode::trunc;
 
@@ -67,6 +69,12 @@ namespace fs
 		virtual u64 write(const void* buffer, u64 size) = 0;
 		virtual u64 seek(s64 offset, seek_mode whence) = 0;
 		virtual u64 size() = 0;
+
+		// Read at the specified offset without changing the current position (returns -1 if not supported)
+		virtual u64 read_at(u64 offset, void* buffer, u64 size);
+
+		// Get read-only view of the file contents (nullptr if not memory-mapped)
+		virtual const void* get_mapped_data();
 	};
 
 	// Directory entry (TODO)
@@ -234,6 +242,13 @@ namespace fs
 			return m_file->read(buffer, count);
 		}
 
+		// Read the data at specified offset without changing current position (thread-safe, returns -1 if not supported)
+		u64 read_at(u64 offset, void* buffer, u64 count) const
+		{
+			if (!m_file) xnull();
+			return m_file->read_at(offset, buffer, count);
+		}
+
 		// Write the data to the file and return the amount of data actually written
 		u64 write(const void* buffer, u64 count) const
 		{
@@ -262,6 +277,13 @@ namespace fs
 			return m_file->seek(0, seek_cur);
 		}
 
+		// Get memory-mapped file contents (nullptr if not mapped). Reading from such file is a plain memory copy.
+		const void* get_mapped_data() const
+		{
+			if (!m_file) xnull();
+			return m_file->get_mapped_data();
+		}
+
 		// Write std::string unconditionally
 		const file& write(const std::string& str) const
 		{
@@ -6,12 +6,15 @@
 #include <set>
 #include <array>
 #include <deque>
+#include <mutex>
+#include <tuple>
 
 #include "types.h"
 #include "StrFmt.h"
 #include "File.h"
 #include "Log.h"
 #include "VirtualMemory.h"
+#include "perf_jit.h"
 
 #ifdef _MSC_VER
 #pragma warning(push, 0)
@@ -22,6 +25,7 @@
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Object/SymbolSize.h"
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -57,6 +61,13 @@ static void* s_next;
 // Code section
 static u8* s_code_addr;
 
+// Readable names of compiled functions for host profilers (symbol -> name)
+static std::mutex s_names_mutex;
+static std::unordered_map<std::string, std::string> s_names;
+
+// Emitted functions waiting for jit_compiler::fin (the code is only final after relocations are resolved)
+static std::vector<std::tuple<const void*, u64, std::string>> s_perf_pending;
+
 #ifdef _WIN32
 static std::deque<std::vector<RUNTIME_FUNCTION>> s_unwater;
 static std::vector<std::vector<RUNTIME_FUNCTION>> s_unwind; // .pdata
@@ -289,6 +300,53 @@ struct EventListener final : llvm::JITEventListener
 			}
 		}
 #endif
+
+		if (utils::perf_jit_enabled())
+		{
+			// Collect functions using their final addresses (announced by jit_compiler::fin)
+			const auto debug_obj = inf.getObjectForDebug(obj);
+
+			for (const auto& pair : llvm::object::computeSymbolSizes(*debug_obj.getBinary()))
+			{
+				const llvm::object::SymbolRef& sym = pair.first;
+
+				auto type = sym.getType();
+
+				if (!type)
+				{
+					llvm::consumeError(type.takeError());
+					continue;
+				}
+
+				if (*type != llvm::object::SymbolRef::ST_Function)
+				{
+					continue;
+				}
+
+				auto name = sym.getName();
+				auto addr = sym.getAddress();
+
+				if (!name || !addr)
+				{
+					llvm::consumeError(name.takeError());
+					llvm::consumeError(addr.takeError());
+					continue;
+				}
+
+				std::string symbol = name->str();
+
+				std::lock_guard<std::mutex> lock(s_names_mutex);
+
+				const auto found = s_names.find(symbol);
+
+				if (found != s_names.end())
+				{
+					symbol = found->second;
+				}
+
+				s_perf_pending.emplace_back(reinterpret_cast<const void*>(*addr), pair.second, std::move(symbol));
+			}
+		}
 	}
 };
 
@@ -388,6 +446,18 @@ void jit_compiler::add(std::unique_ptr<llvm::Module> module, const std::string&
 void jit_compiler::fin(const std::string& path)
 {
 	m_engine->finalizeObject();
+
+	// Announce the code with resolved relocations (jitdump records contain a copy of the code)
+	std::vector<std::tuple<const void*, u64, std::string>> pending;
+	{
+		std::lock_guard<std::mutex> lock(s_names_mutex);
+		pending.swap(s_perf_pending);
+	}
+
+	for (const auto& func : pending)
+	{
+		utils::perf_jit_announce(std::get<0>(func), std::get<1>(func), std::get<2>(func));
+	}
 }
 
 void jit_compiler::add(std::unordered_map<std::string, std::string> data)
@@ -406,6 +476,7 @@ void jit_compiler::add(std::unordered_map<std::string, std::string> data)
 	{
 		std::memcpy(s_next, pair.second.data(), pair.second.size());
 		m_link.emplace(pair.first, (u64)s_next);
+		utils::perf_jit_announce(s_next, pair.second.size(), pair.first);
 		s_next = (void*)::align((u64)s_next + pair.second.size(), 16);
 	}
 
@@ -416,4 +487,10 @@ jit_compiler::~jit_compiler()
 {
 }
 
+void jit_compiler::set_name(const std::string& symbol, const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(s_names_mutex);
+	s_names[symbol] = name;
+}
+
 #endif
@@ -68,6 +68,9 @@ public:
 	{
 		return m_cpu;
 	}
+
+	// Set function name shown by host profilers (see utils::perf_jit_announce)
+	static void set_name(const std::string& symbol, const std::string& name);
 };
 
 #endif
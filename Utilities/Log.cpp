@@ -2,10 +2,14 @@
 #include "File.h"
 #include "StrFmt.h"
 #include "sema.h"
+#include "sysinfo.h"
 
 #include "rpcs3_version.h"
 #include <string>
 #include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -44,18 +48,54 @@ void fmt_class_string<logs::level>::format(std::string& out, u64 arg)
 
 namespace logs
 {
+	// Log file with asynchronous buffered output: messages are copied to the ring buffer by the emitting threads
+	// and written by the dedicated thread in large blocks.
 	class file_writer
 	{
-		// Could be memory-mapped file
+		// Ring buffer size (power of 2)
+		static constexpr u64 s_log_size = 32 * 1024 * 1024;
+
+		// Maximal size of the message copied at once (larger messages are split)
+		static constexpr u64 s_max_size = 0x100000;
+
 		fs::file m_file;
 
+		const std::unique_ptr<uchar[]> m_fptr;
+
+		// Reserved space end (high 40 bits) and the amount of bytes being copied by the emitting threads (low 24 bits).
+		// Data before the reserved space end can only be written out if no copy is in progress.
+		atomic_t<u64> m_buf{0};
+
+		// Amount of data written to the file
+		atomic_t<u64> m_out{0};
+
+		// Amount of messages dropped because the buffer was full
+		atomic_t<u64> m_dropped{0};
+
+		// Protects file writes
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+
+		// Set when the writer waits for the copies in progress (the last emitting thread notifies it)
+		atomic_t<bool> m_wait_copy{false};
+
+		bool m_quit = false;
+
+		std::thread m_writer;
+
+		// Write out available data (called with the mutex locked, may unlock it for waiting)
+		bool write_out(std::unique_lock<std::mutex>& lock);
+
 	public:
 		file_writer(const std::string& name);
 
-		virtual ~file_writer() = default;
+		virtual ~file_writer();
+
+		// Append raw data: blocks if the buffer is full, or drops the message if !blocking (returns false)
+		bool log(const char* text, std::size_t size, bool blocking = true);
 
-		// Append raw data
-		void log(const char* text, std::size_t size);
+		// Write out all buffered data
+		void flush();
 	};
 
 	struct file_listener : public file_writer, public listener
@@ -64,7 +104,7 @@ namespace logs
 			: file_writer(name)
 			, listener()
 		{
-			const std::string& start = fmt::format("\xEF\xBB\xBF" "RPCS3 v%s\n", rpcs3::version.to_string());
+			const std::string& start = fmt::format("\xEF\xBB\xBF" "RPCS3 v%s\n%s\n", rpcs3::version.to_string(), utils::get_system_info());
 			file_writer::log(start.data(), start.size());
 		}
 
@@ -225,6 +265,7 @@ void logs::message::broadcast(const char* fmt, const fmt_type_info* sup, const u
 [[noreturn]] extern void catch_all_exceptions();
 
 logs::file_writer::file_writer(const std::string& name)
+	: m_fptr(new uchar[s_log_size])
 {
 	try
 	{
@@ -237,11 +278,175 @@ logs::file_writer::file_writer(const std::string& name)
 	{
 		catch_all_exceptions();
 	}
+
+	m_writer = std::thread([this]
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (true)
+		{
+			// Write out after a short delay to batch writes (or when woken up by a blocked thread)
+			if (!write_out(lock))
+			{
+				if (m_quit)
+				{
+					break;
+				}
+
+				m_cv.wait_for(lock, std::chrono::milliseconds(10));
+			}
+		}
+	});
+}
+
+logs::file_writer::~file_writer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+
+	m_cv.notify_all();
+	m_writer.join();
+}
+
+bool logs::file_writer::write_out(std::unique_lock<std::mutex>& lock)
+{
+	// Must be set before reading m_buf (see log())
+	m_wait_copy = true;
+
+	const u64 bufv = m_buf;
+
+	if (bufv & 0xffffff)
+	{
+		// Some threads are copying their messages: wait for the notification (timeout in case of a crashed thread)
+		m_cv.wait_for(lock, std::chrono::milliseconds(10));
+		return true;
+	}
+
+	m_wait_copy = false;
+
+	const u64 start = m_out;
+	const u64 end = bufv >> 24;
+
+	if (start == end)
+	{
+		return false;
+	}
+
+	// Write the data in at most two parts (ring buffer wraps around)
+	const u64 pos = start % s_log_size;
+	const u64 part = std::min(end - start, s_log_size - pos);
+
+	m_file.write(m_fptr.get() + pos, part);
+	m_file.write(m_fptr.get(), end - start - part);
+	m_out = end;
+
+	if (const u64 dropped = m_dropped.exchange(0))
+	{
+		const std::string& text = fmt::format(u8"·W Log: %u messages dropped (buffer full)\n", dropped);
+		m_file.write(text.data(), text.size());
+	}
+
+	// Wake up blocked threads
+	m_cv.notify_all();
+	return true;
+}
+
+bool logs::file_writer::log(const char* text, std::size_t size, bool blocking)
+{
+	// Very large messages (not atomic, may interleave with other messages)
+	while (size > s_max_size)
+	{
+		log(text, s_max_size, true);
+		text += s_max_size;
+		size -= s_max_size;
+	}
+
+	while (true)
+	{
+		u64 bufv = 0;
+
+		const u64 out = m_out;
+
+		// Reserve space
+		const auto pos = m_buf.atomic_op([&](u64& v) -> uchar*
+		{
+			const u64 v1 = v >> 24;
+			const u64 v2 = v & 0xffffff;
+
+			if (UNLIKELY(v2 + size > 0xffffff || v1 + v2 + size > out + s_log_size))
+			{
+				bufv = v;
+				return nullptr;
+			}
+
+			v += size;
+			return m_fptr.get() + (v1 + v2) % s_log_size;
+		});
+
+		if (UNLIKELY(!pos))
+		{
+			if (!blocking && (bufv & 0xffffff) + size <= 0xffffff)
+			{
+				// Buffer full: drop the message
+				m_dropped++;
+				return false;
+			}
+
+			// Wait for the writer thread (m_out is only modified with the mutex locked)
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (m_out == out)
+			{
+				m_cv.notify_all();
+				m_cv.wait(lock);
+			}
+
+			continue;
+		}
+
+		if (pos + size > m_fptr.get() + s_log_size)
+		{
+			const auto frag = m_fptr.get() + s_log_size - pos;
+			std::memcpy(pos, text, frag);
+			std::memcpy(m_fptr.get(), text + frag, size - frag);
+		}
+		else
+		{
+			std::memcpy(pos, text, size);
+		}
+
+		// Commit the data (move it from the "copying" part to the committed part)
+		if ((m_buf += (u64{size} << 24) - size) & 0xffffff)
+		{
+			return true;
+		}
+
+		// Wake up the writer if it waits for the last copy
+		if (m_wait_copy && m_wait_copy.exchange(false))
+		{
+			std::lock_guard<std::mutex>{m_mutex}, m_cv.notify_all();
+		}
+
+		return true;
+	}
 }
 
-void logs::file_writer::log(const char* text, std::size_t size)
+void logs::file_writer::flush()
 {
-	m_file.write(text, size);
+	const u64 end = m_buf >> 24;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// Wait until other threads complete their copies (bounded to ~1 s: the caller may be crashing)
+	for (u32 i = 0; m_out < end && i < 100; i++)
+	{
+		if (!write_out(lock))
+		{
+			break;
+		}
+	}
 }
 
 void logs::file_listener::log(u64 stamp, const logs::message& msg, const std::string& prefix, const std::string& _text)
@@ -288,5 +493,17 @@ void logs::file_listener::log(u64 stamp, const logs::message& msg, const std::st
 	text += _text;
 	text += '\n';
 
-	file_writer::log(text.data(), text.size());
+	// Low severity messages may be dropped when the buffer is full
+	file_writer::log(text.data(), text.size(), msg.sev < level::warning);
+
+	if (msg.sev <= level::fatal)
+	{
+		// The process may terminate soon
+		file_writer::flush();
+	}
+}
+
+void logs::flush()
+{
+	get_logger()->flush();
 }
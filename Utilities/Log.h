@@ -111,6 +111,9 @@ namespace logs
 
 	// Log level control: register channel if necessary, set channel level
 	void set_level(const std::string&, level);
+
+	// Write out buffered log messages (log file output is asynchronous)
+	void flush();
 }
 
 // Legacy:
@@ -24,16 +24,31 @@
 
 #include "sync.h"
 
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cfenv>
+#include <xmmintrin.h>
+
 thread_local u64 g_tls_fault_all = 0;
 thread_local u64 g_tls_fault_rsx = 0;
 thread_local u64 g_tls_fault_spu = 0;
 
+// Thread time and cycles at the start of the current thread_ctrl (host threads are reused)
+thread_local u64 g_tls_start_time = 0;
+thread_local u64 g_tls_start_cycles = 0;
+
 static void report_fatal_error(const std::string& msg)
 {
 	std::string _msg = msg + "\n"
 		"HOW TO REPORT ERRORS: Check the FAQ, README, other sources.\n"
 		"Please, don't send incorrect reports. Thanks for understanding.\n";
 
+	// Write out the log before the process terminates
+	logs::flush();
+
 #ifdef _WIN32
 	_msg += "Press (Ctrl+C) to copy this message.";
 	MessageBoxA(0, _msg.c_str(), "Fatal error", MB_ICONERROR); // TODO: unicode message
@@ -1513,6 +1528,79 @@ thread_local DECLARE(thread_ctrl::g_tls_this_thread) = nullptr;
 
 extern thread_local std::string(*g_tls_log_prefix)();
 
+// Initial floating point environment of the host thread (restored for every pooled thread)
+static thread_local std::fenv_t g_tls_fp_env;
+static thread_local u32 g_tls_fp_mxcsr;
+
+// Host thread pool: finished threads wait for the next thread instead of exiting
+struct thread_pool
+{
+	// Maximal amount of idle host threads
+	static constexpr u32 max_idle = 32;
+
+	// Idle host thread lifetime
+	static constexpr auto timeout = std::chrono::seconds(10);
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<thread_ctrl*> queue;
+	u32 idle = 0;
+
+	atomic_t<u64> started{0};
+	atomic_t<u64> finished{0};
+	atomic_t<u64> created{0};
+	atomic_t<u64> exited{0};
+
+	// Pass the thread to an idle host thread if possible
+	bool push(thread_ctrl* ctrl)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (idle <= queue.size())
+			{
+				return false;
+			}
+
+			queue.push_back(ctrl);
+		}
+
+		cv.notify_one();
+		return true;
+	}
+
+	// Wait for the next thread (nullptr if the host thread should exit)
+	thread_ctrl* pop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (idle >= max_idle)
+		{
+			return nullptr;
+		}
+
+		idle++;
+
+		while (queue.empty())
+		{
+			if (cv.wait_for(lock, timeout) == std::cv_status::timeout && queue.empty())
+			{
+				idle--;
+				return nullptr;
+			}
+		}
+
+		idle--;
+
+		const auto result = queue.front();
+		queue.pop_front();
+		return result;
+	}
+};
+
+// Never destroyed (idle host threads may still wait on it at exit)
+static thread_pool& s_pool = *new thread_pool;
+
 void thread_ctrl::start(const std::shared_ptr<thread_ctrl>& ctrl, task_stack task)
 {
 #ifdef _WIN32
@@ -1523,47 +1611,94 @@ void thread_ctrl::start(const std::shared_ptr<thread_ctrl>& ctrl, task_stack tas
 	using thread_type = thread_result(*)(void* arg);
 #endif
 
-	// Thread entry point
+	// Host thread entry point
 	const thread_type entry = [](void* arg) -> thread_result
 	{
-		// Recover shared_ptr from short-circuited thread_ctrl object pointer
-		const std::shared_ptr<thread_ctrl> ctrl = static_cast<thread_ctrl*>(arg)->m_self;
+		// Tasks may change rounding mode or FTZ/DAZ (MXCSR is saved separately as fenv_t may not include it)
+		std::fegetenv(&g_tls_fp_env);
+		g_tls_fp_mxcsr = _mm_getcsr();
 
-		try
-		{
-			ctrl->initialize();
-			task_stack{std::move(ctrl->m_task)}.invoke();
-		}
-		catch (...)
+		for (auto _this = static_cast<thread_ctrl*>(arg); _this; _this = s_pool.pop())
 		{
-			// Capture exception
-			ctrl->finalize(std::current_exception());
-			return 0;
+			run(_this);
 		}
 
-		ctrl->finalize(nullptr);
+		s_pool.exited++;
 		return 0;
 	};
 
 	ctrl->m_self = ctrl;
 	ctrl->m_task = std::move(task);
 
-	// TODO: implement simple thread pool
+	s_pool.started++;
+
+	if (s_pool.push(ctrl.get()))
+	{
+		return;
+	}
+
+	s_pool.created++;
+
 #ifdef _WIN32
 	std::uintptr_t thread = _beginthreadex(nullptr, 0, entry, ctrl.get(), 0, nullptr);
 	verify("thread_ctrl::start" HERE), thread != 0;
+	CloseHandle((HANDLE)thread);
 #else
 	pthread_t thread;
 	verify("thread_ctrl::start" HERE), pthread_create(&thread, nullptr, entry, ctrl.get()) == 0;
+	pthread_detach(thread);
 #endif
+}
 
-	// TODO: this is unsafe and must be duplicated in thread_ctrl::initialize
-	ctrl->m_thread = (uintptr_t)thread;
+void thread_ctrl::run(thread_ctrl* _this)
+{
+	// Recover shared_ptr from short-circuited thread_ctrl object pointer
+	const std::shared_ptr<thread_ctrl> ctrl = _this->m_self;
+
+	try
+	{
+		ctrl->initialize();
+		task_stack{std::move(ctrl->m_task)}.invoke();
+	}
+	catch (...)
+	{
+		// Capture exception
+		ctrl->finalize(std::current_exception());
+		return;
+	}
+
+	ctrl->finalize(nullptr);
+}
+
+thread_ctrl::stats thread_ctrl::get_stats()
+{
+	return {s_pool.started, s_pool.finished, s_pool.created, s_pool.exited};
+}
+
+// Get thread time in nanoseconds and cycles (for the current host thread)
+static u64 get_thread_time(u64& cycles)
+{
+#ifdef _WIN32
+	ULONG64 _cycles{};
+	QueryThreadCycleTime(GetCurrentThread(), &_cycles);
+	FILETIME ctime, etime, ktime, utime;
+	GetThreadTimes(GetCurrentThread(), &ctime, &etime, &ktime, &utime);
+	cycles = _cycles;
+	return ((ktime.dwLowDateTime | (u64)ktime.dwHighDateTime << 32) + (utime.dwLowDateTime | (u64)utime.dwHighDateTime << 32)) * 100ull;
+#elif defined(RUSAGE_THREAD)
+	cycles = 0; // Not supported
+	struct ::rusage stats{};
+	::getrusage(RUSAGE_THREAD, &stats);
+	return (stats.ru_utime.tv_sec + stats.ru_stime.tv_sec) * 1000000000ull + (stats.ru_utime.tv_usec + stats.ru_stime.tv_usec) * 1000ull;
+#else
+	cycles = 0;
+	return 0;
+#endif
 }
 
 void thread_ctrl::initialize()
 {
-	// Initialize TLS variable
+	// Initialize TLS variables (the host thread may be reused)
 	g_tls_this_thread = this;
 
 	g_tls_log_prefix = []
@@ -1571,6 +1706,22 @@ void thread_ctrl::initialize()
 		return g_tls_this_thread->m_name;
 	};
 
+	g_tls_fault_all = 0;
+	g_tls_fault_rsx = 0;
+	g_tls_fault_spu = 0;
+	g_tls_start_time = get_thread_time(g_tls_start_cycles);
+	fs::g_tls_error = fs::error::ok;
+	std::fesetenv(&g_tls_fp_env);
+	_mm_setcsr(g_tls_fp_mxcsr);
+
+#ifdef _WIN32
+	HANDLE handle{};
+	DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &handle, 0, FALSE, DUPLICATE_SAME_ACCESS);
+	m_thread = (std::uintptr_t)handle;
+#else
+	m_thread = (std::uintptr_t)pthread_self();
+#endif
+
 	++g_thread_count;
 
 #ifdef _MSC_VER
@@ -1608,21 +1759,9 @@ void thread_ctrl::finalize(std::exception_ptr eptr) noexcept
 	m_task.invoke();
 	m_task.reset();
 
-#ifdef _WIN32
-	ULONG64 cycles{};
-	QueryThreadCycleTime(GetCurrentThread(), &cycles);
-	FILETIME ctime, etime, ktime, utime;
-	GetThreadTimes(GetCurrentThread(), &ctime, &etime, &ktime, &utime);
-	const u64 time = ((ktime.dwLowDateTime | (u64)ktime.dwHighDateTime << 32) + (utime.dwLowDateTime | (u64)utime.dwHighDateTime << 32)) * 100ull;
-#elif defined(RUSAGE_THREAD)
-	const u64 cycles = 0; // Not supported
-	struct ::rusage stats{};
-	::getrusage(RUSAGE_THREAD, &stats);
-	const u64 time = (stats.ru_utime.tv_sec + stats.ru_stime.tv_sec) * 1000000000ull + (stats.ru_utime.tv_usec + stats.ru_stime.tv_usec) * 1000ull;
-#else
-	const u64 cycles = 0;
-	const u64 time = 0;
-#endif
+	u64 cycles;
+	const u64 time = get_thread_time(cycles) - g_tls_start_time;
+	cycles -= g_tls_start_cycles;
 
 	g_tls_log_prefix = []
 	{
@@ -1638,6 +1777,16 @@ void thread_ctrl::finalize(std::exception_ptr eptr) noexcept
 
 	--g_thread_count;
 
+	s_pool.finished++;
+
+	// Reset TLS variables before the host thread becomes idle
+	g_tls_this_thread = nullptr;
+
+	g_tls_log_prefix = []
+	{
+		return std::string{};
+	};
+
 	// Untangle circular reference, set exception
 	semaphore_lock{m_mutex}, m_self.reset(), m_exception = eptr;
 
@@ -1742,14 +1891,12 @@ thread_ctrl::thread_ctrl(std::string&& name)
 
 thread_ctrl::~thread_ctrl()
 {
+#ifdef _WIN32
 	if (m_thread)
 	{
-#ifdef _WIN32
 		CloseHandle((HANDLE)m_thread.raw());
-#else
-		pthread_detach((pthread_t)m_thread.raw());
-#endif
 	}
+#endif
 }
 
 std::exception_ptr thread_ctrl::get_exception() const
@@ -1861,3 +2008,71 @@ void named_thread::start_thread(const std::shared_ptr<void>& _this)
 task_stack::task_base::~task_base()
 {
 }
+
+u64 periodic_timer::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+u64 periodic_timer::wait_until(u64 time)
+{
+	while (true)
+	{
+		const u64 stamp = now();
+
+		if (stamp >= time)
+		{
+			const u64 late = stamp - time;
+			m_waits++;
+			m_late_total += late;
+			m_late_max = std::max(m_late_max, late);
+			return late;
+		}
+
+		const u64 remaining = time - stamp;
+
+		if (remaining <= m_margin)
+		{
+			// Too close for the OS sleep
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Sleep, leaving the expected oversleep for yielding
+		const u64 sleep_end = time - m_margin;
+
+		if (!thread_ctrl::wait_for(sleep_end - stamp))
+		{
+			const u64 woke = now();
+			const u64 over = woke > sleep_end ? woke - sleep_end : 0;
+
+			// Converge to twice the average oversleep, limit the amount of time spent yielding
+			m_margin = std::min<u64>(std::max<u64>((m_margin * 14 + over * 4) / 16, 20), 500);
+		}
+	}
+}
+
+u64 periodic_timer::wait()
+{
+	const u64 stamp = now();
+
+	u64 skipped = 0;
+
+	// Skip missed ticks if fell behind too far
+	if (stamp > deadline(m_ticks + max_lag))
+	{
+		const u64 ticks = ((stamp - m_start) * m_den) / m_num;
+		skipped = ticks - m_ticks;
+		m_skipped += skipped;
+		m_ticks = ticks;
+	}
+
+	wait_until(deadline(m_ticks++));
+	return skipped;
+}
+
+std::string periodic_timer::get_stats() const
+{
+	return fmt::format("waits=%llu, avg late=%lluus, max late=%lluus, skipped=%llu, margin=%lluus",
+		m_waits, m_waits ? m_late_total / m_waits : 0, m_late_max, m_skipped, m_margin);
+}
@@ -124,6 +124,9 @@ class thread_ctrl final
 	// Called at the thread end
 	void finalize(std::exception_ptr) noexcept;
 
+	// Run the thread on the current host thread
+	static void run(thread_ctrl*);
+
 	// Add task (atexit)
 	static void _push(task_stack);
 
@@ -206,6 +209,17 @@ public:
 		return g_tls_this_thread;
 	}
 
+	// Thread creation statistics
+	struct stats
+	{
+		u64 started; // Threads started
+		u64 finished; // Threads finished
+		u64 created; // Host threads created
+		u64 exited; // Host threads exited (idle for too long)
+	};
+
+	static stats get_stats();
+
 	// Register function at thread exit (for the current thread)
 	template<typename F>
 	static inline void atexit(F&& func)
@@ -318,3 +332,74 @@ public:
 		return m_thread.get();
 	}
 };
+
+// Periodic timer with absolute deadlines (no accumulated drift) and sub-millisecond wakeup accuracy.
+// Sleeps most of the remaining time and yields for the last part. Must be used in thread_ctrl thread.
+class periodic_timer final
+{
+	// Period in microseconds (m_num / m_den, exact for fractional periods)
+	const u64 m_num;
+	const u64 m_den;
+
+	// Time of tick 0
+	u64 m_start = 0;
+
+	// Index of the next tick
+	u64 m_ticks = 0;
+
+	// Expected oversleep of the OS wait (adaptive, microseconds)
+	u64 m_margin = 100;
+
+	// Statistics
+	u64 m_waits = 0;
+	u64 m_late_total = 0;
+	u64 m_late_max = 0;
+	u64 m_skipped = 0;
+
+public:
+	// Amount of missed periods before the timer skips ticks instead of catching up
+	static constexpr u64 max_lag = 8;
+
+	periodic_timer(u64 period_num, u64 period_den = 1)
+		: m_num(period_num)
+		, m_den(period_den)
+	{
+	}
+
+	// Current time in microseconds (steady clock)
+	static u64 now();
+
+	// (Re)start counting ticks from the specified time
+	void start(u64 time = now())
+	{
+		m_start = time;
+		m_ticks = 0;
+	}
+
+	// Shift all subsequent deadlines (for example, by the duration of the emulation pause)
+	void delay(u64 usec)
+	{
+		m_start += usec;
+	}
+
+	// Get absolute time of specified tick
+	u64 deadline(u64 tick) const
+	{
+		return m_start + tick / m_den * m_num + tick % m_den * m_num / m_den;
+	}
+
+	// Get absolute time of the next tick
+	u64 next() const
+	{
+		return deadline(m_ticks);
+	}
+
+	// Wait until the specified absolute time. Returns lateness in microseconds. Abortable, may throw.
+	u64 wait_until(u64 time);
+
+	// Wait for the next tick. Returns the amount of ticks skipped before it (see max_lag). Abortable, may throw.
+	u64 wait();
+
+	// Get statistics string (wakeup lateness, skipped ticks)
+	std::string get_stats() const;
+};
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "Utilities/Log.h"
+#include "Utilities/Atomic.h"
 #include "VirtualMemory.h"
 #ifdef _WIN32
 #include <Windows.h>
@@ -76,8 +77,12 @@ namespace utils
 #endif
 	}
 
+	static atomic_t<u64> s_protect_count{0};
+
 	void memory_protect(void* pointer, std::size_t size, protection prot)
 	{
+		s_protect_count++;
+
 #ifdef _WIN32
 		DWORD old;
 		verify(HERE), ::VirtualProtect(pointer, size, +prot, &old);
@@ -85,4 +90,79 @@ namespace utils
 		verify(HERE), ::mprotect((void*)((u64)pointer & -4096), ::align(size, 4096), +prot) != -1;
 #endif
 	}
+
+	u64 memory_protect_count()
+	{
+		return s_protect_count;
+	}
+
+	memory_protect_batch::~memory_protect_batch()
+	{
+		apply();
+	}
+
+	void memory_protect_batch::protect(void* pointer, std::size_t size, protection prot)
+	{
+		const u64 start = (u64)pointer & -4096;
+		const u64 end = ::align((u64)pointer + size, 4096);
+
+		if (start >= end)
+		{
+			return;
+		}
+
+		auto it = m_ranges.lower_bound(start);
+
+		// Split previous range overlapping the start
+		if (it != m_ranges.begin())
+		{
+			const auto prev = std::prev(it);
+
+			if (prev->second.first > start)
+			{
+				if (prev->second.first > end)
+				{
+					m_ranges.emplace(end, prev->second);
+				}
+
+				prev->second.first = start;
+			}
+		}
+
+		// Remove (or cut) ranges overwritten by the new one
+		while (it != m_ranges.end() && it->first < end)
+		{
+			if (it->second.first > end)
+			{
+				m_ranges.emplace(end, it->second);
+			}
+
+			it = m_ranges.erase(it);
+		}
+
+		m_ranges.emplace(start, std::make_pair(end, prot));
+	}
+
+	std::size_t memory_protect_batch::apply()
+	{
+		std::size_t count = 0;
+
+		for (auto it = m_ranges.begin(); it != m_ranges.end(); count++)
+		{
+			const u64 start = it->first;
+			const protection prot = it->second.second;
+			u64 end = it->second.first;
+
+			// Merge adjacent ranges
+			while (++it != m_ranges.end() && it->first == end && it->second.second == prot)
+			{
+				end = it->second.first;
+			}
+
+			memory_protect((void*)start, end - start, prot);
+		}
+
+		m_ranges.clear();
+		return count;
+	}
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <map>
+
 namespace utils
 {
 	// Memory protection type
@@ -32,4 +34,29 @@ namespace utils
 
 	// Set memory protection
 	void memory_protect(void* pointer, std::size_t size, protection prot);
+
+	// Get total amount of memory_protect() system calls (instrumentation)
+	u64 memory_protect_count();
+
+	// Accumulates memory protection changes and applies them at once.
+	// Overlapping requests are resolved in order, adjacent ranges with the same protection are merged.
+	class memory_protect_batch final
+	{
+		// Page-aligned ranges: start -> (end, protection)
+		std::map<u64, std::pair<u64, protection>> m_ranges;
+
+	public:
+		memory_protect_batch() = default;
+
+		memory_protect_batch(const memory_protect_batch&) = delete;
+
+		// Apply remaining changes
+		~memory_protect_batch();
+
+		// Queue protection change
+		void protect(void* pointer, std::size_t size, protection prot);
+
+		// Apply queued changes (sync point), return amount of system calls
+		std::size_t apply();
+	};
 }
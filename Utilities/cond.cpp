@@ -2,6 +2,7 @@
 #include "sync.h"
 
 #include <limits.h>
+#include <chrono>
 
 #ifndef _WIN32
 #include <thread>
@@ -105,3 +106,45 @@ void cond_variable::imp_wake(u32 _count) noexcept
 	}
 #endif
 }
+
+static atomic_t<u64> s_spin_ok{0};
+static atomic_t<u64> s_parked{0};
+
+u64 adaptive_wait::now() noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void adaptive_wait::record(u64 duration, bool spin_ok) noexcept
+{
+	const u32 limit = m_limit;
+
+	// Racy update is harmless
+	if (spin_ok)
+	{
+		// Keep twice the margin of the last successful spin
+		m_limit = static_cast<u32>(std::min<u64>(std::max<u64>(limit - limit / 8, duration * 2), max_spin));
+	}
+	else
+	{
+		// Spinning failed: back off, but probe again if the wait was short (spinning would not help long waits)
+		m_limit = static_cast<u32>(std::min<u64>(limit / 2 + (duration <= max_spin ? duration / 8 : 0), max_spin));
+	}
+}
+
+void adaptive_wait::record_total(bool spin_ok) noexcept
+{
+	if (spin_ok)
+	{
+		s_spin_ok++;
+	}
+	else
+	{
+		s_parked++;
+	}
+}
+
+adaptive_wait::stats adaptive_wait::get_total()
+{
+	return {s_spin_ok, s_parked};
+}
@@ -3,6 +3,8 @@
 #include "types.h"
 #include "Atomic.h"
 
+#include <algorithm>
+
 // Lightweight condition variable
 class cond_variable
 {
@@ -48,3 +50,92 @@ public:
 		}
 	}
 };
+
+// Adaptive spin-then-park waiting state (one instance per waitable object or channel).
+// The spin limit is learned from recent wait durations: it follows waits completed while spinning,
+// shrinks after every unsuccessful spin and is pulled towards the duration of short parked waits.
+class adaptive_wait
+{
+public:
+	// Spin limit bounds (ns)
+	static constexpr u32 max_spin = 20000;
+	static constexpr u32 init_spin = 5000;
+
+	struct stats
+	{
+		u64 spin_ok; // Waits completed while spinning
+		u64 parked; // Waits completed after parking
+	};
+
+private:
+	// Current spin limit (ns)
+	atomic_t<u32> m_limit{init_spin};
+
+	atomic_t<u64> m_spin_ok{0};
+	atomic_t<u64> m_parked{0};
+
+	static u64 now() noexcept;
+
+	// Update the spin limit
+	void record(u64 duration, bool spin_ok) noexcept;
+
+	// Update global statistics
+	static void record_total(bool spin_ok) noexcept;
+
+public:
+	constexpr adaptive_wait() = default;
+
+	// Spin until pred() or the spin limit expires. Returns 0 if pred() succeeded, or the timestamp which must be passed to parked()
+	template <typename F>
+	u64 spin(F&& pred)
+	{
+		if (pred())
+		{
+			// No waiting
+			return 0;
+		}
+
+		const u64 start = now();
+		const u64 limit = m_limit;
+
+		for (u64 passed = 0; passed < limit; passed = now() - start)
+		{
+			busy_wait(10);
+
+			if (pred())
+			{
+				record(now() - start, true);
+				m_spin_ok++;
+				record_total(true);
+				return 0;
+			}
+		}
+
+		return start;
+	}
+
+	// Complete the wait after parking (the caller waited until its condition using spin() result)
+	void parked(u64 start) noexcept
+	{
+		if (start)
+		{
+			record(now() - start, false);
+			m_parked++;
+			record_total(false);
+		}
+	}
+
+	stats get_stats() const
+	{
+		return {m_spin_ok, m_parked};
+	}
+
+	// Current spin limit (ns)
+	u32 get_limit() const
+	{
+		return m_limit;
+	}
+
+	// Statistics of all instances
+	static stats get_total();
+};
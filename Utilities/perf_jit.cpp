@@ -0,0 +1,183 @@
+#include "perf_jit.h"
+#include "StrFmt.h"
+#include "Log.h"
+
+#include <mutex>
+
+#ifdef __linux__
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace utils
+{
+#ifdef __linux__
+	// Jitdump file format (see tools/perf/Documentation/jitdump-specification.txt in the Linux tree)
+	struct jitdump_header
+	{
+		u32 magic;
+		u32 version;
+		u32 total_size;
+		u32 elf_mach;
+		u32 pad1;
+		u32 pid;
+		u64 timestamp;
+		u64 flags;
+	};
+
+	struct jitdump_code_load
+	{
+		u32 id; // JIT_CODE_LOAD
+		u32 total_size;
+		u64 timestamp;
+		u32 pid;
+		u32 tid;
+		u64 vma;
+		u64 code_addr;
+		u64 code_size;
+		u64 code_index;
+	};
+
+	static_assert(sizeof(jitdump_header) == 40 && sizeof(jitdump_code_load) == 56, "Unexpected jitdump record size");
+
+	static std::mutex s_perf_mutex;
+	static int s_perf_map = -1;
+	static int s_jit_dump = -1;
+	static void* s_jit_dump_marker = nullptr;
+	static u64 s_jit_code_index = 0;
+
+	// perf uses CLOCK_MONOTONIC timestamps for the jitdump records (perf record -k 1)
+	static u64 perf_timestamp()
+	{
+		timespec ts;
+		::clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	}
+
+	static bool write_all(int fd, const void* data, std::size_t size)
+	{
+		for (auto ptr = static_cast<const char*>(data); size;)
+		{
+			const ssize_t r = ::write(fd, ptr, size);
+
+			if (r <= 0)
+			{
+				return false;
+			}
+
+			ptr += r;
+			size -= r;
+		}
+
+		return true;
+	}
+#endif
+
+	void perf_jit_init(bool map, bool dump)
+	{
+#ifdef __linux__
+		std::lock_guard<std::mutex> lock(s_perf_mutex);
+
+		const u32 pid = ::getpid();
+
+		if (map && s_perf_map < 0)
+		{
+			const std::string path = fmt::format("/tmp/perf-%u.map", pid);
+
+			s_perf_map = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+			if (s_perf_map < 0)
+			{
+				LOG_ERROR(GENERAL, "Failed to create %s (errno=%d)", path, errno);
+			}
+			else
+			{
+				LOG_NOTICE(GENERAL, "JIT symbols are written to %s", path);
+			}
+		}
+
+		if (dump && s_jit_dump < 0)
+		{
+			const std::string path = fmt::format("/tmp/jit-%u.dump", pid);
+
+			const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+			if (fd < 0)
+			{
+				LOG_ERROR(GENERAL, "Failed to create %s (errno=%d)", path, errno);
+				return;
+			}
+
+			jitdump_header header{};
+			header.magic = 0x4A695444;
+			header.version = 1;
+			header.total_size = sizeof(jitdump_header);
+			header.elf_mach = 62; // EM_X86_64
+			header.pid = pid;
+			header.timestamp = perf_timestamp();
+
+			// perf finds the file by the executable mapping recorded in the profile
+			void* const marker = write_all(fd, &header, sizeof(header)) ? ::mmap(nullptr, ::sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+
+			if (marker == MAP_FAILED)
+			{
+				LOG_ERROR(GENERAL, "Failed to initialize %s (errno=%d)", path, errno);
+				::close(fd);
+				return;
+			}
+
+			s_jit_dump = fd;
+			s_jit_dump_marker = marker;
+			LOG_NOTICE(GENERAL, "JIT code is written to %s (use perf record -k 1 and perf inject --jit)", path);
+		}
+#endif
+	}
+
+	bool perf_jit_enabled()
+	{
+#ifdef __linux__
+		return s_perf_map >= 0 || s_jit_dump >= 0;
+#else
+		return false;
+#endif
+	}
+
+	void perf_jit_announce(const void* ptr, std::size_t size, const std::string& name)
+	{
+#ifdef __linux__
+		if (!perf_jit_enabled() || !size)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(s_perf_mutex);
+
+		if (s_perf_map >= 0)
+		{
+			const std::string line = fmt::format("%llx %llx %s\n", reinterpret_cast<u64>(ptr), size, name);
+			write_all(s_perf_map, line.data(), line.size());
+		}
+
+		if (s_jit_dump >= 0)
+		{
+			jitdump_code_load rec;
+			rec.id = 0;
+			rec.total_size = ::narrow<u32>(sizeof(rec) + name.size() + 1 + size, HERE);
+			rec.timestamp = perf_timestamp();
+			rec.pid = ::getpid();
+			rec.tid = ::syscall(SYS_gettid);
+			rec.vma = reinterpret_cast<u64>(ptr);
+			rec.code_addr = reinterpret_cast<u64>(ptr);
+			rec.code_size = size;
+			rec.code_index = s_jit_code_index++;
+
+			write_all(s_jit_dump, &rec, sizeof(rec));
+			write_all(s_jit_dump, name.c_str(), name.size() + 1);
+			write_all(s_jit_dump, ptr, size);
+		}
+#endif
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "types.h"
+
+#include <string>
+
+namespace utils
+{
+	// Open /tmp/perf-<pid>.map and/or /tmp/jit-<pid>.dump for the Linux perf tool (does nothing on other platforms)
+	void perf_jit_init(bool map, bool dump);
+
+	// Check whether the JIT code should be announced
+	bool perf_jit_enabled();
+
+	// Announce the JIT code (the name shouldn't contain newlines)
+	void perf_jit_announce(const void* ptr, std::size_t size, const std::string& name);
+}
@@ -0,0 +1,397 @@
+#include "sysinfo.h"
+#include "File.h"
+#include "StrFmt.h"
+#include "StrUtil.h"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+#ifdef _WIN32
+#include <intrin.h>
+#include <Windows.h>
+#else
+#include <cpuid.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+std::array<u32, 4> utils::get_cpuid(u32 func, u32 subfunc)
+{
+	int regs[4];
+#ifdef _MSC_VER
+	__cpuidex(regs, func, subfunc);
+#else
+	__asm__ volatile("cpuid" : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3]) : "a" (func), "c" (subfunc));
+#endif
+	return {0u + regs[0], 0u + regs[1], 0u + regs[2], 0u + regs[3]};
+}
+
+u64 utils::get_xgetbv(u32 xcr)
+{
+#ifdef _MSC_VER
+	return _xgetbv(xcr);
+#else
+	u32 eax, edx;
+	__asm__ volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (xcr));
+	return eax | (u64(edx) << 32);
+#endif
+}
+
+bool utils::has_ssse3()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && get_cpuid(1, 0)[2] & 0x200;
+	return g_value;
+}
+
+bool utils::has_sse41()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && get_cpuid(1, 0)[2] & 0x80000;
+	return g_value;
+}
+
+bool utils::has_avx()
+{
+	// Check OSXSAVE and AVX bits, then make sure the OS saves YMM state
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && (get_cpuid(1, 0)[2] & 0x18000000) == 0x18000000 && (get_xgetbv(0) & 0x6) == 0x6;
+	return g_value;
+}
+
+bool utils::has_avx2()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x7 && get_cpuid(7, 0)[1] & 0x20 && has_avx();
+	return g_value;
+}
+
+bool utils::has_aes()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && get_cpuid(1, 0)[2] & 0x2000000;
+	return g_value;
+}
+
+bool utils::has_vaes()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x7 && get_cpuid(7, 0)[2] & 0x200 && has_avx2() && has_aes();
+	return g_value;
+}
+
+bool utils::has_sha()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x7 && get_cpuid(7, 0)[1] & 0x20000000 && has_sse41();
+	return g_value;
+}
+
+std::string utils::get_system_info()
+{
+	std::string result;
+
+	const auto vendor = get_cpuid(0, 0);
+	result.append(reinterpret_cast<const char*>(&vendor[1]), 4);
+	result.append(reinterpret_cast<const char*>(&vendor[3]), 4);
+	result.append(reinterpret_cast<const char*>(&vendor[2]), 4);
+
+	if (has_avx2())
+	{
+		result += " | AVX2";
+	}
+	else if (has_avx())
+	{
+		result += " | AVX";
+	}
+
+	if (has_aes())
+	{
+		result += has_vaes() ? " | VAES" : " | AES";
+	}
+
+	if (has_sha())
+	{
+		result += " | SHA";
+	}
+
+	return result;
+}
+
+#ifdef __linux__
+static std::string read_sysfs(const std::string& path)
+{
+	fs::file file(path);
+
+	if (!file)
+	{
+		return {};
+	}
+
+	// Reported size of sysfs files is unreliable
+	std::string result(256, '\0');
+	result.resize(file.read(&result[0], result.size()));
+
+	while (!result.empty() && (result.back() == '\n' || result.back() == ' '))
+	{
+		result.pop_back();
+	}
+
+	return result;
+}
+#endif
+
+const std::vector<utils::cpu_topology_entry>& utils::get_cpu_topology()
+{
+	static const std::vector<cpu_topology_entry> g_value = []
+	{
+		std::vector<cpu_topology_entry> result;
+
+#ifdef _WIN32
+		DWORD_PTR process_mask, system_mask;
+
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+		{
+			process_mask = 1;
+		}
+
+		std::map<u32, u32> packages, cores, caches;
+
+		DWORD size = 0;
+		GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+		std::vector<u8> buffer(size);
+
+		if (size && GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &size))
+		{
+			u32 package_index = 0, core_index = 0, cache_index = 0;
+
+			for (DWORD pos = 0; pos < size;)
+			{
+				const auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + pos);
+				pos += info->Size;
+
+				// Only the first processor group is handled (up to 64 logical processors)
+				const auto assign = [](std::map<u32, u32>& map, const GROUP_AFFINITY& group, u32 index)
+				{
+					for (u32 i = 0; group.Group == 0 && i < sizeof(KAFFINITY) * 8; i++)
+					{
+						if (group.Mask & (KAFFINITY{1} << i))
+						{
+							map[i] = index;
+						}
+					}
+				};
+
+				switch (info->Relationship)
+				{
+				case RelationProcessorPackage: assign(packages, info->Processor.GroupMask[0], package_index++); break;
+				case RelationProcessorCore: assign(cores, info->Processor.GroupMask[0], core_index++); break;
+				case RelationCache: if (info->Cache.Level == 3) assign(caches, info->Cache.GroupMask, cache_index++); break;
+				default: break;
+				}
+			}
+		}
+
+		for (u32 i = 0; i < sizeof(DWORD_PTR) * 8; i++)
+		{
+			if (process_mask & (DWORD_PTR{1} << i))
+			{
+				const auto core = cores.find(i);
+				const auto package = packages.find(i);
+				const auto cache = caches.find(i);
+
+				cpu_topology_entry entry;
+				entry.cpu = i;
+				entry.package = package != packages.end() ? package->second : 0;
+				entry.core = core != cores.end() ? core->second : 0x10000 + i;
+				entry.cache = cache != caches.end() ? cache->second : 0x10000 + entry.package;
+				result.emplace_back(entry);
+			}
+		}
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+
+		// Affinity of the main thread (process affinity), not of the calling thread which may be already bound
+		if (sched_getaffinity(getpid(), sizeof(set), &set) != 0)
+		{
+			CPU_SET(0, &set);
+		}
+
+		// Map (package, core_id) pairs and cache groups (identified by the shared processor list) to unique indices
+		std::map<std::pair<u32, u32>, u32> cores;
+		std::map<std::string, u32> caches;
+
+		for (u32 i = 0; i < CPU_SETSIZE; i++)
+		{
+			if (!CPU_ISSET(i, &set))
+			{
+				continue;
+			}
+
+			const std::string path = fmt::format("/sys/devices/system/cpu/cpu%u/", i);
+			const std::string package = read_sysfs(path + "topology/physical_package_id");
+			const std::string core = read_sysfs(path + "topology/core_id");
+
+			// Find the last level cache
+			std::string cache;
+
+			for (u32 level = 0, index = 0; index < 16; index++)
+			{
+				const std::string index_path = fmt::format("%scache/index%u/", path, index);
+				const std::string level_str = read_sysfs(index_path + "level");
+
+				if (level_str.empty())
+				{
+					break;
+				}
+
+				if (read_sysfs(index_path + "type") != "Instruction" && std::stoul(level_str) > level)
+				{
+					level = std::stoul(level_str);
+					cache = read_sysfs(index_path + "shared_cpu_list");
+				}
+			}
+
+			cpu_topology_entry entry;
+			entry.cpu = i;
+			entry.package = package.empty() ? 0 : std::stoul(package);
+			entry.core = core.empty() ? 0x10000 + i : cores.emplace(std::make_pair(entry.package, std::stoul(core)), ::size32(cores)).first->second;
+			entry.cache = caches.emplace(cache.empty() ? fmt::format("package%u", entry.package) : cache, ::size32(caches)).first->second;
+			result.emplace_back(entry);
+		}
+#endif
+
+		if (result.empty())
+		{
+			// Unknown topology
+			for (u32 i = 0, count = std::max(1u, std::thread::hardware_concurrency()); i < count; i++)
+			{
+				result.emplace_back(cpu_topology_entry{i, 0, i, 0});
+			}
+		}
+
+		return result;
+	}();
+
+	return g_value;
+}
+
+std::string utils::format_cpu_list(const std::vector<u32>& cpus)
+{
+	std::vector<u32> sorted = cpus;
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	std::string result;
+
+	for (std::size_t i = 0; i < sorted.size();)
+	{
+		std::size_t j = i + 1;
+
+		while (j < sorted.size() && sorted[j] == sorted[j - 1] + 1)
+		{
+			j++;
+		}
+
+		if (!result.empty())
+		{
+			result += ',';
+		}
+
+		result += j - i > 1 ? fmt::format("%u-%u", sorted[i], sorted[j - 1]) : fmt::format("%u", sorted[i]);
+		i = j;
+	}
+
+	return result;
+}
+
+bool utils::parse_cpu_list(const std::string& str, std::vector<u32>& cpus)
+{
+	std::vector<u32> result;
+
+	for (const auto& part : fmt::split(str, {","}))
+	{
+		const auto range = fmt::split(part, {"-"}, false);
+
+		if (range.empty() || range.size() > 2)
+		{
+			return false;
+		}
+
+		u32 bounds[2];
+
+		for (std::size_t i = 0; i < range.size(); i++)
+		{
+			const std::string value = fmt::trim(range[i]);
+
+			if (value.empty() || value.size() > 4 || value.find_first_not_of("0123456789") != std::string::npos)
+			{
+				return false;
+			}
+
+			bounds[i] = std::stoul(value);
+		}
+
+		if (range.size() == 1)
+		{
+			bounds[1] = bounds[0];
+		}
+
+		if (bounds[0] > bounds[1])
+		{
+			return false;
+		}
+
+		for (u32 i = bounds[0]; i <= bounds[1]; i++)
+		{
+			result.push_back(i);
+		}
+	}
+
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	cpus = std::move(result);
+	return true;
+}
+
+bool utils::set_thread_affinity(const std::vector<u32>& cpus)
+{
+#ifdef _WIN32
+	DWORD_PTR mask = 0, system_mask;
+
+	if (cpus.empty())
+	{
+		GetProcessAffinityMask(GetCurrentProcess(), &mask, &system_mask);
+	}
+
+	for (u32 cpu : cpus)
+	{
+		if (cpu < sizeof(DWORD_PTR) * 8)
+		{
+			mask |= DWORD_PTR{1} << cpu;
+		}
+	}
+
+	return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	if (cpus.empty())
+	{
+		for (const auto& entry : get_cpu_topology())
+		{
+			CPU_SET(entry.cpu, &set);
+		}
+	}
+
+	for (u32 cpu : cpus)
+	{
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &set);
+		}
+	}
+
+	return CPU_COUNT(&set) && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	// Not supported
+	return cpus.empty();
+#endif
+}
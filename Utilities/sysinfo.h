@@ -0,0 +1,51 @@
+#pragma once
+
+#include "types.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace utils
+{
+	std::array<u32, 4> get_cpuid(u32 func, u32 subfunc);
+
+	u64 get_xgetbv(u32 xcr);
+
+	bool has_ssse3();
+
+	bool has_sse41();
+
+	bool has_avx();
+
+	bool has_avx2();
+
+	bool has_aes();
+
+	bool has_vaes();
+
+	bool has_sha();
+
+	std::string get_system_info();
+
+	// Host logical processor
+	struct cpu_topology_entry
+	{
+		u32 cpu; // Logical processor index
+		u32 package; // Physical package (socket)
+		u32 core; // Physical core (unique index, shared by SMT siblings)
+		u32 cache; // Last level cache group (unique index, e.g. CCX)
+	};
+
+	// Get logical processors available to the process (falls back to one core per processor if the topology is unknown)
+	const std::vector<cpu_topology_entry>& get_cpu_topology();
+
+	// Format the list of logical processors (like "0-3,8")
+	std::string format_cpu_list(const std::vector<u32>& cpus);
+
+	// Parse the list of logical processors (like "0-3,8"), returns false on syntax error
+	bool parse_cpu_list(const std::string& str, std::vector<u32>& cpus);
+
+	// Bind the current thread to the logical processors (empty list: all processors available to the process)
+	bool set_thread_affinity(const std::vector<u32>& cpus);
+}
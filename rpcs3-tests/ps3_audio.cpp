@@ -0,0 +1,121 @@
+#include "stdafx.h"
+#include "Emu/Cell/Modules/cellAudio.h"
+
+#include <chrono>
+#include <random>
+
+// Compare the AVX and SSE audio mixers and measure the mixing cost for 1-8 ports
+TEST_CLASS(audio_mixer)
+{
+	// Port blocks: even ports are stereo, odd ports are 7.1
+	static std::vector<be_t<f32>> random_ports()
+	{
+		std::mt19937 rng(AUDIO_SAMPLES);
+		std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+		std::vector<be_t<f32>> result(8 * AUDIO_SAMPLES * AUDIO_PORT_COUNT);
+
+		for (auto& v : result)
+		{
+			v = dist(rng);
+		}
+
+		return result;
+	}
+
+	// Volume ramp (as produced by cellAudioSetPortLevel)
+	static std::vector<float> ramp_levels()
+	{
+		std::vector<float> result(AUDIO_SAMPLES);
+
+		for (u32 i = 0; i < AUDIO_SAMPLES; i++)
+		{
+			result[i] = 0.5f + i / 512.f;
+		}
+
+		return result;
+	}
+
+	static void mix(u32 out_ch, u32 ports, const std::vector<be_t<f32>>& in, const float* levels, float* out, s16* out16)
+	{
+		for (u32 n = 0; n < ports; n++)
+		{
+			audio_mix_block(out_ch, n % 2 ? 8 : 2, out, n + 1 == ports ? out16 : nullptr, in.data() + n * 8 * AUDIO_SAMPLES, levels, n == 0);
+		}
+	}
+
+	// Mix blocks for at least 200 ms, returns blocks per second
+	static double measure(u32 out_ch, u32 ports, bool convert)
+	{
+		const auto in = random_ports();
+		const auto levels = ramp_levels();
+		std::vector<float> out(8 * AUDIO_SAMPLES);
+		std::vector<s16> out16(8 * AUDIO_SAMPLES);
+
+		const auto start = std::chrono::steady_clock::now();
+		u64 blocks = 0;
+		double elapsed;
+
+		do
+		{
+			mix(out_ch, ports, in, levels.data(), out.data(), convert ? out16.data() : nullptr);
+			blocks++;
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		while (elapsed < 0.2);
+
+		return blocks / elapsed;
+	}
+
+	TEST_METHOD_CLEANUP(cleanup)
+	{
+		audio_mix_set_avx(true);
+	}
+
+	// Both mixers must give identical output for every layout
+	TEST_METHOD(mix_differential)
+	{
+		const auto in = random_ports();
+		const auto levels = ramp_levels();
+
+		for (u32 out_ch : {2, 8})
+		{
+			for (u32 ports = 1; ports <= AUDIO_PORT_COUNT; ports++)
+			{
+				std::vector<float> out[2];
+				std::vector<s16> out16[2];
+
+				for (int avx = 0; avx < 2; avx++)
+				{
+					audio_mix_set_avx(avx != 0);
+					out[avx].assign(8 * AUDIO_SAMPLES, 0.0f);
+					out16[avx].assign(8 * AUDIO_SAMPLES, 0);
+					mix(out_ch, ports, in, levels.data(), out[avx].data(), out16[avx].data());
+				}
+
+				if (out[0] != out[1] || out16[0] != out16[1])
+				{
+					TEST_FAILURE("Output mismatch (out_ch=%u, ports=%u)", out_ch, ports);
+				}
+			}
+		}
+	}
+
+	TEST_METHOD(mix_throughput)
+	{
+		// Blocks per second consumed in real time (48000 Hz)
+		const double realtime = 48000. / AUDIO_SAMPLES;
+
+		for (u32 out_ch : {2, 8})
+		{
+			for (u32 ports = 1; ports <= AUDIO_PORT_COUNT; ports++)
+			{
+				audio_mix_set_avx(false);
+				const double sse = measure(out_ch, ports, true);
+				audio_mix_set_avx(true);
+				const double avx = measure(out_ch, ports, true);
+
+				TEST_LOG("%uch output, %u port(s): SSE %.0f blocks/s (%.3f%% of a core), AVX %.0f blocks/s (%.3f%% of a core)\n", out_ch, ports, sse, realtime / sse * 100, avx, realtime / avx * 100);
+			}
+		}
+	}
+};
@@ -0,0 +1,60 @@
+#include "stdafx.h"
+#include "Emu/Cell/Modules/cellFs.h"
+
+#include <chrono>
+#include <thread>
+
+// cellFsSt* streaming state
+TEST_CLASS(fs_stream)
+{
+	// cellFsStReadFinish must release a thread blocked in cellFsStReadWait
+	TEST_METHOD(finish_while_waiting)
+	{
+		CellFsRingBuffer ringbuf{};
+		ringbuf.ringbuf_size = 0x10000;
+		ringbuf.block_size = 0x1000;
+		ringbuf.transfer_rate = 0;
+		ringbuf.copy = CELL_FS_ST_COPY;
+
+		// No file, no ring buffer allocation and no stream thread
+		const auto st = std::make_shared<fs_st_stream>(3, nullptr, nullptr, ringbuf, 0);
+		st->progress = true;
+
+		// Shared with the waiter, which may outlive this test on failure
+		const auto result = std::make_shared<atomic_t<int>>(-1);
+
+		thread_ctrl::spawn("FS ST Waiter", [st, result]
+		{
+			*result = st->wait(0x1000) ? 1 : 0;
+		});
+
+		// Wait until the waiter is registered
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(st->mutex);
+
+				if (!st->waiters.empty())
+				{
+					break;
+				}
+			}
+
+			std::this_thread::yield();
+		}
+
+		st->stop();
+
+		const auto start = std::chrono::steady_clock::now();
+
+		while (*result == -1 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if (*result != 0)
+		{
+			TEST_FAILURE("cellFsStReadWait was not released (result=%d)", result->load());
+		}
+	}
+};
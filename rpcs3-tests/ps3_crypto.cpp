@@ -0,0 +1,232 @@
+#include "stdafx.h"
+#include "Crypto/aes.h"
+#include "Crypto/aesni.h"
+#include "Crypto/sha1.h"
+#include "Crypto/unedat.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+// Compare the accelerated crypto paths with the software implementation and measure their throughput, check the EDAT block cache
+TEST_CLASS(crypto)
+{
+	static std::vector<u8> random_data(std::size_t size)
+	{
+		std::mt19937 rng(size);
+		std::vector<u8> result(size);
+
+		for (auto& v : result)
+		{
+			v = static_cast<u8>(rng());
+		}
+
+		return result;
+	}
+
+	// Run the function for at least 200 ms, returns MB/s
+	template <typename F>
+	static double measure(std::size_t size, F&& func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		std::size_t total = 0;
+		double elapsed;
+
+		do
+		{
+			func();
+			total += size;
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		while (elapsed < 0.2);
+
+		return total / elapsed / 1000000.;
+	}
+
+	// Run the function with the software and the accelerated paths
+	template <typename F>
+	static void compare(const char* name, std::size_t size, F&& func)
+	{
+		aesni_set_enabled(false);
+		const double sw = measure(size, func);
+		aesni_set_enabled(true);
+		const double hw = measure(size, func);
+
+		TEST_LOG("%s: software %.0f MB/s, accelerated %.0f MB/s (x%.1f)\n", name, sw, hw, hw / sw);
+	}
+
+	TEST_METHOD_CLEANUP(cleanup)
+	{
+		aesni_set_enabled(true);
+	}
+
+	// Accelerated and software paths must give identical output (including partial CTR blocks)
+	TEST_METHOD(aes_sha1_differential)
+	{
+		const auto input = random_data(0x10000 + 13);
+		const auto key = random_data(32);
+
+		for (u32 bits : {128, 192, 256})
+		{
+			for (std::size_t length : {std::size_t{16}, std::size_t{0x1000}, input.size() - 13})
+			{
+				std::vector<u8> result[2];
+
+				for (int hw = 0; hw < 2; hw++)
+				{
+					aesni_set_enabled(hw != 0);
+
+					aes_context enc, dec;
+					aes_setkey_enc(&enc, key.data(), bits);
+					aes_setkey_dec(&dec, key.data(), bits);
+
+					std::vector<u8> out(length * 4 + 13 + 20);
+					u8 iv[16]{};
+
+					aes_crypt_cbc(&enc, AES_ENCRYPT, length, iv, input.data(), out.data());
+					std::memset(iv, 0, sizeof(iv));
+					aes_crypt_cbc(&dec, AES_DECRYPT, length, iv, input.data(), out.data() + length);
+
+					for (std::size_t i = 0; i < length; i += 16)
+					{
+						aes_crypt_ecb(&dec, AES_DECRYPT, input.data() + i, out.data() + length * 2 + i);
+					}
+
+					u8 nonce[16]{0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0};
+					u8 stream[16]{};
+					size_t offset = 0;
+					aes_crypt_ctr(&enc, length + 13, &offset, nonce, stream, input.data(), out.data() + length * 3);
+
+					sha1(input.data(), length + 13, out.data() + length * 4 + 13);
+
+					result[hw] = std::move(out);
+				}
+
+				if (result[0] != result[1])
+				{
+					TEST_FAILURE("Output mismatch (AES-%u, length=0x%x)", bits, length);
+				}
+			}
+		}
+	}
+
+	TEST_METHOD(aes_sha1_throughput)
+	{
+		const std::size_t size = 1 << 20;
+		const auto input = random_data(size);
+		std::vector<u8> output(size);
+
+		aes_context enc, dec;
+		aes_setkey_enc(&enc, input.data(), 128);
+		aes_setkey_dec(&dec, input.data(), 128);
+
+		compare("AES-128 CTR", size, [&]
+		{
+			u8 nonce[16]{}, stream[16]{};
+			size_t offset = 0;
+			aes_crypt_ctr(&enc, size, &offset, nonce, stream, input.data(), output.data());
+		});
+
+		compare("AES-128 CBC decrypt", size, [&]
+		{
+			u8 iv[16]{};
+			aes_crypt_cbc(&dec, AES_DECRYPT, size, iv, input.data(), output.data());
+		});
+
+		compare("AES-128 CBC encrypt", size, [&]
+		{
+			u8 iv[16]{};
+			aes_crypt_cbc(&enc, AES_ENCRYPT, size, iv, input.data(), output.data());
+		});
+
+		compare("AES-128 ECB (per block)", size, [&]
+		{
+			for (std::size_t i = 0; i < size; i += 16)
+			{
+				aes_crypt_ecb(&enc, AES_ENCRYPT, input.data() + i, output.data() + i);
+			}
+		});
+
+		compare("SHA-1", size, [&]
+		{
+			sha1(input.data(), size, output.data());
+		});
+
+		compare("HMAC-SHA1", size, [&]
+		{
+			sha1_hmac(input.data(), 16, input.data(), size, output.data());
+		});
+	}
+
+	// Unencrypted SDAT (debug data flag) with the given contents
+	static fs::file make_sdat(const std::vector<u8>& data, u32 block_size)
+	{
+		const u32 blocks = static_cast<u32>((data.size() + block_size - 1) / block_size);
+		std::vector<u8> file(0x100 + blocks * 0x10 + data.size());
+
+		std::memcpy(file.data(), "NPD", 4);
+		*reinterpret_cast<be_t<u32>*>(&file[0x04]) = 2; // version
+		*reinterpret_cast<be_t<u32>*>(&file[0x80]) = SDAT_FLAG | EDAT_DEBUG_DATA_FLAG;
+		*reinterpret_cast<be_t<u32>*>(&file[0x84]) = block_size;
+		*reinterpret_cast<be_t<u64>*>(&file[0x88]) = data.size();
+		std::memcpy(file.data() + 0x100 + blocks * 0x10, data.data(), data.size());
+
+		return fs::make_stream(std::move(file));
+	}
+
+	// Two threads reading the same blocks must not decrypt and insert a block twice
+	TEST_METHOD(edat_concurrent_reads)
+	{
+		const u32 block_size = 0x400;
+		const auto input = random_data(block_size * 64 - 5);
+
+		for (u32 round = 0; round < 100; round++)
+		{
+			EDATADecrypter edat(make_sdat(input, block_size));
+
+			if (!edat.ReadHeader())
+			{
+				TEST_FAILURE("Invalid SDAT header");
+			}
+
+			atomic_t<u32> ready{0};
+			atomic_t<u32> errors{0};
+
+			const auto reader = [&]
+			{
+				std::vector<u8> output(block_size);
+
+				for (ready++; ready < 2;)
+				{
+					std::this_thread::yield();
+				}
+
+				for (u64 pos = 0; pos < input.size(); pos += block_size)
+				{
+					const u64 size = std::min<u64>(block_size, input.size() - pos);
+
+					if (edat.ReadData(pos, output.data(), size) != size || std::memcmp(output.data(), input.data() + pos, size))
+					{
+						errors++;
+					}
+				}
+			};
+
+			std::thread thread(reader);
+			reader();
+			thread.join();
+
+			if (errors)
+			{
+				TEST_FAILURE("Read mismatch (round %u)", round);
+			}
+
+			std::lock_guard<std::mutex> lock(edat.m_cache_mutex);
+
+			if (edat.m_lru.size() != edat.m_cache.size())
+			{
+				TEST_FAILURE("Duplicate cache entries (round %u, %u LRU nodes, %u blocks)", round, edat.m_lru.size(), edat.m_cache.size());
+			}
+		}
+	}
+};
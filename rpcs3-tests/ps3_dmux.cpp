@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "Emu/Cell/Modules/cellPamf.h"
+#include "Emu/Cell/Modules/cellDmux.h"
+
+#include <chrono>
+
+// Measure the PAMF stream indexer and the payload delivery on a synthetic stream
+TEST_CLASS(dmux_stream)
+{
+	static constexpr u32 pack_size = 2048;
+	static constexpr u32 pack_count = 0x4000; // 32 MB
+
+	// Pack header, PES packet with PTS (and DTS for video), every 8th packet is ATRAC3+ audio
+	static std::vector<u8> make_stream()
+	{
+		std::vector<u8> result(pack_size * pack_count);
+
+		for (u32 i = 0; i < pack_count; i++)
+		{
+			u8* pack = result.data() + i * pack_size;
+			const bool audio = i % 8 == 7;
+			const u32 len = pack_size - 14 - 6;
+
+			const u8 pack_header[14] = {0x00, 0x00, 0x01, 0xba, 0x44, 0x00, 0x04, 0x00, 0x04, 0x01, 0x01, 0x89, 0xc3, 0xf8};
+			std::memcpy(pack, pack_header, sizeof(pack_header));
+
+			u8* pes = pack + 14;
+			pes[0] = 0x00;
+			pes[1] = 0x00;
+			pes[2] = 0x01;
+			pes[3] = audio ? 0xbd : 0xe0;
+			pes[4] = len >> 8;
+			pes[5] = len & 0xff;
+			pes[6] = 0x81;
+			pes[7] = audio ? 0x80 : 0xc0;
+			pes[8] = audio ? 5 : 10;
+
+			// PTS (and DTS) marker bytes
+			const u8 ts[5] = {0x21, 0x00, 0x01, 0x00, 0x01};
+			std::memcpy(pes + 9, ts, 5);
+
+			if (audio)
+			{
+				// fid_minor
+				pes[14] = 0x00;
+			}
+			else
+			{
+				pes[9] = 0x31;
+				pes[14] = 0x11;
+				std::memcpy(pes + 15, ts + 1, 4);
+			}
+
+			// Payload
+			for (u32 j = audio ? 15 : 19; j < len + 6; j++)
+			{
+				pes[j] = static_cast<u8>(i + j);
+			}
+		}
+
+		return result;
+	}
+
+	// Run the function for at least 200 ms, returns runs per second
+	template <typename F>
+	static double measure(F&& func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		u64 runs = 0;
+		double elapsed;
+
+		do
+		{
+			func();
+			runs++;
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		while (elapsed < 0.2);
+
+		return runs / elapsed;
+	}
+
+	TEST_METHOD(index_throughput)
+	{
+		const auto stream = make_stream();
+		const u32 base = 0x10000000;
+
+		std::vector<DemuxerPacket> index;
+		dmux_index_stream(stream.data(), ::size32(stream), base, index);
+
+		if (index.size() != pack_count)
+		{
+			TEST_FAILURE("Packet count mismatch (%u)", ::size32(index));
+		}
+
+		for (u32 i = 0; i < pack_count; i++)
+		{
+			const auto& pkt = index[i];
+			const bool audio = i % 8 == 7;
+
+			// Video packets are delivered with the PES header, audio packets without the header and fid_minor
+			const u32 addr = base + i * pack_size + (audio ? 14 + 15 : 14);
+
+			if (pkt.code != (audio ? +PRIVATE_STREAM_1 : 0x1e0) || pkt.addr != addr || pkt.size != base + (i + 1) * pack_size - addr || !pkt.has_ts)
+			{
+				TEST_FAILURE("Packet %u mismatch (code=0x%x, addr=0x%x, size=0x%x)", i, pkt.code, pkt.addr, pkt.size);
+			}
+		}
+
+		const double indexing = measure([&]
+		{
+			index.clear();
+			dmux_index_stream(stream.data(), ::size32(stream), base, index);
+		});
+
+		// Copy every payload to an ES-sized buffer (as the demuxer thread does for each AU)
+		std::vector<u8> es(0x100000);
+
+		const double delivery = measure([&]
+		{
+			u32 pos = 0;
+
+			for (const auto& pkt : index)
+			{
+				if (pos + pkt.size > es.size())
+				{
+					pos = 0;
+				}
+
+				std::memcpy(es.data() + pos, stream.data() + (pkt.addr - base), pkt.size);
+				pos += pkt.size;
+			}
+		});
+
+		const double mb = stream.size() / 1000000.;
+
+		TEST_LOG("Indexing: %.0f MB/s (%.1fM packets/s), delivery: %.0f MB/s\n", indexing * mb, indexing * pack_count / 1000000., delivery * mb);
+	}
+};
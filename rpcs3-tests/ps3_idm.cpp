@@ -0,0 +1,133 @@
+#include "stdafx.h"
+#include "Emu/IdManager.h"
+
+#include <chrono>
+#include <thread>
+
+// Object looked up by the benchmark
+struct idm_test_object
+{
+	static const u32 id_base = 1;
+	static const u32 id_step = 1;
+	static const u32 id_count = 1024;
+
+	atomic_t<u32> value{0x1234};
+
+	~idm_test_object()
+	{
+		value = 0;
+	}
+};
+
+// Measure idm lookups from several threads (with and without concurrent removal)
+TEST_CLASS(id_manager_lookup)
+{
+	static constexpr u32 object_count = 64;
+
+	// Run the lookup function on the threads for 200 ms while another thread optionally recreates IDs, returns millions of lookups per second
+	template <typename F>
+	static double measure(u32 threads, bool churn, atomic_t<u32>& errors, F&& func)
+	{
+		atomic_t<bool> stop{false};
+		atomic_t<u64> total{0};
+
+		std::vector<std::thread> workers;
+
+		for (u32 i = 0; i < threads; i++)
+		{
+			workers.emplace_back([&, i]
+			{
+				u64 count = 0;
+
+				for (u32 id = 1 + i; !stop; id = id % object_count + 1)
+				{
+					if (!func(id))
+					{
+						errors++;
+					}
+
+					count++;
+				}
+
+				total += count;
+			});
+		}
+
+		if (churn)
+		{
+			workers.emplace_back([&]
+			{
+				for (u32 id = 1; !stop; id = id % object_count + 1)
+				{
+					// IDs are allocated from the lowest free one, so the removed ID is reused
+					idm::remove<idm_test_object>(id);
+					idm::make<idm_test_object>();
+				}
+			});
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		stop = true;
+
+		for (auto& thread : workers)
+		{
+			thread.join();
+		}
+
+		return total / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 1000000.;
+	}
+
+	TEST_METHOD_CLEANUP(cleanup)
+	{
+		idm::clear();
+	}
+
+	TEST_METHOD(lookup_contention)
+	{
+		idm::init();
+
+		for (u32 i = 0; i < object_count; i++)
+		{
+			idm::make<idm_test_object>();
+		}
+
+		for (bool churn : {false, true})
+		{
+			for (u32 threads : {1, 2, 4, 8})
+			{
+				// Looked up objects must be alive (missing IDs are expected while they are recreated)
+				atomic_t<u32> errors{0};
+
+				const double locked = measure(threads, churn, errors, [](u32 id)
+				{
+					const auto ptr = idm::get<idm_test_object>(id, [](idm_test_object&) {});
+					return !ptr || ptr->value == 0x1234;
+				});
+
+				const double get = measure(threads, churn, errors, [](u32 id)
+				{
+					const auto ptr = idm::get<idm_test_object>(id);
+					return !ptr || ptr->value == 0x1234;
+				});
+
+				const double borrow = measure(threads, churn, errors, [](u32 id)
+				{
+					const auto ptr = idm::borrow<idm_test_object>(id, [](idm_test_object& obj)
+					{
+						return obj.value == 0x1234;
+					});
+
+					return !ptr || ptr.ret;
+				});
+
+				TEST_LOG("%u thread(s)%s: locked get %.1f M/s, lock-free get %.1f M/s, borrow %.1f M/s\n", threads, churn ? " with removal" : "", locked, get, borrow);
+
+				if (errors)
+				{
+					TEST_FAILURE("%u lookups returned a destroyed object (threads=%u, churn=%d)", errors.load(), threads, churn);
+				}
+			}
+		}
+	}
+};
@@ -30,6 +30,7 @@
  */
 
 #include "aes.h"
+#include "aesni.h"
 
 /*
  * 32-bit integer manipulation macros (little endian)
@@ -643,6 +644,12 @@ int aes_crypt_ecb( aes_context *ctx,
     int i;
     uint32_t *RK, X0, X1, X2, X3, Y0, Y1, Y2, Y3;
 
+    if( aesni_supported() )
+    {
+        aesni_crypt_ecb( ctx, mode, 1, input, output );
+        return( 0 );
+    }
+
     RK = ctx->rk;
 
     GET_UINT32_LE( X0, input,  0 ); X0 ^= *RK++;
@@ -743,6 +750,12 @@ int aes_crypt_cbc( aes_context *ctx,
     if( length % 16 )
         return( POLARSSL_ERR_AES_INVALID_INPUT_LENGTH );
 
+    if( aesni_supported() )
+    {
+        aesni_crypt_cbc( ctx, mode, length / 16, iv, input, output );
+        return( 0 );
+    }
+
     if( mode == AES_DECRYPT )
     {
         while( length > 0 )
@@ -839,6 +852,18 @@ int aes_crypt_ctr( aes_context *ctx,
     int c, i;
     size_t n = *nc_off;
 
+    /* Process whole blocks at once when the stream is block-aligned */
+    if( n == 0 && length >= 16 && aesni_supported() )
+    {
+        const size_t blocks = length / 16;
+
+        aesni_crypt_ctr( ctx, blocks, nonce_counter, input, output );
+
+        input  += blocks * 16;
+        output += blocks * 16;
+        length -= blocks * 16;
+    }
+
     while( length-- )
     {
         if( n == 0 ) {
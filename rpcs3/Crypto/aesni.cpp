@@ -0,0 +1,472 @@
+#include "aesni.h"
+#include "utils.h"
+#include "../../Utilities/sysinfo.h"
+
+#include <immintrin.h>
+#include <cstring>
+
+#ifdef _MSC_VER
+#define AESNI_TARGET
+#define VAES_TARGET
+#define SHANI_TARGET
+#else
+#define AESNI_TARGET __attribute__((target("aes,ssse3")))
+#define VAES_TARGET __attribute__((target("vaes,avx2,aes")))
+#define SHANI_TARGET __attribute__((target("sha,sse4.1")))
+#endif
+
+static bool s_enabled = true;
+
+void aesni_set_enabled(bool enabled)
+{
+	s_enabled = enabled;
+}
+
+bool aesni_supported()
+{
+	return s_enabled && utils::has_aes();
+}
+
+bool shani_supported()
+{
+	return s_enabled && utils::has_sha();
+}
+
+// Amount of blocks processed in parallel (hides aesenc latency)
+static constexpr size_t s_lanes = 8;
+
+AESNI_TARGET static inline __m128i aesni_encrypt(const __m128i* rk, int nr, __m128i b)
+{
+	b = _mm_xor_si128(b, _mm_loadu_si128(rk));
+
+	for (int r = 1; r < nr; r++)
+	{
+		b = _mm_aesenc_si128(b, _mm_loadu_si128(rk + r));
+	}
+
+	return _mm_aesenclast_si128(b, _mm_loadu_si128(rk + nr));
+}
+
+AESNI_TARGET static inline __m128i aesni_decrypt(const __m128i* rk, int nr, __m128i b)
+{
+	b = _mm_xor_si128(b, _mm_loadu_si128(rk));
+
+	for (int r = 1; r < nr; r++)
+	{
+		b = _mm_aesdec_si128(b, _mm_loadu_si128(rk + r));
+	}
+
+	return _mm_aesdeclast_si128(b, _mm_loadu_si128(rk + nr));
+}
+
+// Encrypt or decrypt s_lanes blocks at once
+template <bool Decrypt>
+AESNI_TARGET static inline void aesni_crypt_lanes(const __m128i* rk, int nr, __m128i (&b)[s_lanes])
+{
+	const __m128i k0 = _mm_loadu_si128(rk);
+
+	for (size_t i = 0; i < s_lanes; i++)
+	{
+		b[i] = _mm_xor_si128(b[i], k0);
+	}
+
+	for (int r = 1; r < nr; r++)
+	{
+		const __m128i k = _mm_loadu_si128(rk + r);
+
+		for (size_t i = 0; i < s_lanes; i++)
+		{
+			b[i] = Decrypt ? _mm_aesdec_si128(b[i], k) : _mm_aesenc_si128(b[i], k);
+		}
+	}
+
+	const __m128i kl = _mm_loadu_si128(rk + nr);
+
+	for (size_t i = 0; i < s_lanes; i++)
+	{
+		b[i] = Decrypt ? _mm_aesdeclast_si128(b[i], kl) : _mm_aesenclast_si128(b[i], kl);
+	}
+}
+
+AESNI_TARGET void aesni_crypt_ecb(const aes_context* ctx, int mode, size_t blocks, const unsigned char* input, unsigned char* output)
+{
+	const auto rk = reinterpret_cast<const __m128i*>(ctx->rk);
+	const auto in = reinterpret_cast<const __m128i*>(input);
+	const auto out = reinterpret_cast<__m128i*>(output);
+
+	size_t i = 0;
+
+	for (; i + s_lanes <= blocks; i += s_lanes)
+	{
+		__m128i b[s_lanes];
+
+		for (size_t j = 0; j < s_lanes; j++)
+		{
+			b[j] = _mm_loadu_si128(in + i + j);
+		}
+
+		if (mode == AES_DECRYPT)
+		{
+			aesni_crypt_lanes<true>(rk, ctx->nr, b);
+		}
+		else
+		{
+			aesni_crypt_lanes<false>(rk, ctx->nr, b);
+		}
+
+		for (size_t j = 0; j < s_lanes; j++)
+		{
+			_mm_storeu_si128(out + i + j, b[j]);
+		}
+	}
+
+	for (; i < blocks; i++)
+	{
+		const __m128i b = _mm_loadu_si128(in + i);
+		_mm_storeu_si128(out + i, mode == AES_DECRYPT ? aesni_decrypt(rk, ctx->nr, b) : aesni_encrypt(rk, ctx->nr, b));
+	}
+}
+
+AESNI_TARGET void aesni_crypt_cbc(const aes_context* ctx, int mode, size_t blocks, unsigned char iv[16], const unsigned char* input, unsigned char* output)
+{
+	const auto rk = reinterpret_cast<const __m128i*>(ctx->rk);
+	const auto in = reinterpret_cast<const __m128i*>(input);
+	const auto out = reinterpret_cast<__m128i*>(output);
+
+	__m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+	if (mode != AES_DECRYPT)
+	{
+		// Encryption is inherently serial
+		for (size_t i = 0; i < blocks; i++)
+		{
+			prev = aesni_encrypt(rk, ctx->nr, _mm_xor_si128(_mm_loadu_si128(in + i), prev));
+			_mm_storeu_si128(out + i, prev);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(iv), prev);
+		return;
+	}
+
+	size_t i = 0;
+
+	for (; i + s_lanes <= blocks; i += s_lanes)
+	{
+		// Load all ciphertext blocks first (input and output may alias)
+		__m128i c[s_lanes], b[s_lanes];
+
+		for (size_t j = 0; j < s_lanes; j++)
+		{
+			b[j] = c[j] = _mm_loadu_si128(in + i + j);
+		}
+
+		aesni_crypt_lanes<true>(rk, ctx->nr, b);
+
+		_mm_storeu_si128(out + i, _mm_xor_si128(b[0], prev));
+
+		for (size_t j = 1; j < s_lanes; j++)
+		{
+			_mm_storeu_si128(out + i + j, _mm_xor_si128(b[j], c[j - 1]));
+		}
+
+		prev = c[s_lanes - 1];
+	}
+
+	for (; i < blocks; i++)
+	{
+		const __m128i c = _mm_loadu_si128(in + i);
+		_mm_storeu_si128(out + i, _mm_xor_si128(aesni_decrypt(rk, ctx->nr, c), prev));
+		prev = c;
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(iv), prev);
+}
+
+// Make big-endian 128-bit counter block from native halves
+AESNI_TARGET static inline __m128i aesni_ctr_block(u64 hi, u64 lo)
+{
+	return _mm_shuffle_epi8(_mm_set_epi64x(hi, lo), _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+static inline void aesni_ctr_inc(u64& hi, u64& lo)
+{
+	if (++lo == 0)
+	{
+		hi++;
+	}
+}
+
+// 256-bit path: two blocks per register, four registers in flight
+VAES_TARGET static size_t vaes_crypt_ctr(const aes_context* ctx, size_t blocks, u64& hi, u64& lo, const unsigned char* input, unsigned char* output)
+{
+	const auto rk = reinterpret_cast<const __m128i*>(ctx->rk);
+	const auto in = reinterpret_cast<const __m256i*>(input);
+	const auto out = reinterpret_cast<__m256i*>(output);
+	const int nr = ctx->nr;
+
+	size_t i = 0;
+
+	for (; i + 8 <= blocks; i += 8)
+	{
+		__m256i b[4];
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			const __m128i c0 = aesni_ctr_block(hi, lo);
+			aesni_ctr_inc(hi, lo);
+			const __m128i c1 = aesni_ctr_block(hi, lo);
+			aesni_ctr_inc(hi, lo);
+			b[j] = _mm256_set_m128i(c1, c0);
+		}
+
+		const __m256i k0 = _mm256_broadcastsi128_si256(_mm_loadu_si128(rk));
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			b[j] = _mm256_xor_si256(b[j], k0);
+		}
+
+		for (int r = 1; r < nr; r++)
+		{
+			const __m256i k = _mm256_broadcastsi128_si256(_mm_loadu_si128(rk + r));
+
+			for (size_t j = 0; j < 4; j++)
+			{
+				b[j] = _mm256_aesenc_epi128(b[j], k);
+			}
+		}
+
+		const __m256i kl = _mm256_broadcastsi128_si256(_mm_loadu_si128(rk + nr));
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			b[j] = _mm256_aesenclast_epi128(b[j], kl);
+			_mm256_storeu_si256(out + i / 2 + j, _mm256_xor_si256(b[j], _mm256_loadu_si256(in + i / 2 + j)));
+		}
+	}
+
+	return i;
+}
+
+AESNI_TARGET void aesni_crypt_ctr(const aes_context* ctx, size_t blocks, unsigned char nonce_counter[16], const unsigned char* input, unsigned char* output)
+{
+	const auto rk = reinterpret_cast<const __m128i*>(ctx->rk);
+
+	// Load counter as native halves
+	u64 hi, lo;
+	std::memcpy(&hi, nonce_counter, 8);
+	std::memcpy(&lo, nonce_counter + 8, 8);
+	hi = swap64(hi);
+	lo = swap64(lo);
+
+	size_t i = utils::has_vaes() ? vaes_crypt_ctr(ctx, blocks, hi, lo, input, output) : 0;
+
+	const auto in = reinterpret_cast<const __m128i*>(input);
+	const auto out = reinterpret_cast<__m128i*>(output);
+
+	for (; i + s_lanes <= blocks; i += s_lanes)
+	{
+		__m128i b[s_lanes];
+
+		for (size_t j = 0; j < s_lanes; j++)
+		{
+			b[j] = aesni_ctr_block(hi, lo);
+			aesni_ctr_inc(hi, lo);
+		}
+
+		aesni_crypt_lanes<false>(rk, ctx->nr, b);
+
+		for (size_t j = 0; j < s_lanes; j++)
+		{
+			_mm_storeu_si128(out + i + j, _mm_xor_si128(b[j], _mm_loadu_si128(in + i + j)));
+		}
+	}
+
+	for (; i < blocks; i++)
+	{
+		const __m128i k = aesni_encrypt(rk, ctx->nr, aesni_ctr_block(hi, lo));
+		aesni_ctr_inc(hi, lo);
+		_mm_storeu_si128(out + i, _mm_xor_si128(k, _mm_loadu_si128(in + i)));
+	}
+
+	hi = swap64(hi);
+	lo = swap64(lo);
+	std::memcpy(nonce_counter, &hi, 8);
+	std::memcpy(nonce_counter + 8, &lo, 8);
+}
+
+SHANI_TARGET void shani_sha1_process(uint32_t state[5], size_t blocks, const unsigned char* data)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ull, 0x08090a0b0c0d0e0full);
+
+	// ABCD in reversed word order as expected by sha1rnds4
+	__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+	__m128i e1;
+
+	for (size_t n = 0; n < blocks; n++, data += 64)
+	{
+		const __m128i abcd_save = abcd;
+		const __m128i e_save = e0;
+
+		__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0)), mask);
+		__m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), mask);
+		__m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), mask);
+		__m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), mask);
+
+		// Rounds 0-3
+		e0 = _mm_add_epi32(e0, m0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		// Rounds 4-7
+		e1 = _mm_sha1nexte_epu32(e1, m1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		m0 = _mm_sha1msg1_epu32(m0, m1);
+
+		// Rounds 8-11
+		e0 = _mm_sha1nexte_epu32(e0, m2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		m1 = _mm_sha1msg1_epu32(m1, m2);
+		m0 = _mm_xor_si128(m0, m2);
+
+		// Rounds 12-15
+		e1 = _mm_sha1nexte_epu32(e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32(m0, m3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		m2 = _mm_sha1msg1_epu32(m2, m3);
+		m1 = _mm_xor_si128(m1, m3);
+
+		// Rounds 16-19
+		e0 = _mm_sha1nexte_epu32(e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32(m1, m0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		m3 = _mm_sha1msg1_epu32(m3, m0);
+		m2 = _mm_xor_si128(m2, m0);
+
+		// Rounds 20-23
+		e1 = _mm_sha1nexte_epu32(e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32(m2, m1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		m0 = _mm_sha1msg1_epu32(m0, m1);
+		m3 = _mm_xor_si128(m3, m1);
+
+		// Rounds 24-27
+		e0 = _mm_sha1nexte_epu32(e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32(m3, m2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		m1 = _mm_sha1msg1_epu32(m1, m2);
+		m0 = _mm_xor_si128(m0, m2);
+
+		// Rounds 28-31
+		e1 = _mm_sha1nexte_epu32(e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32(m0, m3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		m2 = _mm_sha1msg1_epu32(m2, m3);
+		m1 = _mm_xor_si128(m1, m3);
+
+		// Rounds 32-35
+		e0 = _mm_sha1nexte_epu32(e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32(m1, m0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		m3 = _mm_sha1msg1_epu32(m3, m0);
+		m2 = _mm_xor_si128(m2, m0);
+
+		// Rounds 36-39
+		e1 = _mm_sha1nexte_epu32(e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32(m2, m1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		m0 = _mm_sha1msg1_epu32(m0, m1);
+		m3 = _mm_xor_si128(m3, m1);
+
+		// Rounds 40-43
+		e0 = _mm_sha1nexte_epu32(e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32(m3, m2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		m1 = _mm_sha1msg1_epu32(m1, m2);
+		m0 = _mm_xor_si128(m0, m2);
+
+		// Rounds 44-47
+		e1 = _mm_sha1nexte_epu32(e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32(m0, m3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		m2 = _mm_sha1msg1_epu32(m2, m3);
+		m1 = _mm_xor_si128(m1, m3);
+
+		// Rounds 48-51
+		e0 = _mm_sha1nexte_epu32(e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32(m1, m0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		m3 = _mm_sha1msg1_epu32(m3, m0);
+		m2 = _mm_xor_si128(m2, m0);
+
+		// Rounds 52-55
+		e1 = _mm_sha1nexte_epu32(e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32(m2, m1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		m0 = _mm_sha1msg1_epu32(m0, m1);
+		m3 = _mm_xor_si128(m3, m1);
+
+		// Rounds 56-59
+		e0 = _mm_sha1nexte_epu32(e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32(m3, m2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		m1 = _mm_sha1msg1_epu32(m1, m2);
+		m0 = _mm_xor_si128(m0, m2);
+
+		// Rounds 60-63
+		e1 = _mm_sha1nexte_epu32(e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32(m0, m3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		m2 = _mm_sha1msg1_epu32(m2, m3);
+		m1 = _mm_xor_si128(m1, m3);
+
+		// Rounds 64-67
+		e0 = _mm_sha1nexte_epu32(e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32(m1, m0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		m3 = _mm_sha1msg1_epu32(m3, m0);
+		m2 = _mm_xor_si128(m2, m0);
+
+		// Rounds 68-71
+		e1 = _mm_sha1nexte_epu32(e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32(m2, m1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		m3 = _mm_xor_si128(m3, m1);
+
+		// Rounds 72-75
+		e0 = _mm_sha1nexte_epu32(e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32(m3, m2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+		// Rounds 76-79
+		e1 = _mm_sha1nexte_epu32(e1, m3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+		// Add current hash value
+		e0 = _mm_sha1nexte_epu32(e0, e_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1b));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
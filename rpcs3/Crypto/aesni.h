@@ -0,0 +1,26 @@
+#pragma once
+
+// AES-NI/VAES and SHA extensions accelerated paths for aes.cpp and sha1.cpp.
+// The round key layout of aes_context is shared with the software implementation,
+// so contexts initialized with aes_setkey_enc/aes_setkey_dec can be used directly.
+
+#include "aes.h"
+#include "sha1.h"
+
+bool aesni_supported();
+bool shani_supported();
+
+// Enable or disable the accelerated paths (tests and benchmarks compare them with the software implementation)
+void aesni_set_enabled(bool enabled);
+
+// Process `blocks` 16-byte blocks in ECB mode
+void aesni_crypt_ecb(const aes_context* ctx, int mode, size_t blocks, const unsigned char* input, unsigned char* output);
+
+// Process `blocks` 16-byte blocks in CBC mode (iv is updated)
+void aesni_crypt_cbc(const aes_context* ctx, int mode, size_t blocks, unsigned char iv[16], const unsigned char* input, unsigned char* output);
+
+// Process `blocks` 16-byte blocks in CTR mode with 128-bit big-endian counter (nonce_counter is updated)
+void aesni_crypt_ctr(const aes_context* ctx, size_t blocks, unsigned char nonce_counter[16], const unsigned char* input, unsigned char* output);
+
+// Process `blocks` 64-byte SHA-1 blocks
+void shani_sha1_process(uint32_t state[5], size_t blocks, const unsigned char* data);
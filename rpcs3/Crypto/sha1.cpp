@@ -29,6 +29,7 @@
  */
  
 #include "sha1.h"
+#include "aesni.h"
 
 /*
  * 32-bit integer manipulation macros (big endian)
@@ -72,6 +73,12 @@ void sha1_process( sha1_context *ctx, const unsigned char data[64] )
 {
     uint32_t temp, W[16], A, B, C, D, E;
 
+    if( shani_supported() )
+    {
+        shani_sha1_process( ctx->state, 1, data );
+        return;
+    }
+
     GET_UINT32_BE( W[ 0], data,  0 );
     GET_UINT32_BE( W[ 1], data,  4 );
     GET_UINT32_BE( W[ 2], data,  8 );
@@ -254,6 +261,15 @@ void sha1_update( sha1_context *ctx, const unsigned char *input, size_t ilen )
         left = 0;
     }
 
+    if( ilen >= 64 && shani_supported() )
+    {
+        const size_t blocks = ilen / 64;
+
+        shani_sha1_process( ctx->state, blocks, input );
+        input += blocks * 64;
+        ilen  -= blocks * 64;
+    }
+
     while( ilen >= 64 )
     {
         sha1_process( ctx, input );
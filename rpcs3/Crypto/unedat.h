@@ -3,9 +3,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <array>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
 
 #include "utils.h"
 
+class thread_ctrl;
+
 constexpr u32 SDAT_FLAG = 0x01000000;
 constexpr u32 EDAT_COMPRESSED_FLAG = 0x00000001;
 constexpr u32 EDAT_FLAG_0x02 = 0x00000002;
@@ -48,6 +54,14 @@ extern bool VerifyEDATHeaderWithKLicense(const fs::file& input, const std::strin
 
 extern std::array<u8, 0x10> GetEdatRifKeyFromRapFile(const fs::file& rap_file);
 
+struct edat_cache_stats
+{
+	u64 hits{0};
+	u64 misses{0};
+	u64 prefetched{0}; // Blocks decrypted by the read-ahead thread
+	u64 prefetch_hits{0}; // Prefetched blocks which were used
+};
+
 struct EDATADecrypter final : fs::file_base
 {
 	// file stream
@@ -59,15 +73,39 @@ struct EDATADecrypter final : fs::file_base
 	NPD_HEADER npdHeader;
 	EDAT_HEADER edatHeader;
 
-	// Internal data buffers.
-	std::unique_ptr<u8[]> data_buf;
-	u64 data_buf_size{0};
-
 	std::array<u8, 0x10> dec_key{};
 
 	// edat usage
 	std::array<u8, 0x10> rif_key{};
 	std::array<u8, 0x10> dev_key{};
+
+	// Decrypted block cache (LRU)
+	struct cached_block
+	{
+		std::unique_ptr<u8[]> data;
+		u64 size;
+		bool prefetched;
+		std::list<u32>::iterator lru;
+	};
+
+	std::mutex m_file_mutex; // Protects edata_file (decrypt_block seeks)
+	std::mutex m_cache_mutex;
+	std::condition_variable m_prefetch_cv;
+	std::unordered_map<u32, cached_block> m_cache;
+	std::list<u32> m_lru; // Most recently used first
+	u32 m_cache_capacity{0}; // In blocks
+	u32 m_last_block{UINT32_MAX}; // Last block accessed by ReadData (sequential access detection)
+	u32 m_prefetch_pos{0}; // Next block to read ahead
+	u32 m_prefetch_end{0};
+	bool m_prefetch_stop{false};
+	std::shared_ptr<thread_ctrl> m_prefetch_thread;
+	edat_cache_stats m_stats;
+
+	// Decrypt block and insert it into the cache (returns nullptr on error), cache mutex must be locked
+	cached_block* load_block(std::unique_lock<std::mutex>& lock, u32 block, bool prefetch);
+
+	void prefetch_task();
+
 public:
 	// SdataByFd usage
 	EDATADecrypter(fs::file&& input)
@@ -76,11 +114,13 @@ public:
 	EDATADecrypter(fs::file&& input, const std::array<u8, 0x10>& dev_key, const std::array<u8, 0x10>& rif_key)
 		: edata_file(std::move(input)), rif_key(rif_key), dev_key(dev_key) {}
 
-	~EDATADecrypter() override {}
+	~EDATADecrypter() override;
 	// false if invalid 
 	bool ReadHeader();
 	u64 ReadData(u64 pos, u8* data, u64 size);
 
+	edat_cache_stats get_cache_stats();
+
 	fs::stat_t stat() override
 	{
 		fs::stat_t stats;
@@ -4,10 +4,211 @@
 #include "sha1.h"
 #include "key_vault.h"
 #include "unpkg.h"
+#include "Utilities/Thread.h"
 
-bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>& sync)
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+// Decrypt PKG data in place (`offset` is relative to the data area, `key` selects the key for specific block)
+static void pkg_decrypt(const PKGHeader& header, u64 offset, u64 size, const uchar* key, u128* buf)
+{
+	// Get block count
+	const u64 blocks = (size + 15) / 16;
+
+	if (header.pkg_type == PKG_RELEASE_TYPE_DEBUG)
+	{
+		// Debug key
+		be_t<u64> input[8] =
+		{
+			header.qa_digest[0],
+			header.qa_digest[0],
+			header.qa_digest[1],
+			header.qa_digest[1],
+		};
+
+		for (u64 i = 0; i < blocks; i++)
+		{
+			// Initialize stream cipher for current position
+			input[7] = offset / 16 + i;
+
+			union sha1_hash
+			{
+				u8 data[20];
+				u128 _v128;
+			} hash;
+
+			sha1(reinterpret_cast<const u8*>(input), sizeof(input), hash.data);
+
+			buf[i] ^= hash._v128;
+		}
+	}
+
+	if (header.pkg_type == PKG_RELEASE_TYPE_RELEASE)
+	{
+		aes_context ctx;
+
+		// Set encryption key for stream cipher
+		aes_setkey_enc(&ctx, key, 128);
+
+		// Initialize stream cipher for start position
+		be_t<u128> input = header.klicensee.value() + offset / 16;
+
+		// Decrypt all blocks in place (stream position is incremented for every block)
+		std::size_t nc_off = 0;
+		u8 stream_block[16];
+
+		aes_crypt_ctr(&ctx, blocks * 16, &nc_off, reinterpret_cast<u8*>(&input), stream_block, reinterpret_cast<const u8*>(buf), reinterpret_cast<u8*>(buf));
+	}
+}
+
+// Unit of work passed through the installation pipeline
+struct pkg_chunk
+{
+	std::unique_ptr<u128[]> buf;
+	std::shared_ptr<fs::file> out; // Destination (written sequentially)
+	std::string path;
+	u64 offset; // Offset in the data area
+	u64 size;
+	const uchar* key;
+	bool ready = false; // Decrypted
+};
+
+// Ring of chunks: reader -> parallel decrypters -> writer (chunks are written in reading order)
+class pkg_pipeline
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::vector<pkg_chunk> m_chunks;
+	std::vector<std::shared_ptr<thread_ctrl>> m_threads;
+
+	u64 m_read = 0; // Chunks filled by the reader
+	u64 m_decrypt = 0; // Chunks claimed by decrypters
+	u64 m_write = 0; // Chunks written
+	bool m_finished = false;
+	bool m_aborted = false;
+
+public:
+	pkg_pipeline(std::size_t count, std::size_t size)
+		: m_chunks(count)
+	{
+		for (auto& chunk : m_chunks)
+		{
+			chunk.buf.reset(new u128[size / sizeof(u128)]);
+		}
+	}
+
+	// Stop and join the threads on any exit path
+	~pkg_pipeline() noexcept(false)
+	{
+		abort();
+		join();
+	}
+
+	template <typename F>
+	void spawn(std::string name, F&& func)
+	{
+		m_threads.emplace_back();
+		thread_ctrl::spawn(m_threads.back(), std::move(name), std::forward<F>(func));
+	}
+
+	void join()
+	{
+		for (auto& thread : m_threads)
+		{
+			thread->join();
+		}
+	}
+
+	// Get free chunk for the reader (nullptr if aborted)
+	pkg_chunk* get_free()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [&] { return m_aborted || m_read - m_write < m_chunks.size(); });
+		return m_aborted ? nullptr : &m_chunks[m_read % m_chunks.size()];
+	}
+
+	void put_filled()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_read++;
+		}
+
+		m_cond.notify_all();
+	}
+
+	// Get chunk to decrypt (nullptr if finished or aborted)
+	pkg_chunk* get_filled()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(lock, [&] { return m_aborted || m_finished || m_decrypt < m_read; });
+		return m_aborted || m_decrypt == m_read ? nullptr : &m_chunks[m_decrypt++ % m_chunks.size()];
+	}
+
+	void put_decrypted(pkg_chunk& chunk)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			chunk.ready = true;
+		}
+
+		m_cond.notify_all();
+	}
+
+	// Get next chunk in order to write (nullptr if finished or aborted)
+	pkg_chunk* get_decrypted()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		pkg_chunk& chunk = m_chunks[m_write % m_chunks.size()];
+		m_cond.wait(lock, [&] { return m_aborted || chunk.ready || (m_finished && m_write == m_read); });
+		return m_aborted || !chunk.ready ? nullptr : &chunk;
+	}
+
+	void put_written(pkg_chunk& chunk)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			chunk.ready = false;
+			chunk.out.reset();
+			m_write++;
+		}
+
+		m_cond.notify_all();
+	}
+
+	// No more data
+	void finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_finished = true;
+		}
+
+		m_cond.notify_all();
+	}
+
+	void abort()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_aborted = true;
+		}
+
+		m_cond.notify_all();
+	}
+
+	bool aborted()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_aborted;
+	}
+};
+
+bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>& sync, pkg_install_stats* stats, bool resume)
 {
-	const std::size_t BUF_SIZE = 8192 * 1024; // 8 MB
+	const std::size_t BUF_SIZE = 1024 * 1024; // 1 MB per chunk
 
 	// Save current file offset (probably zero)
 	const u64 start_offset = pkg_f.pos();
@@ -104,10 +305,10 @@ bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>
 		pkg_f.seek(packet.size, fs::seek_cur);
 	}
 
-	// Allocate buffer with BUF_SIZE size or more if required
-	const std::unique_ptr<u128[]> buf(new u128[std::max<u64>(BUF_SIZE, sizeof(PKGEntry) * header.file_count) / sizeof(u128)]);
+	// Buffer for the file table and names
+	const std::unique_ptr<u128[]> buf(new u128[std::max<u64>(256, sizeof(PKGEntry) * header.file_count) / sizeof(u128) + 1]);
 
-	// Define decryption subfunction (`psp` arg selects the key for specific block)
+	// Read and decrypt small block synchronously
 	auto decrypt = [&](u64 offset, u64 size, const uchar* key) -> u64
 	{
 		pkg_f.seek(start_offset + header.data_offset + offset);
@@ -115,57 +316,7 @@ bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>
 		// Read the data and set available size
 		const u64 read = pkg_f.read(buf.get(), size);
 
-		// Get block count
-		const u64 blocks = (read + 15) / 16;
-
-		if (header.pkg_type == PKG_RELEASE_TYPE_DEBUG)
-		{
-			// Debug key
-			be_t<u64> input[8] =
-			{
-				header.qa_digest[0],
-				header.qa_digest[0],
-				header.qa_digest[1],
-				header.qa_digest[1],
-			};
-
-			for (u64 i = 0; i < blocks; i++)
-			{
-				// Initialize stream cipher for current position
-				input[7] = offset / 16 + i;
-
-				union sha1_hash
-				{
-					u8 data[20];
-					u128 _v128;
-				} hash;
-				
-				sha1(reinterpret_cast<const u8*>(input), sizeof(input), hash.data);
-
-				buf[i] ^= hash._v128;
-			}
-		}
-
-		if (header.pkg_type == PKG_RELEASE_TYPE_RELEASE)
-		{
-			aes_context ctx;
-
-			// Set encryption key for stream cipher
-			aes_setkey_enc(&ctx, key, 128);
-
-			// Initialize stream cipher for start position
-			be_t<u128> input = header.klicensee.value() + offset / 16;
-
-			// Increment stream position for every block
-			for (u64 i = 0; i < blocks; i++, input++)
-			{
-				u128 key;
-
-				aes_crypt_ecb(&ctx, AES_ENCRYPT, reinterpret_cast<const u8*>(&input), reinterpret_cast<u8*>(&key));
-
-				buf[i] ^= key;
-			}
-		}
+		pkg_decrypt(header, offset, read, key, buf.get());
 
 		// Return the amount of data written in buf
 		return read;
@@ -194,8 +345,65 @@ bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>
 
 	std::memcpy(entries.data(), buf.get(), entries.size() * sizeof(PKGEntry));
 
+	// Start the pipeline: file data is decrypted by workers and written in order by the writer thread
+	const u32 worker_count = std::max<u32>(1, std::min<u32>(std::thread::hardware_concurrency(), 8));
+
+	// Used by the writer thread (must outlive the pipeline)
+	bool cancelled = false;
+	u64 written = 0;
+
+	pkg_pipeline pipeline(worker_count * 4, BUF_SIZE);
+
+	for (u32 i = 0; i < worker_count; i++)
+	{
+		pipeline.spawn(fmt::format("PKG Decrypter %u", i), [&]
+		{
+			while (pkg_chunk* chunk = pipeline.get_filled())
+			{
+				pkg_decrypt(header, chunk->offset, chunk->size, chunk->key, chunk->buf.get());
+				pipeline.put_decrypted(*chunk);
+			}
+		});
+	}
+
+	const auto start_time = std::chrono::steady_clock::now();
+
+	pipeline.spawn("PKG Writer", [&]
+	{
+		while (pkg_chunk* chunk = pipeline.get_decrypted())
+		{
+			if (chunk->out->write(chunk->buf.get(), chunk->size) != chunk->size)
+			{
+				LOG_ERROR(LOADER, "Failed to write file %s", chunk->path);
+				pipeline.abort();
+				break;
+			}
+
+			written += chunk->size;
+
+			if (stats)
+			{
+				stats->bytes_written += chunk->size;
+			}
+
+			if (sync.fetch_add((chunk->size + 0.0) / header.data_size) < 0.)
+			{
+				cancelled = true;
+				pipeline.abort();
+				break;
+			}
+
+			pipeline.put_written(*chunk);
+		}
+	});
+
 	for (const auto& entry : entries)
 	{
+		if (pipeline.aborted())
+		{
+			break;
+		}
+
 		const bool is_psp = (entry.type & PKG_FILE_ENTRY_PSP) != 0;
 
 		if (entry.name_size > 256)
@@ -228,32 +436,93 @@ bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>
 
 			const bool did_overwrite = fs::is_file(path);
 
-			if (fs::file out{ path, fs::rewrite })
+			// Starting position (non-zero when resuming partially extracted file)
+			u64 pos = 0;
+
+			// Existing file kept completely or partially
+			bool skipped = false;
+			bool resumed = false;
+
+			auto out = std::make_shared<fs::file>();
+
+			if (resume && did_overwrite && out->open(path, fs::read + fs::write))
 			{
-				for (u64 pos = 0; pos < entry.file_size; pos += BUF_SIZE)
+				// Files are written sequentially, so the existing part can be kept (CTR allows to restart at any block)
+				pos = std::min<u64>(out->size(), entry.file_size) & ~15ull;
+
+				if (pos)
 				{
-					const u64 block_size = std::min<u64>(BUF_SIZE, entry.file_size - pos);
+					// Don't trust a foreign or corrupted file: the last kept block must match the package
+					u128 existing{};
+					out->seek(pos - 16);
 
-					if (decrypt(entry.file_offset + pos, block_size, is_psp ? PKG_AES_KEY2 : dec_key.data()) != block_size)
+					if (out->read(&existing, 16) != 16 || decrypt(entry.file_offset + pos - 16, 16, is_psp ? PKG_AES_KEY2 : dec_key.data()) != 16 || std::memcmp(&existing, buf.get(), 16))
 					{
-						LOG_ERROR(LOADER, "Failed to extract file %s", path);
-						break;
+						LOG_WARNING(LOADER, "Existing file doesn't match the package: %s", name);
+						pos = 0;
 					}
+				}
+
+				skipped = pos == entry.file_size;
+				resumed = !skipped && pos != 0;
 
-					if (out.write(buf.get(), block_size) != block_size)
+				out->trunc(pos);
+				out->seek(pos);
+
+				if (stats)
+				{
+					stats->bytes_skipped += pos;
+				}
+
+				sync.fetch_add((pos + 0.0) / header.data_size);
+			}
+			else
+			{
+				out->open(path, fs::rewrite);
+			}
+
+			if (*out)
+			{
+				for (; pos < entry.file_size; pos += BUF_SIZE)
+				{
+					pkg_chunk* chunk = pipeline.get_free();
+
+					if (!chunk)
 					{
-						LOG_ERROR(LOADER, "Failed to write file %s", path);
 						break;
 					}
 
-					if (sync.fetch_add((block_size + 0.0) / header.data_size) < 0.)
+					const u64 block_size = std::min<u64>(BUF_SIZE, entry.file_size - pos);
+
+					pkg_f.seek(start_offset + header.data_offset + entry.file_offset + pos);
+
+					if (pkg_f.read(chunk->buf.get(), block_size) != block_size)
 					{
-						LOG_ERROR(LOADER, "Package installation cancelled: %s", dir);
+						LOG_ERROR(LOADER, "Failed to extract file %s", path);
+
+						// Threads use the local variables, so join them before returning
+						pipeline.abort();
+						pipeline.join();
 						return false;
 					}
+
+					chunk->out = out;
+					chunk->path = path;
+					chunk->offset = entry.file_offset + pos;
+					chunk->size = block_size;
+					chunk->key = is_psp ? PKG_AES_KEY2 : dec_key.data();
+					pipeline.put_filled();
 				}
 
-				if (did_overwrite)
+				if (skipped)
+				{
+					LOG_NOTICE(LOADER, "Skipped complete file %s", name);
+				}
+				else if (resumed)
+				{
+					LOG_NOTICE(LOADER, "Resumed file %s", name);
+				}
+				else if (did_overwrite)
 				{
 					LOG_WARNING(LOADER, "Overwritten file %s", name);
 				}
@@ -298,6 +567,23 @@ bool pkg_install(const fs::file& pkg_f, const std::string& dir, atomic_t<double>
 		}
 	}
 
-	LOG_SUCCESS(LOADER, "Package successfully installed to %s", dir);
+	// Wait for the remaining data to be written
+	pipeline.finish();
+	pipeline.join();
+
+	if (cancelled)
+	{
+		LOG_ERROR(LOADER, "Package installation cancelled: %s", dir);
+		return false;
+	}
+
+	if (pipeline.aborted())
+	{
+		return false;
+	}
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	LOG_SUCCESS(LOADER, "Package successfully installed to %s (%.2f MB/s)", dir, written / std::max(elapsed, 0.001) / 1000000.);
 	return true;
 }
@@ -57,4 +57,13 @@ struct PKGEntry
 	be_t<u32> pad;          // Padding (zeros)
 };
 
-bool pkg_install(const class fs::file& pkg_f, const std::string& dir, atomic_t<double>&);
+// Optional installation statistics (updated during installation)
+struct pkg_install_stats
+{
+	atomic_t<u64> bytes_written{0}; // Decrypted bytes written to disk
+	atomic_t<u64> bytes_skipped{0}; // Bytes already present (resumed installation)
+};
+
+// Install PKG to `dir`. Progress is added to `sync`, negative value cancels the installation.
+// If `resume` is set, partially extracted files are continued instead of being rewritten.
+bool pkg_install(const class fs::file& pkg_f, const std::string& dir, atomic_t<double>& sync, pkg_install_stats* stats = nullptr, bool resume = false);
@@ -0,0 +1,268 @@
+#include "stdafx.h"
+#include "Emu/System.h"
+#include "AudioRing.h"
+
+#include <algorithm>
+
+audio_ring::audio_ring(u32 size)
+	: m_data(new u8[size]{})
+	, m_size(size)
+{
+	verify(HERE), size && (size & (size - 1)) == 0;
+}
+
+bool audio_ring::push(const void* src, u32 size)
+{
+	const u64 write = m_write.load();
+
+	if (size > m_size - static_cast<u32>(write - m_read.load()))
+	{
+		return false;
+	}
+
+	const u32 pos = write & (m_size - 1);
+	const u32 part = std::min(size, m_size - pos);
+
+	std::memcpy(m_data.get() + pos, src, part);
+	std::memcpy(m_data.get(), static_cast<const u8*>(src) + part, size - part);
+
+	// Publish the data
+	m_write.store(write + size);
+	return true;
+}
+
+bool audio_ring::pop(void* dst, u32 size)
+{
+	const u64 read = m_read.load();
+
+	if (size > static_cast<u32>(m_write.load() - read))
+	{
+		return false;
+	}
+
+	const u32 pos = read & (m_size - 1);
+	const u32 part = std::min(size, m_size - pos);
+
+	std::memcpy(dst, m_data.get() + pos, part);
+	std::memcpy(static_cast<u8*>(dst) + part, m_data.get(), size - part);
+
+	// Release the space
+	m_read.store(read + size);
+	return true;
+}
+
+static u32 audio_ring_size(u32 block_size)
+{
+	// Enough space for twice the maximal latency
+	u32 size = 1;
+
+	while (size < block_size * audio_output::max_latency * 2)
+	{
+		size *= 2;
+	}
+
+	return size;
+}
+
+audio_output::audio_output(u32 block_size, u32 channels, bool u16, bool stretch)
+	: m_block_size(block_size)
+	, m_channels(channels)
+	, m_u16(u16)
+	, m_stretch(stretch)
+	, m_ring(audio_ring_size(block_size))
+	, m_blocks(new u8[block_size * block_count]{})
+{
+	if (m_stretch)
+	{
+		// Input never exceeds three blocks (one block plus the maximal stretched read)
+		m_input.resize(block_size / (u16 ? 2 : 4) * 3);
+	}
+
+	thread_ctrl::spawn(m_thread, "Audio Output", [this]
+	{
+		const auto backend = Emu.GetCallbacks().get_audio();
+
+		task(*backend);
+	});
+}
+
+audio_output::~audio_output()
+{
+	m_quit = true;
+	m_thread->notify();
+	m_thread->join();
+}
+
+void audio_output::push(const void* src)
+{
+	if (!m_ring.push(src, m_block_size))
+	{
+		// The output doesn't keep up: drop the block
+		m_overruns++;
+	}
+
+	m_thread->notify();
+}
+
+std::string audio_output::get_stats() const
+{
+	const u32 target = m_target;
+
+	return fmt::format("played=%llu, underruns=%llu, overruns=%llu, latency=%u blocks (%.1f ms)",
+		m_played.load(), m_underruns.load(), m_overruns.load(), target, target * 256 * 1000. / 48000);
+}
+
+void audio_output::task(AudioThread& backend)
+{
+	const u32 frame_size = m_channels * (m_u16 ? 2 : 4);
+	const u32 block_frames = m_block_size / frame_size;
+
+	backend.Open(m_blocks.get(), m_block_size);
+
+	u32 index = 0;
+	u32 stable = 0;
+	bool prebuffer = true;
+
+	while (!m_quit && !Emu.IsStopped())
+	{
+		if (Emu.IsPaused())
+		{
+			// Not an underrun
+			prebuffer = true;
+			thread_ctrl::wait_for(1000);
+			continue;
+		}
+
+		const u32 target = m_target;
+
+		if (prebuffer)
+		{
+			// Accumulate target amount of data before starting (notified by push)
+			if (m_ring.available() < target * m_block_size)
+			{
+				thread_ctrl::wait_for(1000);
+				continue;
+			}
+
+			prebuffer = false;
+		}
+
+		u8* const block = m_blocks.get() + index * m_block_size;
+
+		bool ok;
+
+		if (m_stretch)
+		{
+			// Speed up playback when too much data is queued, slow it down when running low
+			const f64 queued = m_ring.available() / frame_size + (m_input_frames - m_input_pos);
+			const f64 error = (queued - target * block_frames) / (target * block_frames);
+
+			ok = stretch(block, 1. + std::max(-max_stretch, std::min(error * max_stretch, max_stretch)));
+		}
+		else
+		{
+			// Skip excess data if the mixer runs faster than the device
+			while (m_ring.available() > (target * 2 + min_latency) * m_block_size)
+			{
+				m_ring.pop(block, m_block_size);
+				m_overruns++;
+			}
+
+			ok = m_ring.pop(block, m_block_size);
+		}
+
+		if (!ok)
+		{
+			// Underrun: increase the latency and accumulate data again
+			m_underruns++;
+			stable = 0;
+			prebuffer = true;
+
+			if (target < max_latency)
+			{
+				m_target = target + 1;
+				LOG_NOTICE(GENERAL, "Audio output underrun: latency increased to %u blocks", target + 1);
+			}
+
+			continue;
+		}
+
+		backend.AddData(block, m_block_size);
+
+		m_played++;
+		index = (index + 1) % block_count;
+
+		if (++stable >= stable_blocks && target > min_latency)
+		{
+			// Try to decrease the latency after playing for a while without underruns
+			stable = 0;
+			m_target = target - 1;
+		}
+	}
+}
+
+bool audio_output::stretch(u8* out, f64 ratio)
+{
+	const u32 frames = m_block_size / (m_channels * (m_u16 ? 2 : 4));
+
+	// Required amount of input frames (interpolation reads one frame ahead)
+	const u32 required = static_cast<u32>(m_input_pos + frames * ratio) + 2;
+
+	while (m_input_frames < required)
+	{
+		// Append next block (the output block is used as temporary storage)
+		if (!m_ring.pop(out, m_block_size))
+		{
+			return false;
+		}
+
+		f32* const dst = m_input.data() + m_input_frames * m_channels;
+
+		if (m_u16)
+		{
+			for (u32 i = 0; i < frames * m_channels; i++)
+			{
+				dst[i] = reinterpret_cast<const s16*>(out)[i] / 32768.f;
+			}
+		}
+		else
+		{
+			std::memcpy(dst, out, m_block_size);
+		}
+
+		m_input_frames += frames;
+	}
+
+	// Resample with linear interpolation
+	f64 pos = m_input_pos;
+
+	for (u32 i = 0; i < frames; i++, pos += ratio)
+	{
+		const u32 index = static_cast<u32>(pos);
+		const f32 t = static_cast<f32>(pos - index);
+		const f32* const a = m_input.data() + index * m_channels;
+		const f32* const b = a + m_channels;
+
+		for (u32 c = 0; c < m_channels; c++)
+		{
+			const f32 value = a[c] + (b[c] - a[c]) * t;
+
+			if (m_u16)
+			{
+				reinterpret_cast<s16*>(out)[i * m_channels + c] = static_cast<s16>(std::max(-32768.f, std::min(value * 32768.f, 32767.f)));
+			}
+			else
+			{
+				reinterpret_cast<f32*>(out)[i * m_channels + c] = value;
+			}
+		}
+	}
+
+	// Discard consumed input
+	const u32 consumed = static_cast<u32>(pos);
+
+	std::memmove(m_input.data(), m_input.data() + consumed * m_channels, (m_input_frames - consumed) * m_channels * sizeof(f32));
+	m_input_frames -= consumed;
+	m_input_pos = pos - consumed;
+	return true;
+}
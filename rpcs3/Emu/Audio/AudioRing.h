@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Utilities/types.h"
+#include "Utilities/Atomic.h"
+#include "Utilities/Thread.h"
+#include "AudioThread.h"
+
+#include <memory>
+#include <vector>
+#include <string>
+
+// Lock-free single-producer single-consumer byte ring
+class audio_ring final
+{
+	const std::unique_ptr<u8[]> m_data;
+	const u32 m_size; // Power of 2
+
+	atomic_t<u64> m_read{0}; // Modified by the consumer only
+	atomic_t<u64> m_write{0}; // Modified by the producer only
+
+public:
+	explicit audio_ring(u32 size);
+
+	u32 size() const
+	{
+		return m_size;
+	}
+
+	// Amount of bytes available for reading
+	u32 available() const
+	{
+		return static_cast<u32>(m_write.load() - m_read.load());
+	}
+
+	// Write all data or nothing (producer)
+	bool push(const void* src, u32 size);
+
+	// Read exactly the specified amount of bytes or nothing (consumer)
+	bool pop(void* dst, u32 size);
+};
+
+// Audio output: mixed blocks are queued in the ring by the mixer and fed to the backend by a separate thread.
+// The backend is created, used and destroyed by this thread (some backends use thread-local state).
+// Backend's AddData is expected to block while the device queue is full (so the output thread runs at the device rate).
+class audio_output final
+{
+public:
+	// Target latency limits (in blocks, 256 frames each)
+	static constexpr u32 min_latency = 2;
+	static constexpr u32 max_latency = 16;
+
+	// Amount of blocks played without underruns before the target latency is lowered (~10 s)
+	static constexpr u32 stable_blocks = 1875;
+
+	// Maximal playback speed deviation of the time stretching
+	static constexpr f64 max_stretch = 0.02;
+
+private:
+	const u32 m_block_size; // In bytes
+	const u32 m_channels;
+	const bool m_u16; // s16 samples (f32 otherwise)
+	const bool m_stretch;
+
+	audio_ring m_ring;
+
+	// Blocks passed to the backend (they may be referenced after AddData returns)
+	static constexpr u32 block_count = 32;
+	std::unique_ptr<u8[]> m_blocks;
+
+	// Time stretching input (interleaved f32 frames) and fractional read position
+	std::vector<f32> m_input;
+	u32 m_input_frames = 0;
+	f64 m_input_pos = 0;
+
+	atomic_t<u32> m_target{min_latency};
+	atomic_t<u64> m_played{0};
+	atomic_t<u64> m_underruns{0};
+	atomic_t<u64> m_overruns{0};
+	atomic_t<bool> m_quit{false};
+
+	std::shared_ptr<thread_ctrl> m_thread;
+
+	void task(AudioThread& backend);
+
+	// Fill the output block by resampling the queued data (returns false on underrun)
+	bool stretch(u8* out, f64 ratio);
+
+public:
+	audio_output(u32 block_size, u32 channels, bool u16, bool stretch);
+
+	~audio_output();
+
+	// Queue mixed block (mixer thread, never blocks)
+	void push(const void* src);
+
+	std::string get_stats() const;
+};
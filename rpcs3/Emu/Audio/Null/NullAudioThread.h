@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Emu/Audio/AudioThread.h"
+#include "Utilities/Thread.h"
+
+#include <algorithm>
 
 class NullAudioThread : public AudioThread
 {
@@ -16,3 +19,45 @@ public:
 	virtual void Stop() {}
 	virtual void AddData(const void* src, int size) {}
 };
+
+// Null output consuming data at the real playback rate (behaves like a device with a small queue)
+class NullClockedAudioThread : public NullAudioThread
+{
+	// Device queue length (in blocks)
+	static constexpr u64 queue_blocks = 4;
+
+	periodic_timer m_timer{1};
+
+	// Block size in bytes (256 frames)
+	u64 m_block_size = 0;
+
+	// Time when all queued data is played
+	u64 m_queued_until = 0;
+
+public:
+	virtual void Open(const void* src, int size) override
+	{
+		m_block_size = size;
+		m_queued_until = 0;
+	}
+
+	virtual void AddData(const void* src, int size) override
+	{
+		if (!m_block_size)
+		{
+			return;
+		}
+
+		const u64 duration = size * 256000000ull / m_block_size / 48000;
+		const u64 limit = queue_blocks * 256000000ull / 48000;
+		const u64 now = periodic_timer::now();
+
+		m_queued_until = std::max(now, m_queued_until) + duration;
+
+		// Wait until the queue has space
+		if (m_queued_until - now > limit)
+		{
+			m_timer.wait_until(m_queued_until - limit);
+		}
+	}
+};
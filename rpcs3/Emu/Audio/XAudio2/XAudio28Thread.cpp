@@ -11,6 +11,27 @@ static thread_local HMODULE s_tls_xaudio2_lib{};
 static thread_local IXAudio2* s_tls_xaudio2_instance{};
 static thread_local IXAudio2MasteringVoice* s_tls_master_voice{};
 static thread_local IXAudio2SourceVoice* s_tls_source_voice{};
+static thread_local HANDLE s_tls_buffer_end_event{};
+
+// Signals the audio thread whenever the source voice releases a buffer
+struct xa28_voice_callback final : IXAudio2VoiceCallback
+{
+	STDMETHOD_(void, OnVoiceProcessingPassStart)(UINT32) override {}
+	STDMETHOD_(void, OnVoiceProcessingPassEnd)() override {}
+	STDMETHOD_(void, OnStreamEnd)() override {}
+	STDMETHOD_(void, OnBufferStart)(void*) override {}
+	STDMETHOD_(void, OnLoopEnd)(void*) override {}
+	STDMETHOD_(void, OnVoiceError)(void*, HRESULT) override {}
+
+	STDMETHOD_(void, OnBufferEnd)(void*) override
+	{
+		SetEvent(event);
+	}
+
+	HANDLE event;
+};
+
+static thread_local xa28_voice_callback s_tls_voice_callback{};
 
 void XAudio2Thread::xa28_init(void* lib)
 {
@@ -53,6 +74,11 @@ void XAudio2Thread::xa28_destroy()
 		s_tls_source_voice->DestroyVoice();
 	}
 
+	if (s_tls_buffer_end_event != nullptr)
+	{
+		CloseHandle(s_tls_buffer_end_event);
+	}
+
 	if (s_tls_master_voice != nullptr)
 	{
 		s_tls_master_voice->DestroyVoice();
@@ -115,7 +141,10 @@ void XAudio2Thread::xa28_open()
 	waveformatex.wBitsPerSample = sample_size * 8;
 	waveformatex.cbSize = 0;
 
-	hr = s_tls_xaudio2_instance->CreateSourceVoice(&s_tls_source_voice, &waveformatex, 0, XAUDIO2_DEFAULT_FREQ_RATIO);
+	s_tls_buffer_end_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+	s_tls_voice_callback.event = s_tls_buffer_end_event;
+
+	hr = s_tls_xaudio2_instance->CreateSourceVoice(&s_tls_source_voice, &waveformatex, 0, XAUDIO2_DEFAULT_FREQ_RATIO, &s_tls_voice_callback);
 	if (FAILED(hr))
 	{
 		LOG_ERROR(GENERAL, "XAudio2Thread : CreateSourceVoice() failed(0x%08x)", (u32)hr);
@@ -131,6 +160,14 @@ void XAudio2Thread::xa28_add(const void* src, int size)
 	XAUDIO2_VOICE_STATE state;
 	s_tls_source_voice->GetState(&state);
 
+	// Block while the voice queue is full (AddData runs at the device rate), woken by OnBufferEnd
+	while (state.BuffersQueued >= 8 && !Emu.IsStopped())
+	{
+		// The timeout only bounds the reaction to emulation stop
+		WaitForSingleObject(s_tls_buffer_end_event, 100);
+		s_tls_source_voice->GetState(&state);
+	}
+
 	if (state.BuffersQueued > 32)
 	{
 		LOG_WARNING(GENERAL, "XAudio2Thread : too many buffers enqueued (%d, pos=%u)", state.BuffersQueued, state.SamplesPlayed);
@@ -2,16 +2,27 @@
 
 #include "Utilities/Log.h"
 #include "Utilities/StrFmt.h"
+#include "Utilities/Thread.h"
 
 #include "XAudio2Thread.h"
 #include <Windows.h>
 
 XAudio2Thread::XAudio2Thread()
 {
+	const int priority = GetThreadPriority(GetCurrentThread());
+
 	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
 	{
 		LOG_ERROR(GENERAL, "XAudio: failed to increase thread priority");
 	}
+	else
+	{
+		// Host threads are reused, restore the priority of the thread creating the backend
+		thread_ctrl::atexit([priority]
+		{
+			SetThreadPriority(GetCurrentThread(), priority);
+		});
+	}
 
 	if (auto lib2_9 = LoadLibraryExW(L"XAudio2_9.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32))
 	{
@@ -0,0 +1,301 @@
+#include "stdafx.h"
+#include "Emu/System.h"
+#include "Emu/IdManager.h"
+#include "CPUPlacement.h"
+#include "Utilities/sysinfo.h"
+#include "Utilities/Thread.h"
+
+#include <algorithm>
+#include <map>
+
+template <>
+void fmt_class_string<thread_placement_policy>::format(std::string& out, u64 arg)
+{
+	format_enum(out, arg, [](thread_placement_policy value)
+	{
+		switch (value)
+		{
+		case thread_placement_policy::disabled: return "Disabled";
+		case thread_placement_policy::automatic: return "Automatic";
+		case thread_placement_policy::manual: return "Manual";
+		}
+
+		return unknown;
+	});
+}
+
+template <>
+void fmt_class_string<thread_class>::format(std::string& out, u64 arg)
+{
+	format_enum(out, arg, [](thread_class value)
+	{
+		switch (value)
+		{
+		case thread_class::rsx: return "RSX";
+		case thread_class::ppu: return "PPU";
+		case thread_class::spu: return "SPU";
+		case thread_class::mfc: return "MFC";
+		}
+
+		return unknown;
+	});
+}
+
+static std::vector<u32> get_cpu_list(const cfg::string& entry)
+{
+	std::vector<u32> result;
+
+	if (!utils::parse_cpu_list(entry.to_string(), result))
+	{
+		LOG_ERROR(GENERAL, "Thread placement: invalid processor list '%s' ignored", entry.to_string());
+		result.clear();
+	}
+
+	// Remove processors not available to the process
+	const auto& topology = utils::get_cpu_topology();
+
+	result.erase(std::remove_if(result.begin(), result.end(), [&](u32 cpu)
+	{
+		return std::none_of(topology.begin(), topology.end(), [&](const utils::cpu_topology_entry& e) { return e.cpu == cpu; });
+	}), result.end());
+
+	return result;
+}
+
+thread_placement::thread_placement()
+{
+	const auto& topology = utils::get_cpu_topology();
+
+	// Physical cores grouped by cache groups
+	std::map<u32, std::map<u32, std::vector<u32>>> domains;
+	std::map<u32, u32> packages;
+
+	for (const auto& e : topology)
+	{
+		domains[e.cache][e.core].push_back(e.cpu);
+		packages[e.package]++;
+	}
+
+	std::size_t core_count = 0;
+
+	for (const auto& domain : domains)
+	{
+		core_count += domain.second.size();
+	}
+
+	LOG_NOTICE(GENERAL, "Host topology: %u package(s), %u cache group(s), %u core(s), %u logical processor(s)", packages.size(), domains.size(), core_count, topology.size());
+
+	for (const auto& domain : domains)
+	{
+		std::string cores;
+
+		for (const auto& core : domain.second)
+		{
+			cores += cores.empty() ? "" : " ";
+			cores += "[" + utils::format_cpu_list(core.second) + "]";
+		}
+
+		LOG_NOTICE(GENERAL, "Host cache group %u: %s", domain.first, cores);
+	}
+
+	const thread_placement_policy policy = g_cfg.core.thread_placement;
+
+	switch (policy)
+	{
+	case thread_placement_policy::automatic:
+	{
+		if (core_count < 4)
+		{
+			LOG_WARNING(GENERAL, "Thread placement: not enough physical cores (%u)", core_count);
+			break;
+		}
+
+		// Home cache group (the one of the first processor)
+		const auto home = domains.find(topology[0].cache);
+
+		// RSX: the last physical core of the home group, SMT siblings included
+		m_rsx = home->second.rbegin()->second;
+
+		const auto not_rsx = [&](const std::vector<u32>& cpus)
+		{
+			std::vector<u32> result;
+			std::copy_if(cpus.begin(), cpus.end(), std::back_inserter(result), [&](u32 cpu) { return std::count(m_rsx.begin(), m_rsx.end(), cpu) == 0; });
+			return result;
+		};
+
+		std::vector<u32> all_cpus;
+
+		for (const auto& e : topology)
+		{
+			all_cpus.push_back(e.cpu);
+		}
+
+		if (home->second.size() > 1)
+		{
+			// PPU and MFC: the rest of the home group
+			for (const auto& core : home->second)
+			{
+				m_ppu.insert(m_ppu.end(), core.second.begin(), core.second.end());
+			}
+
+			m_ppu = not_rsx(m_ppu);
+		}
+		else
+		{
+			m_ppu = not_rsx(all_cpus);
+		}
+
+		m_mfc = m_ppu;
+
+		if (domains.size() > 1)
+		{
+			// SPU: other cache groups
+			std::vector<u32> spu_cpus;
+
+			for (const auto& domain : domains)
+			{
+				for (const auto& core : domain.second)
+				{
+					if (domain.first != home->first)
+					{
+						spu_cpus.insert(spu_cpus.end(), core.second.begin(), core.second.end());
+					}
+				}
+			}
+
+			set_spu_domains(spu_cpus);
+		}
+		else
+		{
+			set_spu_domains(not_rsx(all_cpus));
+		}
+
+		break;
+	}
+	case thread_placement_policy::manual:
+	{
+		m_rsx = get_cpu_list(g_cfg.core.rsx_cpus);
+		m_ppu = get_cpu_list(g_cfg.core.ppu_cpus);
+		m_mfc = get_cpu_list(g_cfg.core.mfc_cpus);
+		set_spu_domains(get_cpu_list(g_cfg.core.spu_cpus));
+		break;
+	}
+	default:
+	{
+		return;
+	}
+	}
+
+	std::string spu_domains;
+
+	for (const auto& domain : m_spu)
+	{
+		spu_domains += spu_domains.empty() ? "" : " | ";
+		spu_domains += utils::format_cpu_list(domain.cpus);
+	}
+
+	LOG_NOTICE(GENERAL, "Thread placement (%s): RSX=%s, PPU=%s, MFC=%s, SPU groups=%s", policy,
+		m_rsx.empty() ? "any" : utils::format_cpu_list(m_rsx),
+		m_ppu.empty() ? "any" : utils::format_cpu_list(m_ppu),
+		m_mfc.empty() ? "any" : utils::format_cpu_list(m_mfc),
+		m_spu.empty() ? "any" : spu_domains);
+}
+
+void thread_placement::set_spu_domains(const std::vector<u32>& cpus)
+{
+	std::map<u32, std::vector<u32>> domains;
+
+	for (const auto& e : utils::get_cpu_topology())
+	{
+		if (std::count(cpus.begin(), cpus.end(), e.cpu))
+		{
+			domains[e.cache].push_back(e.cpu);
+		}
+	}
+
+	for (auto& domain : domains)
+	{
+		m_spu.emplace_back(spu_domain{std::move(domain.second), 0});
+	}
+}
+
+void thread_placement::apply(thread_class type, const std::string& name, u64 group)
+{
+	if (g_cfg.core.thread_placement == thread_placement_policy::disabled)
+	{
+		return;
+	}
+
+	const auto _this = fxm::get_always<thread_placement>();
+
+	std::vector<u32> cpus;
+
+	switch (type)
+	{
+	case thread_class::rsx: cpus = _this->m_rsx; break;
+	case thread_class::ppu: cpus = _this->m_ppu; break;
+	case thread_class::mfc: cpus = _this->m_mfc; break;
+	case thread_class::spu:
+	{
+		std::lock_guard<std::mutex> lock(_this->m_mutex);
+
+		if (_this->m_spu.empty())
+		{
+			break;
+		}
+
+		auto found = _this->m_groups.find(group);
+
+		if (found == _this->m_groups.end())
+		{
+			// Place new group in the least loaded cache group
+			const auto domain = std::min_element(_this->m_spu.begin(), _this->m_spu.end(), [](const spu_domain& a, const spu_domain& b)
+			{
+				return a.threads * b.cpus.size() < b.threads * a.cpus.size();
+			});
+
+			found = _this->m_groups.emplace(group, spu_group_info{::narrow<u32>(domain - _this->m_spu.begin(), HERE), 0}).first;
+		}
+
+		found->second.threads++;
+
+		auto& domain = _this->m_spu[found->second.domain];
+		domain.threads++;
+		cpus = domain.cpus;
+
+		thread_ctrl::atexit([_this, group]
+		{
+			std::lock_guard<std::mutex> lock(_this->m_mutex);
+
+			const auto found = _this->m_groups.find(group);
+			_this->m_spu[found->second.domain].threads--;
+
+			if (--found->second.threads == 0)
+			{
+				_this->m_groups.erase(found);
+			}
+		});
+
+		break;
+	}
+	}
+
+	if (cpus.empty())
+	{
+		return;
+	}
+
+	if (!utils::set_thread_affinity(cpus))
+	{
+		LOG_ERROR(GENERAL, "Thread placement: failed to bind '%s' to %s", name, utils::format_cpu_list(cpus));
+		return;
+	}
+
+	LOG_NOTICE(GENERAL, "Thread placement: '%s' (%s) bound to %s", name, type, utils::format_cpu_list(cpus));
+
+	// Host threads are reused, so restore the affinity
+	thread_ctrl::atexit([]
+	{
+		utils::set_thread_affinity({});
+	});
+}
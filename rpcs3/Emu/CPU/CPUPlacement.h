@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../Utilities/types.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Emulator thread classes handled by the placement
+enum class thread_class : u32
+{
+	rsx,
+	ppu,
+	spu,
+	mfc,
+};
+
+// Host core placement of emulator threads (see "Thread Placement" option).
+// Automatic policy: RSX gets its own physical core, PPU and MFC threads share the rest of the same cache group,
+// every SPU thread group is kept within a single cache group (CCX) chosen by the current load.
+class thread_placement final
+{
+	std::mutex m_mutex;
+
+	std::vector<u32> m_rsx;
+	std::vector<u32> m_ppu;
+	std::vector<u32> m_mfc;
+
+	struct spu_domain
+	{
+		std::vector<u32> cpus;
+		u32 threads; // Amount of SPU threads placed
+	};
+
+	std::vector<spu_domain> m_spu;
+
+	struct spu_group_info
+	{
+		u32 domain;
+		u32 threads;
+	};
+
+	// SPU thread groups placed (key: lv2_spu_group address, 0 for Raw SPUs)
+	std::unordered_map<u64, spu_group_info> m_groups;
+
+	// Split the list of processors by cache groups
+	void set_spu_domains(const std::vector<u32>& cpus);
+
+public:
+	thread_placement();
+
+	// Bind current thread, placement is reset when the thread exits (group only matters for SPU threads)
+	static void apply(thread_class type, const std::string& name, u64 group = 0);
+};
@@ -50,6 +50,13 @@ void cpu_thread::on_task()
 
 	g_tls_current_cpu_thread = this;
 
+	// Reset TLS variables at exit (the host thread may be reused)
+	thread_ctrl::atexit([this]
+	{
+		vm::passive_unlock(*this);
+		g_tls_current_cpu_thread = nullptr;
+	});
+
 	// Check thread status
 	while (!test(state, cpu_flag::exit + cpu_flag::dbg_global_stop))
 	{
@@ -206,10 +213,13 @@ void cpu_thread::set_native_priority(int priority)
 #endif // _WIN32
 }
 
-void cpu_thread::set_ideal_processor_core(int core)
+int cpu_thread::set_ideal_processor_core(int core)
 {
 #ifdef _WIN32
 	HANDLE _this_thread = GetCurrentThread();
-	SetThreadIdealProcessor(_this_thread, core);
+	const DWORD prev = SetThreadIdealProcessor(_this_thread, core);
+	return prev == static_cast<DWORD>(-1) ? -1 : static_cast<int>(prev);
+#else
+	return -1;
 #endif
 }
\ No newline at end of file
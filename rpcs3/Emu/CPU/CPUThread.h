@@ -68,7 +68,7 @@ public:
 
 	//native scheduler tweaks
 	void set_native_priority(int priority);
-	void set_ideal_processor_core(int core);
+	int set_ideal_processor_core(int core); // Returns the previous ideal core (or -1)
 };
 
 inline cpu_thread* get_current_cpu_thread() noexcept
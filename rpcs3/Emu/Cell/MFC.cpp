@@ -2,6 +2,7 @@
 #include "Emu/Memory/vm.h"
 #include "Emu/Cell/SPUThread.h"
 #include "Emu/Cell/lv2/sys_sync.h"
+#include "Emu/CPU/CPUPlacement.h"
 #include "MFC.h"
 
 template <>
@@ -67,6 +68,11 @@ std::string mfc_thread::get_name() const
 	return "MFC Thread";
 }
 
+void mfc_thread::on_spawn()
+{
+	thread_placement::apply(thread_class::mfc, get_name());
+}
+
 void mfc_thread::cpu_task()
 {
 	vm::passive_lock(*this);
@@ -142,12 +148,10 @@ void mfc_thread::cpu_task()
 					cmd.size = 0;
 					no_updates = 0;
 
-					vm::reservation_acquire(cmd.eal, 128);
-
 					// Store unconditionally
-					vm::writer_lock lock(0);
+					const u64 stamp = vm::reservation_lock(cmd.eal, 128);
 					data = to_write;
-					vm::reservation_update(cmd.eal, 128);
+					vm::reservation_unlock(cmd.eal, stamp, true);
 					vm::notify(cmd.eal, 128);
 				}
 				else if (cmd.cmd & MFC_LIST_MASK)
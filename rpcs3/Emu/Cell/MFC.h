@@ -110,6 +110,8 @@ public:
 
 	virtual std::string get_name() const override;
 
+	virtual void on_spawn() override;
+
 	virtual void cpu_task() override;
 
 	virtual void add_spu(spu_ptr _spu);
@@ -0,0 +1,252 @@
+#include "stdafx.h"
+#include "Emu/System.h"
+
+// STB_IMAGE_IMPLEMENTATION is already defined in stb_image.cpp
+#include <stb_image.h>
+
+#include "ImageDecoder.h"
+
+#include <algorithm>
+#include <thread>
+
+void img_convert(u8* dst, u32 dst_pitch, const u8* src, u32 width, u32 height, img_format format, bool flip, s32 alpha)
+{
+	const __m128i argb_mask = _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+	const __m128i rgb_mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	// Alpha channel position in the output pixel
+	const __m128i alpha_mask = format == img_format::argb ? _mm_set1_epi32(0xff) : _mm_set1_epi32(0xff000000);
+	const __m128i alpha_value = _mm_and_si128(alpha_mask, _mm_set1_epi8(static_cast<u8>(alpha)));
+
+	// Pixels which don't fit in dst_pitch are not written
+	const u32 columns = std::min<u32>(width, dst_pitch / (format == img_format::rgb ? 3 : 4));
+
+	for (u32 row = 0; row < height; row++)
+	{
+		const u8* const in = src + (flip ? height - row - 1 : row) * width * 4;
+		u8* const out = dst + row * dst_pitch;
+
+		u32 i = 0;
+
+		switch (format)
+		{
+		case img_format::rgba:
+		case img_format::argb:
+		{
+			if (format == img_format::rgba && alpha < 0)
+			{
+				std::memcpy(out, in, columns * 4);
+				continue;
+			}
+
+			for (; i + 4 <= columns; i += 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+
+				if (format == img_format::argb)
+				{
+					v = _mm_shuffle_epi8(v, argb_mask);
+				}
+
+				if (alpha >= 0)
+				{
+					v = _mm_or_si128(_mm_andnot_si128(alpha_mask, v), alpha_value);
+				}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), v);
+			}
+
+			for (; i < columns; i++)
+			{
+				const u8* p = in + i * 4;
+				const u8 a = alpha >= 0 ? static_cast<u8>(alpha) : p[3];
+
+				if (format == img_format::argb)
+				{
+					out[i * 4 + 0] = a;
+					out[i * 4 + 1] = p[0];
+					out[i * 4 + 2] = p[1];
+					out[i * 4 + 3] = p[2];
+				}
+				else
+				{
+					out[i * 4 + 0] = p[0];
+					out[i * 4 + 1] = p[1];
+					out[i * 4 + 2] = p[2];
+					out[i * 4 + 3] = a;
+				}
+			}
+
+			break;
+		}
+		case img_format::rgb:
+		{
+			// Each store writes 4 extra bytes, overwritten by the next iteration (must stay within the line)
+			for (; i + 6 <= columns; i += 4)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3), _mm_shuffle_epi8(v, rgb_mask));
+			}
+
+			for (; i < columns; i++)
+			{
+				out[i * 3 + 0] = in[i * 4 + 0];
+				out[i * 3 + 1] = in[i * 4 + 1];
+				out[i * 3 + 2] = in[i * 4 + 2];
+			}
+
+			break;
+		}
+		}
+	}
+}
+
+void img_decode_task::run()
+{
+	int width, height, actual_components;
+
+	const auto pixels = stbi_load_from_memory(m_src.data(), ::narrow<int>(m_src.size(), HERE), &width, &height, &actual_components, 4);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_pixels.reset(pixels);
+	m_width = width;
+	m_height = height;
+	m_state = state::done;
+
+	// Release the source
+	std::vector<u8>().swap(m_src);
+
+	m_cv.notify_all();
+}
+
+const u8* img_decode_task::get(s32& width, s32& height)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_state == state::queued)
+	{
+		// Don't wait for a worker
+		m_state = state::running;
+		lock.unlock();
+		run();
+		lock.lock();
+	}
+
+	while (m_state != state::done)
+	{
+		m_cv.wait(lock);
+	}
+
+	width = m_width;
+	height = m_height;
+	return m_pixels.get();
+}
+
+img_decoder_pool::~img_decoder_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+
+	cv.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker->join();
+	}
+}
+
+void img_decoder_pool::submit(u64 key, std::vector<u8>&& src)
+{
+	const auto req = std::make_shared<img_decode_task>(std::move(src));
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (workers.empty())
+		{
+			const u32 count = std::max<u32>(1, std::min<u32>(max_workers, std::thread::hardware_concurrency() / 2));
+
+			workers.resize(count);
+
+			for (u32 i = 0; i < count; i++)
+			{
+				thread_ctrl::spawn(workers[i], fmt::format("Image Decoder #%u", i), [this] { task(); });
+			}
+		}
+
+		pending[key] = req;
+		queue.emplace_back(req);
+	}
+
+	cv.notify_one();
+}
+
+std::shared_ptr<img_decode_task> img_decoder_pool::take(u64 key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto found = pending.find(key);
+
+	if (found == pending.end())
+	{
+		return nullptr;
+	}
+
+	const auto req = std::move(found->second);
+	pending.erase(found);
+	return req;
+}
+
+void img_decoder_pool::cancel(u64 key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto found = pending.find(key);
+
+	if (found != pending.end())
+	{
+		queue.erase(std::remove(queue.begin(), queue.end(), found->second), queue.end());
+		pending.erase(found);
+	}
+}
+
+void img_decoder_pool::task()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (!quit && !Emu.IsStopped())
+	{
+		if (queue.empty())
+		{
+			cv.wait(lock);
+			continue;
+		}
+
+		const auto req = std::move(queue.front());
+		queue.pop_front();
+		lock.unlock();
+
+		bool run = false;
+		{
+			std::lock_guard<std::mutex> req_lock(req->m_mutex);
+
+			// The request could have been taken by DecodeData
+			if (req->m_state == img_decode_task::state::queued)
+			{
+				req->m_state = img_decode_task::state::running;
+				run = true;
+			}
+		}
+
+		if (run)
+		{
+			req->run();
+		}
+
+		lock.lock();
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Utilities/types.h"
+#include "Utilities/Thread.h"
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+// Output pixel format of img_convert
+enum class img_format : u32
+{
+	rgba,
+	argb,
+	rgb,
+};
+
+// Convert decoded RGBA image and write it to the output buffer (guest memory).
+// dst_pitch may exceed the line size (padding is left untouched), or clip the lines. alpha >= 0 replaces the alpha channel.
+void img_convert(u8* dst, u32 dst_pitch, const u8* src, u32 width, u32 height, img_format format, bool flip, s32 alpha = -1);
+
+// Image decoding request (RGBA output)
+class img_decode_task
+{
+	friend struct img_decoder_pool;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+
+	enum class state : u32
+	{
+		queued,
+		running,
+		done,
+	};
+
+	state m_state = state::queued;
+
+	std::vector<u8> m_src;
+
+	std::unique_ptr<u8, void(*)(void*)> m_pixels{nullptr, &::free};
+	s32 m_width = 0;
+	s32 m_height = 0;
+
+	void run();
+
+public:
+	explicit img_decode_task(std::vector<u8>&& src)
+		: m_src(std::move(src))
+	{
+	}
+
+	// Wait for the result (decodes in the calling thread if no worker picked the request yet). Returns nullptr on failure.
+	const u8* get(s32& width, s32& height);
+};
+
+// Host worker pool decoding images in the background.
+// Decoding starts as soon as the source is read (ReadHeader), so multiple images queued by the game are decoded concurrently.
+struct img_decoder_pool
+{
+	static constexpr u32 max_workers = 4;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::shared_ptr<img_decode_task>> queue;
+	bool quit = false;
+
+	// Requests which were not taken by DecodeData yet
+	std::unordered_map<u64, std::shared_ptr<img_decode_task>> pending;
+
+	std::vector<std::shared_ptr<thread_ctrl>> workers;
+
+	~img_decoder_pool();
+
+	// Start decoding (key identifies the decoder handle, replaces the previous request)
+	void submit(u64 key, std::vector<u8>&& src);
+
+	// Take the request (nullptr if it wasn't submitted)
+	std::shared_ptr<img_decode_task> take(u64 key);
+
+	// Discard the request (on Close)
+	void cancel(u64 key);
+
+	void task();
+};
@@ -6,10 +6,19 @@
 #include "Emu/Cell/lv2/sys_event.h"
 #include "Emu/Audio/AudioDumper.h"
 #include "Emu/Audio/AudioThread.h"
+#include "Emu/Audio/AudioRing.h"
 #include "cellAudio.h"
 
+#include "Utilities/sysinfo.h"
+
 #include <thread>
 
+#ifdef _MSC_VER
+#define AVX_TARGET
+#else
+#define AVX_TARGET __attribute__((target("avx")))
+#endif
+
 logs::channel cellAudio("cellAudio");
 
 void audio_config::on_init(const std::shared_ptr<void>& _this)
@@ -27,248 +36,464 @@ void audio_config::on_init(const std::shared_ptr<void>& _this)
 	named_thread::on_init(_this);
 }
 
-void audio_config::on_task()
+// Compute volume level for each frame of the block (part of cellAudioSetPortLevel functionality)
+static void audio_step_volume(audio_port& port, float* levels)
 {
-	AudioDumper m_dump(g_cfg.audio.dump_to_file ? 2 : 0); // Init AudioDumper for 2 channels if enabled
+	const auto param = port.level_set.load();
 
-	float buf2ch[2 * BUFFER_SIZE]{}; // intermediate buffer for 2 channels
-	float buf8ch[8 * BUFFER_SIZE]{}; // intermediate buffer for 8 channels
+	if (param.inc == 0.0f)
+	{
+		const __m128 level = _mm_set1_ps(port.level);
 
-	const u32 buf_sz = BUFFER_SIZE * (g_cfg.audio.convert_to_u16 ? 2 : 4) * (g_cfg.audio.downmix_to_2ch ? 2 : 8);
+		for (u32 i = 0; i < AUDIO_SAMPLES; i += 4)
+		{
+			_mm_store_ps(levels + i, level);
+		}
 
-	std::unique_ptr<float[]> out_buffer[BUFFER_NUM];
+		return;
+	}
 
-	for (u32 i = 0; i < BUFFER_NUM; i++)
+	// One step per frame until the target value is reached
+	const bool dec = param.inc < 0.0f;
+	const __m128 target = _mm_set1_ps(param.value);
+	const __m128 inc4 = _mm_set1_ps(param.inc * 4);
+
+	__m128 level = _mm_add_ps(_mm_set1_ps(port.level), _mm_mul_ps(_mm_set1_ps(param.inc), _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f)));
+
+	for (u32 i = 0; i < AUDIO_SAMPLES; i += 4)
 	{
-		out_buffer[i].reset(new float[8 * BUFFER_SIZE] {});
+		_mm_store_ps(levels + i, dec ? _mm_max_ps(level, target) : _mm_min_ps(level, target));
+		level = _mm_add_ps(level, inc4);
 	}
 
-	const auto audio = Emu.GetCallbacks().get_audio();
-	audio->Open(buf8ch, buf_sz);
+	port.level = levels[AUDIO_SAMPLES - 1];
 
-	while (fxm::check<audio_config>() && !Emu.IsStopped())
+	if (port.level == param.value)
 	{
-		if (Emu.IsPaused())
-		{
-			std::this_thread::sleep_for(1ms); // hack
-			continue;
-		}
+		port.level_set.compare_and_swap(param, { param.value, 0.0f });
+	}
+}
 
-		const u64 stamp0 = get_system_time();
+// Load 4 big-endian floats from the port buffer
+static inline __m128 audio_load(const be_t<f32>* in)
+{
+	const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	return _mm_castsi128_ps(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), mask));
+}
 
-		const u64 time_pos = stamp0 - start_time - Emu.GetPauseTime();
+// Mix 4 frames of the port (InCh channels) into OutCh vectors of the output layout
+template <u32 OutCh, u32 InCh>
+static inline void audio_mix_frames(__m128* out, const be_t<f32>* in, __m128 level);
 
-		// TODO: send beforemix event (in ~2,6 ms before mixing)
+template <>
+inline void audio_mix_frames<2, 2>(__m128* out, const be_t<f32>* in, __m128 level)
+{
+	out[0] = _mm_mul_ps(audio_load(in + 0), _mm_unpacklo_ps(level, level));
+	out[1] = _mm_mul_ps(audio_load(in + 4), _mm_unpackhi_ps(level, level));
+}
 
-		// precise time of sleeping: 5,(3) ms (or 256/48000 sec)
-		const u64 expected_time = m_counter * AUDIO_SAMPLES * 1000000 / 48000;
-		if (expected_time >= time_pos)
-		{
-			std::this_thread::sleep_for(1ms); // hack
-			continue;
-		}
+template <>
+inline void audio_mix_frames<8, 2>(__m128* out, const be_t<f32>* in, __m128 level)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 v0 = _mm_mul_ps(audio_load(in + 0), _mm_unpacklo_ps(level, level));
+	const __m128 v1 = _mm_mul_ps(audio_load(in + 4), _mm_unpackhi_ps(level, level));
+
+	out[0] = _mm_movelh_ps(v0, zero);
+	out[1] = zero;
+	out[2] = _mm_movehl_ps(zero, v0);
+	out[3] = zero;
+	out[4] = _mm_movelh_ps(v1, zero);
+	out[5] = zero;
+	out[6] = _mm_movehl_ps(zero, v1);
+	out[7] = zero;
+}
 
-		m_counter++;
+template <>
+inline void audio_mix_frames<2, 8>(__m128* out, const be_t<f32>* in, __m128 level)
+{
+	// Downmix: left + rear_left + side_left + (center + low_freq) * 0.708 (same for right)
+	const __m128 mid_k = _mm_set1_ps(0.708f);
 
-		const u32 out_pos = m_counter % BUFFER_NUM;
+	__m128 lr[4];
 
-		bool first_mix = true;
+	for (u32 f = 0; f < 4; f++)
+	{
+		const __m128 a = audio_load(in + f * 8 + 0); // left, right, center, low_freq
+		const __m128 b = audio_load(in + f * 8 + 4); // rear_left, rear_right, side_left, side_right
+		const __m128 s = _mm_add_ps(_mm_add_ps(a, b), _mm_movehl_ps(b, b));
+		const __m128 mid = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3))), mid_k);
+		lr[f] = _mm_add_ps(s, mid);
+	}
 
-		// mixing:
-		for (auto& port : ports)
-		{
-			if (port.state != audio_port_state::started) continue;
+	out[0] = _mm_mul_ps(_mm_movelh_ps(lr[0], lr[1]), _mm_unpacklo_ps(level, level));
+	out[1] = _mm_mul_ps(_mm_movelh_ps(lr[2], lr[3]), _mm_unpackhi_ps(level, level));
+}
 
-			const u32 block_size = port.channel * AUDIO_SAMPLES;
-			const u32 position = port.tag % port.block; // old value
-			const u32 buf_addr = port.addr.addr() + position * block_size * sizeof(float);
+template <>
+inline void audio_mix_frames<8, 8>(__m128* out, const be_t<f32>* in, __m128 level)
+{
+	const __m128 l[4]
+	{
+		_mm_shuffle_ps(level, level, _MM_SHUFFLE(0, 0, 0, 0)),
+		_mm_shuffle_ps(level, level, _MM_SHUFFLE(1, 1, 1, 1)),
+		_mm_shuffle_ps(level, level, _MM_SHUFFLE(2, 2, 2, 2)),
+		_mm_shuffle_ps(level, level, _MM_SHUFFLE(3, 3, 3, 3)),
+	};
 
-			auto buf = vm::_ptr<f32>(buf_addr);
+	for (u32 i = 0; i < 8; i++)
+	{
+		out[i] = _mm_mul_ps(audio_load(in + i * 4), l[i / 2]);
+	}
+}
+
+// Mix the block of the port into the output buffer, optionally converting the result to s16
+template <u32 OutCh, u32 InCh, bool First, bool Convert>
+static void audio_mix_port(float* out, s16* out16, const be_t<f32>* in, const float* levels)
+{
+	const __m128 scale = _mm_set1_ps(0x8000);
+
+	for (u32 f = 0; f < AUDIO_SAMPLES; f += 4)
+	{
+		__m128 v[OutCh];
+		audio_mix_frames<OutCh, InCh>(v, in + f * InCh, _mm_load_ps(levels + f));
 
-			static const float k = 1.0f; // may be 1.0f
-			const float& m = port.level;
+		float* const dst = out + f * OutCh;
 
-			auto step_volume = [](audio_port& port) // part of cellAudioSetPortLevel functionality
+		for (u32 i = 0; i < OutCh; i++)
+		{
+			if (!First)
 			{
-				const auto param = port.level_set.load();
+				v[i] = _mm_add_ps(v[i], _mm_load_ps(dst + i * 4));
+			}
 
-				if (param.inc != 0.0f)
-				{
-					port.level += param.inc;
-					const bool dec = param.inc < 0.0f;
-
-					if ((!dec && param.value - port.level <= 0.0f) || (dec && param.value - port.level >= 0.0f))
-					{
-						port.level = param.value;
-						port.level_set.compare_and_swap(param, { param.value, 0.0f });
-					}
-				}
-			};
+			_mm_store_ps(dst + i * 4, v[i]);
+		}
 
-			if (port.channel == 2)
+		if (Convert)
+		{
+			// CVTPS2DQ + PACKSSDW (converts to s16 with signed saturation)
+			for (u32 i = 0; i < OutCh; i += 2)
 			{
-				if (first_mix)
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						// reverse byte order
-						const float left = buf[i + 0] * m;
-						const float right = buf[i + 1] * m;
-
-						buf2ch[i + 0] = left;
-						buf2ch[i + 1] = right;
-
-						buf8ch[i * 4 + 0] = left;
-						buf8ch[i * 4 + 1] = right;
-						buf8ch[i * 4 + 2] = 0.0f;
-						buf8ch[i * 4 + 3] = 0.0f;
-						buf8ch[i * 4 + 4] = 0.0f;
-						buf8ch[i * 4 + 5] = 0.0f;
-						buf8ch[i * 4 + 6] = 0.0f;
-						buf8ch[i * 4 + 7] = 0.0f;
-					}
-					first_mix = false;
-				}
-				else
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
+				const __m128i r = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(v[i], scale)), _mm_cvtps_epi32(_mm_mul_ps(v[i + 1], scale)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out16 + f * OutCh + i * 4), r);
+			}
+		}
+	}
+}
 
-						const float left = buf[i + 0] * m;
-						const float right = buf[i + 1] * m;
+// Load 8 big-endian floats from the port buffer (AVX has no 256-bit PSHUFB)
+AVX_TARGET static inline __m256 audio_load_avx(const be_t<f32>* in)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(audio_load(in)), audio_load(in + 4), 1);
+}
 
-						buf2ch[i + 0] += left;
-						buf2ch[i + 1] += right;
+// Per-frame level for 2-channel output: {l0 l0 l1 l1 l2 l2 l3 l3} and {l4 l4 l5 l5 l6 l6 l7 l7}
+AVX_TARGET static inline void audio_level_2ch_avx(__m256 level, __m256& lo, __m256& hi)
+{
+	const __m256 a = _mm256_unpacklo_ps(level, level);
+	const __m256 b = _mm256_unpackhi_ps(level, level);
+	lo = _mm256_permute2f128_ps(a, b, 0x20);
+	hi = _mm256_permute2f128_ps(a, b, 0x31);
+}
 
-						buf8ch[i * 4 + 0] += left;
-						buf8ch[i * 4 + 1] += right;
-					}
-				}
-			}
-			else if (port.channel == 8)
+// Mix 8 frames of the port (InCh channels) into OutCh vectors of the output layout
+template <u32 OutCh, u32 InCh>
+static inline void audio_mix_frames_avx(__m256* out, const be_t<f32>* in, const float* levels);
+
+template <>
+AVX_TARGET inline void audio_mix_frames_avx<2, 2>(__m256* out, const be_t<f32>* in, const float* levels)
+{
+	__m256 lo, hi;
+	audio_level_2ch_avx(_mm256_loadu_ps(levels), lo, hi);
+	out[0] = _mm256_mul_ps(audio_load_avx(in + 0), lo);
+	out[1] = _mm256_mul_ps(audio_load_avx(in + 8), hi);
+}
+
+template <>
+AVX_TARGET inline void audio_mix_frames_avx<8, 2>(__m256* out, const be_t<f32>* in, const float* levels)
+{
+	__m256 lo, hi;
+	audio_level_2ch_avx(_mm256_loadu_ps(levels), lo, hi);
+
+	const __m256 v[2]{_mm256_mul_ps(audio_load_avx(in + 0), lo), _mm256_mul_ps(audio_load_avx(in + 8), hi)};
+	const __m128 zero = _mm_setzero_ps();
+
+	// One frame per output vector: {left, right, 0, 0, 0, 0, 0, 0}
+	for (u32 i = 0; i < 2; i++)
+	{
+		const __m128 a = _mm256_castps256_ps128(v[i]);
+		const __m128 b = _mm256_extractf128_ps(v[i], 1);
+
+		out[i * 4 + 0] = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_movelh_ps(a, zero), 0);
+		out[i * 4 + 1] = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_movehl_ps(zero, a), 0);
+		out[i * 4 + 2] = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_movelh_ps(b, zero), 0);
+		out[i * 4 + 3] = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_movehl_ps(zero, b), 0);
+	}
+}
+
+template <>
+AVX_TARGET inline void audio_mix_frames_avx<2, 8>(__m256* out, const be_t<f32>* in, const float* levels)
+{
+	// Same downmix as the SSE version, two frames per register (frame pairs are chosen to simplify the final shuffle)
+	const __m256 mid_k = _mm256_set1_ps(0.708f);
+	const u32 pairs[4][2]{{0, 2}, {1, 3}, {4, 6}, {5, 7}};
+
+	__m256 lr[4];
+
+	for (u32 p = 0; p < 4; p++)
+	{
+		const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(audio_load(in + pairs[p][0] * 8)), audio_load(in + pairs[p][1] * 8), 1);
+		const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(audio_load(in + pairs[p][0] * 8 + 4)), audio_load(in + pairs[p][1] * 8 + 4), 1);
+		const __m256 s = _mm256_add_ps(_mm256_add_ps(a, b), _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 2, 3, 2)));
+		const __m256 mid = _mm256_mul_ps(_mm256_add_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3))), mid_k);
+		lr[p] = _mm256_add_ps(s, mid);
+	}
+
+	__m256 lo, hi;
+	audio_level_2ch_avx(_mm256_loadu_ps(levels), lo, hi);
+	out[0] = _mm256_mul_ps(_mm256_shuffle_ps(lr[0], lr[1], _MM_SHUFFLE(1, 0, 1, 0)), lo);
+	out[1] = _mm256_mul_ps(_mm256_shuffle_ps(lr[2], lr[3], _MM_SHUFFLE(1, 0, 1, 0)), hi);
+}
+
+template <>
+AVX_TARGET inline void audio_mix_frames_avx<8, 8>(__m256* out, const be_t<f32>* in, const float* levels)
+{
+	for (u32 i = 0; i < 8; i++)
+	{
+		out[i] = _mm256_mul_ps(audio_load_avx(in + i * 8), _mm256_broadcast_ss(levels + i));
+	}
+}
+
+// AVX version of audio_mix_port (8 frames per iteration)
+template <u32 OutCh, u32 InCh, bool First, bool Convert>
+AVX_TARGET static void audio_mix_port_avx(float* out, s16* out16, const be_t<f32>* in, const float* levels)
+{
+	const __m256 scale = _mm256_set1_ps(0x8000);
+
+	for (u32 f = 0; f < AUDIO_SAMPLES; f += 8)
+	{
+		__m256 v[OutCh];
+		audio_mix_frames_avx<OutCh, InCh>(v, in + f * InCh, levels + f);
+
+		float* const dst = out + f * OutCh;
+
+		for (u32 i = 0; i < OutCh; i++)
+		{
+			if (!First)
 			{
-				if (first_mix)
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						const float left = buf[i * 4 + 0] * m;
-						const float right = buf[i * 4 + 1] * m;
-						const float center = buf[i * 4 + 2] * m;
-						const float low_freq = buf[i * 4 + 3] * m;
-						const float rear_left = buf[i * 4 + 4] * m;
-						const float rear_right = buf[i * 4 + 5] * m;
-						const float side_left = buf[i * 4 + 6] * m;
-						const float side_right = buf[i * 4 + 7] * m;
-
-						const float mid = (center + low_freq) * 0.708f;
-						buf2ch[i + 0] = (left + rear_left + side_left + mid) * k;
-						buf2ch[i + 1] = (right + rear_right + side_right + mid) * k;
-
-						buf8ch[i * 4 + 0] = left;
-						buf8ch[i * 4 + 1] = right;
-						buf8ch[i * 4 + 2] = center;
-						buf8ch[i * 4 + 3] = low_freq;
-						buf8ch[i * 4 + 4] = rear_left;
-						buf8ch[i * 4 + 5] = rear_right;
-						buf8ch[i * 4 + 6] = side_left;
-						buf8ch[i * 4 + 7] = side_right;
-					}
-					first_mix = false;
-				}
-				else
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						const float left = buf[i * 4 + 0] * m;
-						const float right = buf[i * 4 + 1] * m;
-						const float center = buf[i * 4 + 2] * m;
-						const float low_freq = buf[i * 4 + 3] * m;
-						const float rear_left = buf[i * 4 + 4] * m;
-						const float rear_right = buf[i * 4 + 5] * m;
-						const float side_left = buf[i * 4 + 6] * m;
-						const float side_right = buf[i * 4 + 7] * m;
-
-						const float mid = (center + low_freq) * 0.708f;
-						buf2ch[i + 0] += (left + rear_left + side_left + mid) * k;
-						buf2ch[i + 1] += (right + rear_right + side_right + mid) * k;
-
-						buf8ch[i * 4 + 0] += left;
-						buf8ch[i * 4 + 1] += right;
-						buf8ch[i * 4 + 2] += center;
-						buf8ch[i * 4 + 3] += low_freq;
-						buf8ch[i * 4 + 4] += rear_left;
-						buf8ch[i * 4 + 5] += rear_right;
-						buf8ch[i * 4 + 6] += side_left;
-						buf8ch[i * 4 + 7] += side_right;
-					}
-				}
+				v[i] = _mm256_add_ps(v[i], _mm256_loadu_ps(dst + i * 8));
 			}
-			else
+
+			_mm256_storeu_ps(dst + i * 8, v[i]);
+
+			if (Convert)
 			{
-				fmt::throw_exception("Unknown channel count (port=%u, channel=%d)" HERE, port.number, port.channel);
+				// VCVTPS2DQ + PACKSSDW (256-bit PACKSSDW requires AVX2)
+				const __m256i r = _mm256_cvtps_epi32(_mm256_mul_ps(v[i], scale));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out16 + f * OutCh + i * 8), _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extractf128_si256(r, 1)));
 			}
+		}
+	}
 
-			memset(buf, 0, block_size * sizeof(float));
+	_mm256_zeroupper();
+}
+
+static bool s_mix_avx = true;
+
+void audio_mix_set_avx(bool enabled)
+{
+	s_mix_avx = enabled;
+}
+
+template <u32 OutCh, u32 InCh>
+static void audio_mix_port(float* out, s16* out16, const be_t<f32>* in, const float* levels, bool first)
+{
+	static const bool has_avx = utils::has_avx();
+
+	if (s_mix_avx && has_avx)
+	{
+		if (first)
+		{
+			return out16 ? audio_mix_port_avx<OutCh, InCh, true, true>(out, out16, in, levels) : audio_mix_port_avx<OutCh, InCh, true, false>(out, out16, in, levels);
+		}
+
+		return out16 ? audio_mix_port_avx<OutCh, InCh, false, true>(out, out16, in, levels) : audio_mix_port_avx<OutCh, InCh, false, false>(out, out16, in, levels);
+	}
+
+	if (first)
+	{
+		return out16 ? audio_mix_port<OutCh, InCh, true, true>(out, out16, in, levels) : audio_mix_port<OutCh, InCh, true, false>(out, out16, in, levels);
+	}
+
+	return out16 ? audio_mix_port<OutCh, InCh, false, true>(out, out16, in, levels) : audio_mix_port<OutCh, InCh, false, false>(out, out16, in, levels);
+}
+
+template <u32 OutCh>
+static void audio_mix_port(u32 in_ch, float* out, s16* out16, const be_t<f32>* in, const float* levels, bool first)
+{
+	switch (in_ch)
+	{
+	case 2: return audio_mix_port<OutCh, 2>(out, out16, in, levels, first);
+	case 8: return audio_mix_port<OutCh, 8>(out, out16, in, levels, first);
+	}
+
+	fmt::throw_exception("Unknown channel count (channel=%d)" HERE, in_ch);
+}
+
+void audio_mix_block(u32 out_ch, u32 in_ch, float* out, s16* out16, const be_t<f32>* in, const float* levels, bool first)
+{
+	if (out_ch == 2)
+	{
+		return audio_mix_port<2>(in_ch, out, out16, in, levels, first);
+	}
+
+	return audio_mix_port<8>(in_ch, out, out16, in, levels, first);
+}
+
+void audio_config::on_task()
+{
+	// Output layout (only the configured one is mixed)
+	const u32 out_ch = g_cfg.audio.downmix_to_2ch ? 2 : 8;
+
+	AudioDumper m_dump(g_cfg.audio.dump_to_file ? out_ch : 0); // Init AudioDumper if enabled
+
+	const u32 buf_sz = BUFFER_SIZE * (g_cfg.audio.convert_to_u16 ? 2 : 4) * out_ch;
+
+	std::unique_ptr<float[]> out_buffer[BUFFER_NUM];
+
+	for (u32 i = 0; i < BUFFER_NUM; i++)
+	{
+		out_buffer[i].reset(new float[8 * BUFFER_SIZE] {});
+	}
+
+	alignas(16) float levels[AUDIO_SAMPLES]; // volume level for each frame of the port block
+	alignas(16) s16 buf_u16[8 * BUFFER_SIZE];
+
+	// Buffered output (fed from a separate thread), or direct output from the mixer thread
+	std::unique_ptr<audio_output> output;
+	std::shared_ptr<AudioThread> audio;
+
+	if (g_cfg.audio.enable_buffering && g_cfg.audio.renderer != audio_renderer::null)
+	{
+		output = std::make_unique<audio_output>(buf_sz, out_ch, !!g_cfg.audio.convert_to_u16, !!g_cfg.audio.time_stretching);
+	}
+	else
+	{
+		audio = Emu.GetCallbacks().get_audio();
+		audio->Open(out_buffer[0].get(), buf_sz);
+	}
+
+	// Mixing period: 5,(3) ms (or 256/48000 sec)
+	periodic_timer timer(AUDIO_SAMPLES * 1000000ull, 48000);
+	timer.start();
+
+	u64 pause_time = Emu.GetPauseTime();
+
+	while (fxm::check<audio_config>() && !Emu.IsStopped())
+	{
+		if (Emu.IsPaused())
+		{
+			thread_ctrl::wait_for(1000);
+			continue;
 		}
 
+		// Don't try to catch up after the pause
+		if (const u64 paused = Emu.GetPauseTime() - pause_time)
+		{
+			timer.delay(paused);
+			pause_time += paused;
+		}
 
-		if (!first_mix)
+		bool has_beforemix;
 		{
-			// Copy output data (2ch or 8ch)
-			if (g_cfg.audio.downmix_to_2ch)
-			{
-				for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i++)
-				{
-					out_buffer[out_pos][i] = buf2ch[i];
-				}
-			}
-			else
+			semaphore_lock lock(mutex);
+			has_beforemix = !keys_beforemix.empty();
+		}
+
+		// Send beforemix event (in ~2,6 ms before mixing)
+		if (has_beforemix)
+		{
+			timer.wait_until(timer.next() - AUDIO_SAMPLES * 1000000ull / 48000 / 2);
+
+			semaphore_lock lock(mutex);
+
+			for (u64 key : keys_beforemix)
 			{
-				for (u32 i = 0; i < (sizeof(buf8ch) / sizeof(float)); i++)
+				if (auto queue = lv2_event_queue::find(key))
 				{
-					out_buffer[out_pos][i] = buf8ch[i];
+					queue->send(0, 0, 0, 0); // TODO: check arguments
 				}
 			}
 		}
 
-		const u64 stamp1 = get_system_time();
+		// Blocks which were skipped because the thread fell behind (they are consumed without mixing)
+		const u64 skipped = timer.wait();
 
-		if (first_mix)
+		const u64 stamp0 = get_system_time();
+
+		const u64 time_pos = stamp0 - start_time - Emu.GetPauseTime();
+
+		m_counter += 1 + skipped;
+
+		const u32 out_pos = m_counter % BUFFER_NUM;
+
+		float* const out = out_buffer[out_pos].get();
+		s16* const out16 = g_cfg.audio.convert_to_u16 ? buf_u16 : nullptr;
+
+		// Collect started ports (the last mixed port also performs u16 conversion)
+		std::array<audio_port*, AUDIO_PORT_COUNT> active;
+		u32 active_count = 0;
+
+		for (auto& port : ports)
 		{
-			std::memset(out_buffer[out_pos].get(), 0, 8 * BUFFER_SIZE * sizeof(float));
+			if (port.state == audio_port_state::started)
+			{
+				active[active_count++] = &port;
+			}
 		}
 
-		if (g_cfg.audio.convert_to_u16)
+		// mixing:
+		for (u32 n = 0; n < active_count; n++)
 		{
-			// convert the data from float to u16 with clipping:
-			// 2x MULPS
-			// 2x MAXPS (optional)
-			// 2x MINPS (optional)
-			// 2x CVTPS2DQ (converts float to s32)
-			// PACKSSDW (converts s32 to s16 with signed saturation)
+			audio_port& port = *active[n];
 
-			__m128i buf_u16[BUFFER_SIZE];
+			const u32 block_size = port.channel * AUDIO_SAMPLES;
+			const u32 position = port.tag % port.block; // old value
+			const u32 buf_addr = port.addr.addr() + position * block_size * sizeof(float);
 
-			for (size_t i = 0; i < 8 * BUFFER_SIZE; i += 8)
+			auto buf = vm::_ptr<f32>(buf_addr);
+
+			audio_step_volume(port, levels);
+
+			s16* const conv = n + 1 == active_count ? out16 : nullptr;
+
+			audio_mix_block(out_ch, port.channel, out, conv, buf, levels, n == 0);
+
+			memset(buf, 0, block_size * sizeof(float));
+		}
+
+		const u64 stamp1 = get_system_time();
+
+		if (!active_count)
+		{
+			std::memset(out, 0, out_ch * BUFFER_SIZE * sizeof(float));
+
+			if (out16)
 			{
-				const auto scale = _mm_set1_ps(0x8000);
-				buf_u16[i / 8] = _mm_packs_epi32(
-					_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(out_buffer[out_pos].get() + i), scale)),
-					_mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(out_buffer[out_pos].get() + i + 4), scale)));
+				std::memset(out16, 0, out_ch * BUFFER_SIZE * sizeof(s16));
 			}
+		}
+
+		const void* const out_data = out16 ? static_cast<const void*>(out16) : out;
 
-			audio->AddData(buf_u16, buf_sz);
+		if (output)
+		{
+			output->push(out_data);
 		}
 		else
 		{
-			audio->AddData(out_buffer[out_pos].get(), buf_sz);
+			audio->AddData(out_data, buf_sz);
 		}
 
 		const u64 stamp2 = get_system_time();
@@ -283,9 +508,17 @@ void audio_config::on_task()
 				if (port.state != audio_port_state::started) continue;
 
 				u32 position = port.tag % port.block; // old value
+
+				// Clear skipped blocks like the mixed ones
+				for (u64 j = 1; j <= std::min<u64>(skipped, port.block - 1); j++)
+				{
+					const u32 block_size = port.channel * AUDIO_SAMPLES;
+					std::memset(vm::base(port.addr.addr() + (position + j) % port.block * block_size * sizeof(float)), 0, block_size * sizeof(float));
+				}
+
 				port.counter = m_counter;
-				port.tag++; // absolute index of block that will be read
-				m_indexes[i] = (position + 1) % port.block; // write new value
+				port.tag += 1 + skipped; // absolute index of block that will be read
+				m_indexes[i] = (position + 1 + skipped) % port.block; // write new value
 			}
 
 			// send aftermix event (normal audio event)
@@ -303,15 +536,21 @@ void audio_config::on_task()
 
 		const u64 stamp3 = get_system_time();
 
-		switch (m_dump.GetCh())
+		if (m_dump.GetCh())
 		{
-		case 2: m_dump.WriteData(&buf2ch, sizeof(buf2ch)); break; // write file data (2 ch)
-		case 8: m_dump.WriteData(&buf8ch, sizeof(buf8ch)); break; // write file data (8 ch)
+			m_dump.WriteData(out, out_ch * BUFFER_SIZE * sizeof(float)); // write file data
 		}
 
 		cellAudio.trace("Audio perf: start=%d (access=%d, AddData=%d, events=%d, dump=%d)",
 			time_pos, stamp1 - stamp0, stamp2 - stamp1, stamp3 - stamp2, get_system_time() - stamp3);
 	}
+
+	cellAudio.notice("Audio timer: %s", timer.get_stats());
+
+	if (output)
+	{
+		cellAudio.notice("Audio output: %s", output->get_stats());
+	}
 }
 
 s32 cellAudioInit()
@@ -735,9 +974,33 @@ s32 cellAudioSetNotifyEventQueue(u64 key)
 
 s32 cellAudioSetNotifyEventQueueEx(u64 key, u32 iFlags)
 {
-	cellAudio.todo("cellAudioSetNotifyEventQueueEx(key=0x%llx, iFlags=0x%x)", key, iFlags);
+	cellAudio.warning("cellAudioSetNotifyEventQueueEx(key=0x%llx, iFlags=0x%x)", key, iFlags);
 
-	// TODO
+	if (const u32 flags = iFlags & ~CELL_AUDIO_EVENTFLAG_BEFOREMIX)
+	{
+		cellAudio.todo("cellAudioSetNotifyEventQueueEx(): unhandled flags (0x%x)", flags);
+	}
+
+	const auto g_audio = fxm::get<audio_config>();
+
+	if (!g_audio)
+	{
+		return CELL_AUDIO_ERROR_NOT_INIT;
+	}
+
+	semaphore_lock lock(g_audio->mutex);
+
+	auto& keys = iFlags & CELL_AUDIO_EVENTFLAG_BEFOREMIX ? g_audio->keys_beforemix : g_audio->keys;
+
+	for (auto k : keys) // check for duplicates
+	{
+		if (k == key)
+		{
+			return CELL_AUDIO_ERROR_TRANS_EVENT;
+		}
+	}
+
+	keys.emplace_back(key);
 
 	return CELL_OK;
 }
@@ -770,11 +1033,35 @@ s32 cellAudioRemoveNotifyEventQueue(u64 key)
 
 s32 cellAudioRemoveNotifyEventQueueEx(u64 key, u32 iFlags)
 {
-	cellAudio.todo("cellAudioRemoveNotifyEventQueueEx(key=0x%llx, iFlags=0x%x)", key, iFlags);
+	cellAudio.warning("cellAudioRemoveNotifyEventQueueEx(key=0x%llx, iFlags=0x%x)", key, iFlags);
 
-	// TODO
+	if (const u32 flags = iFlags & ~CELL_AUDIO_EVENTFLAG_BEFOREMIX)
+	{
+		cellAudio.todo("cellAudioRemoveNotifyEventQueueEx(): unhandled flags (0x%x)", flags);
+	}
 
-	return CELL_OK;
+	const auto g_audio = fxm::get<audio_config>();
+
+	if (!g_audio)
+	{
+		return CELL_AUDIO_ERROR_NOT_INIT;
+	}
+
+	semaphore_lock lock(g_audio->mutex);
+
+	auto& keys = iFlags & CELL_AUDIO_EVENTFLAG_BEFOREMIX ? g_audio->keys_beforemix : g_audio->keys;
+
+	for (auto i = keys.begin(); i != keys.end(); i++)
+	{
+		if (*i == key)
+		{
+			keys.erase(i);
+
+			return CELL_OK;
+		}
+	}
+
+	return CELL_AUDIO_ERROR_TRANS_EVENT;
 }
 
 s32 cellAudioAddData(u32 portNum, vm::ptr<float> src, u32 samples, float volume)
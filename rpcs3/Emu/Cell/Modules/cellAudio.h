@@ -119,6 +119,12 @@ struct audio_port
 	atomic_t<level_set_t> level_set;
 };
 
+// Mix the block of the port (in_ch = 2 or 8) into the output buffer (out_ch = 2 or 8), optionally converting the result to s16
+void audio_mix_block(u32 out_ch, u32 in_ch, float* out, s16* out16, const be_t<f32>* in, const float* levels, bool first);
+
+// Allow the AVX mixer if supported by the CPU (enabled by default)
+void audio_mix_set_avx(bool enabled);
+
 class audio_config final : public named_thread
 {
 	void on_task() override;
@@ -139,6 +145,8 @@ public:
 
 	std::vector<u64> keys;
 
+	std::vector<u64> keys_beforemix; // CELL_AUDIO_EVENTFLAG_BEFOREMIX
+
 	semaphore<> mutex;
 
 	audio_config() = default;
@@ -8,73 +8,18 @@
 #include "cellDmux.h"
 
 #include <thread>
+#include <deque>
 
 logs::channel cellDmux("cellDmux");
 
 /* Demuxer Thread Classes */
 
-enum
-{
-	/* http://dvd.sourceforge.net/dvdinfo/mpeghdrs.html */
-
-	PACKET_START_CODE_MASK   = 0xffffff00,
-	PACKET_START_CODE_PREFIX = 0x00000100,
-
-	PACK_START_CODE          = 0x000001ba,
-	SYSTEM_HEADER_START_CODE = 0x000001bb,
-	PRIVATE_STREAM_1         = 0x000001bd,
-	PADDING_STREAM           = 0x000001be,
-	PRIVATE_STREAM_2         = 0x000001bf,
-};
-
 struct DemuxerStream
 {
 	u32 addr;
 	u32 size;
 	u64 userdata;
 	bool discontinuity;
-
-	template<typename T>
-	bool get(T& out)
-	{
-		if (sizeof(T) > size) return false;
-
-		out = vm::_ref<T>(addr);
-		addr += sizeof(T);
-		size -= sizeof(T);
-
-		return true;
-	}
-
-	template<typename T>
-	bool peek(T& out, u32 shift = 0)
-	{
-		if (sizeof(T) + shift > size) return false;
-
-		out = vm::_ref<T>(addr + shift);
-		return true;
-	}
-
-	void skip(u32 count)
-	{
-		addr += count;
-		size = size > count ? size - count : 0;
-	}
-
-	bool check(u32 count) const
-	{
-		return count <= size;
-	}
-
-	u64 get_ts(u8 c)
-	{
-		u8 v[4]; get((u32&)v); 
-		return
-			(((u64)c & 0x0e) << 29) | 
-			(((u64)v[0]) << 21) |
-			(((u64)v[1] & 0x7e) << 15) |
-			(((u64)v[2]) << 7) | ((u64)v[3] >> 1);
-	}
 };
 
 struct PesHeader
@@ -85,7 +30,8 @@ struct PesHeader
 	bool has_ts;
 	bool is_ok;
 
-	PesHeader(DemuxerStream& stream);
+	// Parse PES header (data points after the packet length field)
+	PesHeader(const u8* data, u32 avail);
 };
 
 class ElementaryStream;
@@ -141,13 +87,20 @@ class ElementaryStream
 
 	u32 put; // AU that is being written now
 
-	bool is_full(u32 space);
+	// Check whether the data of specified size doesn't fit at the position pos
+	bool is_full(u32 pos, u32 space);
+
+	// Check whether the remaining incomplete AU data doesn't fit after the AU of specified size
+	bool is_full_after_au(u32 size);
 
 public:
 	static const u32 id_base = 1;
 	static const u32 id_step = 1;
 	static const u32 id_count = 1023;
 
+	// Space kept after the incomplete AU (for moving the remaining data after push_au)
+	static const u32 au_reserve = 256;
+
 	ElementaryStream(Demuxer* dmux, u32 addr, u32 size, u32 fidMajor, u32 fidMinor, u32 sup1, u32 sup2, vm::ptr<CellDmuxCbEsMsg> cbFunc, u32 cbArg, u32 spec);
 
 	Demuxer* dmux;
@@ -162,15 +115,21 @@ public:
 	const u32 cbArg;
 	const u32 spec; //addr
 
-	std::vector<u8> raw_data; // demultiplexed data stream (managed by demuxer thread)
-	size_t raw_pos; // should be <= raw_data.size()
+	std::deque<DemuxerPacket> packets; // packets waiting for delivery (managed by demuxer thread)
+	u32 pending; // size of incomplete AU data stored in place (managed by demuxer thread)
 	u64 last_dts;
 	u64 last_pts;
 
-	void push(DemuxerStream& stream, u32 size); // called by demuxer thread (not multithread-safe)
+	// Copy data directly after the incomplete AU data, returns false if there is no space
+	bool append(u32 addr, u32 size);
+
+	// Get incomplete AU data
+	const u8* pending_data();
 
-	bool isfull(u32 space);
+	// Check whether push_au can be called for specified size (every AU moves the remaining data by up to 255 bytes)
+	bool can_push_au(u32 size);
 
+	// Make AU from the first bytes of the incomplete AU data
 	void push_au(u32 size, u64 dts, u64 pts, u64 userdata, bool rap, u32 specific);
 
 	bool release();
@@ -206,297 +165,168 @@ public:
 	{
 	}
 
-	virtual void cpu_task() override
+	u32 cb_add = 0;
+
+	void es_callback(ElementaryStream& es, CellDmuxEsMsgType type, u64 userdata)
 	{
-		DemuxerTask task;
-		DemuxerStream stream = {};
-		ElementaryStream* esALL[96]; memset(esALL, 0, sizeof(esALL));
-		ElementaryStream** esAVC = &esALL[0]; // AVC (max 16 minus M2V count)
-		ElementaryStream** esM2V = &esALL[16]; // M2V (max 16 minus AVC count)
-		ElementaryStream** esDATA = &esALL[32]; // user data (max 16)
-		ElementaryStream** esATX = &esALL[48]; // ATRAC3+ (max 16)
-		ElementaryStream** esAC3 = &esALL[64]; // AC3 (max 16)
-		ElementaryStream** esPCM = &esALL[80]; // LPCM (max 16)
+		auto esMsg = vm::ptr<CellDmuxEsMsg>::make(memAddr + (cb_add ^= 16));
+		esMsg->msgType = type;
+		esMsg->supplementalInfo = userdata;
+		es.cbFunc(*this, id, es.id, esMsg, es.cbArg);
+		lv2_obj::sleep(*this);
+	}
 
-		u32 cb_add = 0;
+	void dmux_callback(CellDmuxMsgType type, u64 userdata)
+	{
+		auto dmuxMsg = vm::ptr<CellDmuxMsg>::make(memAddr + (cb_add ^= 16));
+		dmuxMsg->msgType = type;
+		dmuxMsg->supplementalInfo = userdata;
+		cbFunc(*this, id, dmuxMsg, cbArg);
+		lv2_obj::sleep(*this);
+	}
 
-		while (true)
+	// Build AUs from queued packets of the ES until its buffer is full (returns false in this case)
+	bool deliver(ElementaryStream& es, u64 userdata)
+	{
+		while (!es.packets.empty())
 		{
-			if (Emu.IsStopped() || is_closed)
-			{
-				break;
-			}
-			
-			if (!job.try_peek(task) && is_running && stream.addr)
-			{
-				// default task (demuxing) (if there is no other work)
-				be_t<u32> code;
-				be_t<u16> len;
-
-				if (!stream.peek(code)) 
-				{
-					// demuxing finished
-					is_running = false;
-
-					// callback
-					auto dmuxMsg = vm::ptr<CellDmuxMsg>::make(memAddr + (cb_add ^= 16));
-					dmuxMsg->msgType = CELL_DMUX_MSG_TYPE_DEMUX_DONE;
-					dmuxMsg->supplementalInfo = stream.userdata;
-					cbFunc(*this, id, dmuxMsg, cbArg);
-					lv2_obj::sleep(*this);
-
-					is_working = false;
+			const DemuxerPacket& pkt = es.packets.front();
 
-					stream = {};
-					
-					continue;
-				}
-				
-				switch (code)
-				{
-				case PACK_START_CODE:
+			if ((es.fidMajor & -0x10) == 0xe0)
+			{
+				// AVC: push AU if it becomes too big or the next packet contains PTS/DTS
+				if ((pkt.has_ts && es.pending) || es.pending >= 0x69800)
 				{
-					if (!stream.check(14))
+					if (!es.can_push_au(es.pending))
 					{
-						fmt::throw_exception("End of stream (PACK_START_CODE)" HERE);
+						return false;
 					}
-					stream.skip(14);
-					break;
+
+					es.push_au(es.pending, es.last_dts, es.last_pts, userdata, false /* TODO: set correct value */, 0);
+					es_callback(es, CELL_DMUX_ES_MSG_TYPE_AU_FOUND, userdata);
 				}
 
-				case SYSTEM_HEADER_START_CODE:
+				// Whole packets are stored (reconstruction of MPEG2-PS stream for vdec module)
+				if (!es.append(pkt.addr, pkt.size))
 				{
-					if (!stream.check(18))
-					{
-						fmt::throw_exception("End of stream (SYSTEM_HEADER_START_CODE)" HERE);
-					}
-					stream.skip(18);
-					break;
+					return false;
 				}
 
-				case PADDING_STREAM:
+				if (pkt.has_ts)
 				{
-					if (!stream.check(6))
-					{
-						fmt::throw_exception("End of stream (PADDING_STREAM)" HERE);
-					}
-					stream.skip(4);
-					stream.get(len);
-
-					if (!stream.check(len))
-					{
-						fmt::throw_exception("End of stream (PADDING_STREAM, len=%d)" HERE, len);
-					}
-					stream.skip(len);
-					break;
+					// preserve dts/pts for next AU
+					es.last_dts = pkt.dts;
+					es.last_pts = pkt.pts;
 				}
-
-				case PRIVATE_STREAM_2:
+			}
+			else
+			{
+				// ATRAC3+ (AUs left from the previous call are pushed first, the packet must be appended only once)
+				if (!push_atx(es, userdata) || !es.append(pkt.addr, pkt.size))
 				{
-					if (!stream.check(6))
-					{
-						fmt::throw_exception("End of stream (PRIVATE_STREAM_2)" HERE);
-					}
-					stream.skip(4);
-					stream.get(len);
-
-					cellDmux.notice("PRIVATE_STREAM_2 (%d)", len);
-
-					if (!stream.check(len))
-					{
-						fmt::throw_exception("End of stream (PRIVATE_STREAM_2, len=%d)" HERE, len);
-					}
-					stream.skip(len);
-					break;
+					return false;
 				}
 
-				case PRIVATE_STREAM_1:
+				if (pkt.has_ts)
 				{
-					// audio and user data stream
-					DemuxerStream backup = stream;
+					es.last_dts = pkt.dts;
+					es.last_pts = pkt.pts;
+				}
 
-					if (!stream.check(6))
-					{
-						fmt::throw_exception("End of stream (PRIVATE_STREAM_1)" HERE);
-					}
-					stream.skip(4);
-					stream.get(len);
+				es.packets.pop_front();
 
-					if (!stream.check(len))
-					{
-						fmt::throw_exception("End of stream (PRIVATE_STREAM_1, len=%d)" HERE, len);
-					}
+				if (!push_atx(es, userdata))
+				{
+					return false;
+				}
 
-					const PesHeader pes(stream);
-					if (!pes.is_ok)
-					{
-						fmt::throw_exception("PesHeader error (PRIVATE_STREAM_1, len=%d)" HERE, len);
-					}
+				continue;
+			}
 
-					if (len < pes.size + 4)
-					{
-						fmt::throw_exception("End of block (PRIVATE_STREAM_1, PesHeader + fid_minor, len=%d)" HERE, len);
-					}
-					len -= pes.size + 4;
-					
-					u8 fid_minor;
-					if (!stream.get(fid_minor))
-					{
-						fmt::throw_exception("End of stream (PRIVATE_STREAM1, fid_minor)" HERE);
-					}
+			es.packets.pop_front();
+		}
 
-					const u32 ch = fid_minor % 16;
-					if ((fid_minor & -0x10) == 0 && esATX[ch])
-					{
-						ElementaryStream& es = *esATX[ch];
-						if (es.raw_data.size() > 1024 * 1024)
-						{
-							stream = backup;
-							std::this_thread::sleep_for(1ms); // hack
-							continue;
-						}
+		return true;
+	}
 
-						if (len < 3 || !stream.check(3))
-						{
-							fmt::throw_exception("End of block (ATX, unknown header, len=%d)" HERE, len);
-						}
-						len -= 3;
-						stream.skip(3);
+	// Push complete ATRAC3+ AUs from the incomplete AU data (returns false if the ES buffer is full)
+	bool push_atx(ElementaryStream& es, u64 userdata)
+	{
+		while (es.pending >= 8) // skip if cannot read ATS header
+		{
+			const u8* const data = es.pending_data();
 
-						if (pes.has_ts)
-						{
-							es.last_dts = pes.dts;
-							es.last_pts = pes.pts;
-						}
+			if (data[0] != 0x0f || data[1] != 0xd0)
+			{
+				fmt::throw_exception("ATX: 0x0fd0 header not found (ats=0x%llx)" HERE, *(be_t<u64>*)data);
+			}
 
-						es.push(stream, len);
+			const u32 frame_size = ((((u32)data[2] & 0x3) << 8) | (u32)data[3]) * 8 + 8;
 
-						while (true)
-						{
-							auto const size = es.raw_data.size() - es.raw_pos; // size of available new data
-							auto const data = es.raw_data.data() + es.raw_pos; // pointer to available data
+			if (es.pending < frame_size + 8) break; // skip non-complete AU
 
-							if (size < 8) break; // skip if cannot read ATS header
+			if (!es.can_push_au(frame_size + 8))
+			{
+				return false;
+			}
 
-							if (data[0] != 0x0f || data[1] != 0xd0)
-							{
-								fmt::throw_exception("ATX: 0x0fd0 header not found (ats=0x%llx)" HERE, *(be_t<u64>*)data);
-							}
+			es.push_au(frame_size + 8, es.last_dts, es.last_pts, userdata, false /* TODO: set correct value */, 0);
+			es_callback(es, CELL_DMUX_ES_MSG_TYPE_AU_FOUND, userdata);
+		}
 
-							u32 frame_size = ((((u32)data[2] & 0x3) << 8) | (u32)data[3]) * 8 + 8;
+		return true;
+	}
 
-							if (size < frame_size + 8) break; // skip non-complete AU
+	virtual void cpu_task() override
+	{
+		DemuxerTask task;
+		DemuxerStream stream = {};
+		ElementaryStream* esALL[96]; memset(esALL, 0, sizeof(esALL));
+		ElementaryStream** esAVC = &esALL[0]; // AVC (max 16 minus M2V count)
+		ElementaryStream** esM2V = &esALL[16]; // M2V (max 16 minus AVC count)
+		ElementaryStream** esDATA = &esALL[32]; // user data (max 16)
+		ElementaryStream** esATX = &esALL[48]; // ATRAC3+ (max 16)
+		ElementaryStream** esAC3 = &esALL[64]; // AC3 (max 16)
+		ElementaryStream** esPCM = &esALL[80]; // LPCM (max 16)
 
-							if (es.isfull(frame_size + 8)) break; // skip if cannot push AU
-							
-							es.push_au(frame_size + 8, es.last_dts, es.last_pts, stream.userdata, false /* TODO: set correct value */, 0);
+		std::vector<DemuxerPacket> index;
 
-							//cellDmux.notice("ATX AU pushed (ats=0x%llx, frame_size=%d)", *(be_t<u64>*)data, frame_size);
+		while (true)
+		{
+			if (Emu.IsStopped() || is_closed)
+			{
+				break;
+			}
+			
+			if (!job.try_peek(task) && is_running && stream.addr)
+			{
+				// default task (delivering indexed packets) (if there is no other work)
+				bool done = true;
 
-							auto esMsg = vm::ptr<CellDmuxEsMsg>::make(memAddr + (cb_add ^= 16));
-							esMsg->msgType = CELL_DMUX_ES_MSG_TYPE_AU_FOUND;
-							esMsg->supplementalInfo = stream.userdata;
-							es.cbFunc(*this, id, es.id, esMsg, es.cbArg);
-							lv2_obj::sleep(*this);
-						}
-					}
-					else
+				// Each ES is fed independently, so a full ES doesn't stall the others
+				for (auto es : esALL)
+				{
+					if (es && !deliver(*es, stream.userdata))
 					{
-						cellDmux.notice("PRIVATE_STREAM_1 (len=%d, fid_minor=0x%x)", len, fid_minor);
-						stream.skip(len);
+						done = false;
 					}
-					break;
 				}
 
-				case 0x1e0: case 0x1e1: case 0x1e2: case 0x1e3:
-				case 0x1e4: case 0x1e5: case 0x1e6: case 0x1e7:
-				case 0x1e8: case 0x1e9: case 0x1ea: case 0x1eb:
-				case 0x1ec: case 0x1ed: case 0x1ee: case 0x1ef:
+				if (!done)
 				{
-					// video stream (AVC or M2V)
-					DemuxerStream backup = stream;
-
-					if (!stream.check(6))
-					{
-						fmt::throw_exception("End of stream (video, code=0x%x)" HERE, code);
-					}
-					stream.skip(4);
-					stream.get(len);
-
-					if (!stream.check(len))
-					{
-						fmt::throw_exception("End of stream (video, code=0x%x, len=%d)" HERE, code, len);
-					}
-
-					const PesHeader pes(stream);
-					if (!pes.is_ok)
-					{
-						fmt::throw_exception("PesHeader error (video, code=0x%x, len=%d)" HERE, code, len);
-					}
-
-					if (len < pes.size + 3)
-					{
-						fmt::throw_exception("End of block (video, code=0x%x, PesHeader)" HERE, code);
-					}
-					len -= pes.size + 3;
-
-					const u32 ch = code % 16;
-					if (esAVC[ch])
-					{
-						ElementaryStream& es = *esAVC[ch];
-
-						const u32 old_size = (u32)es.raw_data.size();
-						if (es.isfull(old_size))
-						{
-							stream = backup;
-							std::this_thread::sleep_for(1ms); // hack
-							continue;
-						}
+					std::this_thread::sleep_for(1ms); // hack (wait for AU release)
+					continue;
+				}
 
-						if ((pes.has_ts && old_size) || old_size >= 0x69800)
-						{
-							// push AU if it becomes too big or the next packet contains PTS/DTS
-							es.push_au(old_size, es.last_dts, es.last_pts, stream.userdata, false /* TODO: set correct value */, 0);
-
-							// callback
-							auto esMsg = vm::ptr<CellDmuxEsMsg>::make(memAddr + (cb_add ^= 16));
-							esMsg->msgType = CELL_DMUX_ES_MSG_TYPE_AU_FOUND;
-							esMsg->supplementalInfo = stream.userdata;
-							es.cbFunc(*this, id, es.id, esMsg, es.cbArg);
-							lv2_obj::sleep(*this);
-						}
-						
-						if (pes.has_ts)
-						{
-							// preserve dts/pts for next AU
-							es.last_dts = pes.dts;
-							es.last_pts = pes.pts;
-						}
+				// demuxing finished
+				is_running = false;
 
-						// reconstruction of MPEG2-PS stream for vdec module
-						const u32 size = len + pes.size + 9;
-						stream = backup;
-						es.push(stream, size);
-					}
-					else
-					{
-						cellDmux.notice("Video stream (code=0x%x, len=%d)", code, len);
-						stream.skip(len);
-					}
-					break;
-				}
+				// callback
+				dmux_callback(CELL_DMUX_MSG_TYPE_DEMUX_DONE, stream.userdata);
 
-				default:
-				{
-					if ((code & PACKET_START_CODE_MASK) == PACKET_START_CODE_PREFIX)
-					{
-						fmt::throw_exception("Unknown code found (0x%x)" HERE, code);
-					}
+				is_working = false;
 
-					// search
-					stream.skip(1);
-				}
-				}
+				stream = {};
 
 				continue;
 			}
@@ -526,6 +356,50 @@ public:
 				stream = task.stream;
 				//LOG_NOTICE(HLE, "*** stream updated(addr=0x%x, size=0x%x, discont=%d, userdata=0x%llx)",
 					//stream.addr, stream.size, stream.discontinuity, stream.userdata);
+
+				// Find all packets and queue them to their elementary streams
+				index.clear();
+				dmux_index_stream(vm::_ptr<u8>(stream.addr), stream.size, stream.addr, index);
+
+				for (DemuxerPacket& pkt : index)
+				{
+					if (pkt.code == PRIVATE_STREAM_1)
+					{
+						// audio and user data stream
+						const u32 ch = pkt.fid_minor % 16;
+
+						if ((pkt.fid_minor & -0x10) == 0 && esATX[ch])
+						{
+							if (pkt.size < 3)
+							{
+								fmt::throw_exception("End of block (ATX, unknown header, len=%d)" HERE, pkt.size);
+							}
+
+							pkt.addr += 3;
+							pkt.size -= 3;
+							esATX[ch]->packets.push_back(pkt);
+						}
+						else
+						{
+							cellDmux.notice("PRIVATE_STREAM_1 (len=%d, fid_minor=0x%x)", pkt.size, pkt.fid_minor);
+						}
+					}
+					else
+					{
+						// video stream (AVC or M2V)
+						const u32 ch = pkt.code % 16;
+
+						if (esAVC[ch])
+						{
+							esAVC[ch]->packets.push_back(pkt);
+						}
+						else
+						{
+							cellDmux.notice("Video stream (code=0x%x, len=%d)", pkt.code, pkt.size);
+						}
+					}
+				}
+
 				break;
 			}
 
@@ -535,12 +409,16 @@ public:
 				// demuxing stopped
 				if (is_running.exchange(false))
 				{
+					for (auto es : esALL)
+					{
+						if (es)
+						{
+							es->packets.clear();
+						}
+					}
+
 					// callback
-					auto dmuxMsg = vm::ptr<CellDmuxMsg>::make(memAddr + (cb_add ^= 16));
-					dmuxMsg->msgType = CELL_DMUX_MSG_TYPE_DEMUX_DONE;
-					dmuxMsg->supplementalInfo = stream.userdata;
-					cbFunc(*this, id, dmuxMsg, cbArg);
-					lv2_obj::sleep(*this);
+					dmux_callback(CELL_DMUX_MSG_TYPE_DEMUX_DONE, stream.userdata);
 
 					stream = {};
 
@@ -611,38 +489,22 @@ public:
 			{
 				ElementaryStream& es = *task.es.es_ptr;
 
-				const u32 old_size = (u32)es.raw_data.size();
-				if (old_size && (es.fidMajor & -0x10) == 0xe0)
+				deliver(es, stream.userdata);
+
+				if (es.pending && (es.fidMajor & -0x10) == 0xe0)
 				{
 					// TODO (it's only for AVC, some ATX data may be lost)
-					while (es.isfull(old_size))
-					{
-						if (Emu.IsStopped() || is_closed) break;
-
-						std::this_thread::sleep_for(1ms); // hack
-					}
-
-					es.push_au(old_size, es.last_dts, es.last_pts, stream.userdata, false, 0);
-
-					// callback
-					auto esMsg = vm::ptr<CellDmuxEsMsg>::make(memAddr + (cb_add ^= 16));
-					esMsg->msgType = CELL_DMUX_ES_MSG_TYPE_AU_FOUND;
-					esMsg->supplementalInfo = stream.userdata;
-					es.cbFunc(*this, id, es.id, esMsg, es.cbArg);
-					lv2_obj::sleep(*this);
+					es.push_au(es.pending, es.last_dts, es.last_pts, stream.userdata, false, 0);
+					es_callback(es, CELL_DMUX_ES_MSG_TYPE_AU_FOUND, stream.userdata);
 				}
 				
-				if (es.raw_data.size())
+				if (es.pending || !es.packets.empty())
 				{
-					cellDmux.error("dmuxFlushEs: 0x%x bytes lost (es_id=%d)", (u32)es.raw_data.size(), es.id);
+					cellDmux.error("dmuxFlushEs: 0x%x bytes and %d packets lost (es_id=%d)", es.pending, (u32)es.packets.size(), es.id);
 				}
 
 				// callback
-				auto esMsg = vm::ptr<CellDmuxEsMsg>::make(memAddr + (cb_add ^= 16));
-				esMsg->msgType = CELL_DMUX_ES_MSG_TYPE_FLUSH_DONE;
-				esMsg->supplementalInfo = stream.userdata;
-				es.cbFunc(*this, id, es.id, esMsg, es.cbArg);
-				lv2_obj::sleep(*this);
+				es_callback(es, CELL_DMUX_ES_MSG_TYPE_FLUSH_DONE, stream.userdata);
 				break;
 			}
 
@@ -669,35 +531,40 @@ public:
 };
 
 
-PesHeader::PesHeader(DemuxerStream& stream)
+static u64 dmux_get_ts(u8 c, const u8* v)
+{
+	return
+		(((u64)c & 0x0e) << 29) |
+		(((u64)v[0]) << 21) |
+		(((u64)v[1] & 0x7e) << 15) |
+		(((u64)v[2]) << 7) | ((u64)v[3] >> 1);
+}
+
+PesHeader::PesHeader(const u8* data, u32 avail)
 	: pts(CODEC_TS_INVALID)
 	, dts(CODEC_TS_INVALID)
 	, size(0)
 	, has_ts(false)
 	, is_ok(false)
 {
-	u16 header;
-	if (!stream.get(header))
+	if (avail < 3)
 	{
 		fmt::throw_exception("End of stream (header)" HERE);
 	}
-	if (!stream.get(size))
-	{
-		fmt::throw_exception("End of stream (size)" HERE);
-	}
-	if (!stream.check(size))
+
+	size = data[2];
+
+	if (avail - 3 < size)
 	{
 		fmt::throw_exception("End of stream (size=%d)" HERE, size);
 	}
-	
-	u8 pos = 0;
-	while (pos++ < size)
+
+	const u8* const ext = data + 3;
+
+	u32 pos = 0;
+	while (pos < size)
 	{
-		u8 v;
-		if (!stream.get(v))
-		{
-			return; // should never occur
-		}
+		const u8 v = ext[pos++];
 
 		if (v == 0xff) // skip padding bytes
 		{
@@ -706,31 +573,30 @@ PesHeader::PesHeader(DemuxerStream& stream)
 
 		if ((v & 0xf0) == 0x20 && (size - pos) >= 4) // pts only
 		{
+			pts = dmux_get_ts(v, ext + pos);
 			pos += 4;
-			pts = stream.get_ts(v);
 			has_ts = true;
 		}
 		else if ((v & 0xf0) == 0x30 && (size - pos) >= 9) // pts and dts
 		{
-			pos += 5;
-			pts = stream.get_ts(v);
-			stream.get(v);
+			pts = dmux_get_ts(v, ext + pos);
+			pos += 4;
 			has_ts = true;
 
-			if ((v & 0xf0) != 0x10)
+			const u8 d = ext[pos++];
+
+			if ((d & 0xf0) != 0x10)
 			{
-				cellDmux.error("PesHeader(): dts not found (v=0x%x, size=%d, pos=%d)", v, size, pos - 1);
-				stream.skip(size - pos);
+				cellDmux.error("PesHeader(): dts not found (v=0x%x, size=%d, pos=%d)", d, size, pos - 1);
 				return;
 			}
+
+			dts = dmux_get_ts(d, ext + pos);
 			pos += 4;
-			dts = stream.get_ts(v);
 		}
 		else
 		{
 			cellDmux.warning("PesHeader(): unknown code (v=0x%x, size=%d, pos=%d)", v, size, pos - 1);
-			stream.skip(size - pos);
-			pos = size;
 			break;
 		}
 	}
@@ -738,6 +604,129 @@ PesHeader::PesHeader(DemuxerStream& stream)
 	is_ok = true;
 }
 
+void dmux_index_stream(const u8* data, u32 size, u32 addr, std::vector<DemuxerPacket>& out)
+{
+	u32 pos = 0;
+
+	while (size - pos >= 4)
+	{
+		const u32 code = data[pos] << 24 | data[pos + 1] << 16 | data[pos + 2] << 8 | data[pos + 3];
+
+		if ((code & PACKET_START_CODE_MASK) != PACKET_START_CODE_PREFIX)
+		{
+			// search
+			pos++;
+
+			while (size - pos >= 4 && (data[pos] || data[pos + 1] || data[pos + 2] != 1))
+			{
+				pos++;
+			}
+
+			continue;
+		}
+
+		switch (code)
+		{
+		case PACK_START_CODE:
+		{
+			if (size - pos < 14)
+			{
+				fmt::throw_exception("End of stream (PACK_START_CODE)" HERE);
+			}
+			pos += 14;
+			break;
+		}
+
+		case SYSTEM_HEADER_START_CODE:
+		{
+			if (size - pos < 18)
+			{
+				fmt::throw_exception("End of stream (SYSTEM_HEADER_START_CODE)" HERE);
+			}
+			pos += 18;
+			break;
+		}
+
+		case PADDING_STREAM:
+		case PRIVATE_STREAM_2:
+		case PRIVATE_STREAM_1:
+		case 0x1e0: case 0x1e1: case 0x1e2: case 0x1e3:
+		case 0x1e4: case 0x1e5: case 0x1e6: case 0x1e7:
+		case 0x1e8: case 0x1e9: case 0x1ea: case 0x1eb:
+		case 0x1ec: case 0x1ed: case 0x1ee: case 0x1ef:
+		{
+			if (size - pos < 6)
+			{
+				fmt::throw_exception("End of stream (code=0x%x)" HERE, code);
+			}
+
+			const u32 len = data[pos + 4] << 8 | data[pos + 5];
+
+			if (size - pos - 6 < len)
+			{
+				fmt::throw_exception("End of stream (code=0x%x, len=%d)" HERE, code, len);
+			}
+
+			if (code == PRIVATE_STREAM_2)
+			{
+				cellDmux.notice("PRIVATE_STREAM_2 (%d)", len);
+			}
+
+			if (code == PRIVATE_STREAM_1 || code >= 0x1e0)
+			{
+				const PesHeader pes(data + pos + 6, len);
+
+				if (!pes.is_ok)
+				{
+					fmt::throw_exception("PesHeader error (code=0x%x, len=%d)" HERE, code, len);
+				}
+
+				DemuxerPacket pkt;
+				pkt.code = code;
+				pkt.has_ts = pes.has_ts;
+				pkt.pts = pes.pts;
+				pkt.dts = pes.dts;
+				pkt.fid_minor = 0;
+
+				if (code == PRIVATE_STREAM_1)
+				{
+					// PES header and fid_minor are followed by the payload
+					if (len < pes.size + 4u)
+					{
+						fmt::throw_exception("End of block (PRIVATE_STREAM_1, PesHeader + fid_minor, len=%d)" HERE, len);
+					}
+
+					pkt.fid_minor = data[pos + 9 + pes.size];
+					pkt.addr = addr + pos + 10 + pes.size;
+					pkt.size = len - pes.size - 4;
+				}
+				else
+				{
+					// Video payload is the whole packet
+					if (len < pes.size + 3u)
+					{
+						fmt::throw_exception("End of block (video, code=0x%x, PesHeader)" HERE, code);
+					}
+
+					pkt.addr = addr + pos;
+					pkt.size = len + 6;
+				}
+
+				out.push_back(pkt);
+			}
+
+			pos += len + 6;
+			break;
+		}
+
+		default:
+		{
+			fmt::throw_exception("Unknown code found (0x%x)" HERE, code);
+		}
+		}
+	}
+}
+
 ElementaryStream::ElementaryStream(Demuxer* dmux, u32 addr, u32 size, u32 fidMajor, u32 fidMinor, u32 sup1, u32 sup2, vm::ptr<CellDmuxCbEsMsg> cbFunc, u32 cbArg, u32 spec)
 	: dmux(dmux)
 	, memAddr(align(addr, 128))
@@ -753,13 +742,13 @@ ElementaryStream::ElementaryStream(Demuxer* dmux, u32 addr, u32 size, u32 fidMaj
 	, put_count(0)
 	, got_count(0)
 	, released(0)
-	, raw_pos(0)
+	, pending(0)
 	, last_dts(CODEC_TS_INVALID)
 	, last_pts(CODEC_TS_INVALID)
 {
 }
 
-bool ElementaryStream::is_full(u32 space)
+bool ElementaryStream::is_full(u32 pos, u32 space)
 {
 	if (released < put_count)
 	{
@@ -773,11 +762,11 @@ bool ElementaryStream::is_full(u32 space)
 		{
 			fmt::throw_exception("entries.peek() failed" HERE);
 		}
-		else if (first >= put)
+		else if (first >= pos)
 		{
-			return first - put < space + 128;
+			return first - pos < space + 128;
 		}
-		else if (put + space + 128 > memAddr + memSize)
+		else if (pos + space + 128 > memAddr + memSize)
 		{
 			return first - memAddr < space + 128;
 		}
@@ -792,10 +781,65 @@ bool ElementaryStream::is_full(u32 space)
 	}
 }
 
-bool ElementaryStream::isfull(u32 space)
+bool ElementaryStream::append(u32 addr, u32 size)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
-	return is_full(space);
+
+	const u32 space = pending + size + au_reserve;
+
+	if (space + 128 > memSize)
+	{
+		fmt::throw_exception("AU is too big (0x%x, memSize=0x%x)" HERE, pending + size, memSize);
+	}
+
+	if (is_full(put, space))
+	{
+		return false;
+	}
+
+	if (put + space + 128 > memAddr + memSize)
+	{
+		// Move incomplete AU data to the beginning of the buffer
+		std::memmove(vm::base(memAddr + 128), vm::base(put + 128), pending);
+		put = memAddr;
+	}
+
+	std::memcpy(vm::base(put + 128 + pending), vm::base(addr), size);
+	pending += size;
+	return true;
+}
+
+const u8* ElementaryStream::pending_data()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return vm::_ptr<u8>(put + 128);
+}
+
+bool ElementaryStream::is_full_after_au(u32 size)
+{
+	if (size == pending)
+	{
+		// Nothing to move (append checks the space for the following data)
+		return false;
+	}
+
+	// Position of the next AU and the space required for the remaining data
+	const u32 next = align(put + 128 + size, 128);
+	const u32 space = pending - size + au_reserve;
+
+	if (next + space + 128 > memAddr + memSize && memAddr + space + 128 > put)
+	{
+		// The remaining data would be moved to the beginning of the buffer and overwrite the AU
+		return true;
+	}
+
+	return is_full(next, space);
+}
+
+bool ElementaryStream::can_push_au(u32 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return size <= pending && !is_full_after_au(size);
 }
 
 void ElementaryStream::push_au(u32 size, u64 dts, u64 pts, u64 userdata, bool rap, u32 specific)
@@ -803,16 +847,9 @@ void ElementaryStream::push_au(u32 size, u64 dts, u64 pts, u64 userdata, bool ra
 	u32 addr;
 	{
 		std::lock_guard<std::mutex> lock(m_mutex);
-		verify(HERE), !is_full(size);
-
-		if (put + size + 128 > memAddr + memSize)
-		{
-			put = memAddr;
-		}
-
-		std::memcpy(vm::base(put + 128), raw_data.data(), size);
-		raw_data.erase(raw_data.begin(), raw_data.begin() + size);
+		verify(HERE), size <= pending, !is_full_after_au(size);
 
+		// AU data is already in place
 		auto info = vm::ptr<CellDmuxAuInfoEx>::make(put);
 		info->auAddr = put + 128;
 		info->auSize = size;
@@ -841,21 +878,20 @@ void ElementaryStream::push_au(u32 size, u64 dts, u64 pts, u64 userdata, bool ra
 
 		put = align(put + 128 + size, 128);
 
-		put_count++;
-	}
+		// Move remaining data after the header of the next AU (checked by is_full_after_au)
+		pending -= size;
 
-	verify(HERE), entries.push(addr, &dmux->is_closed);
-}
-
-void ElementaryStream::push(DemuxerStream& stream, u32 size)
-{
-	auto const old_size = raw_data.size();
+		if (put + pending + au_reserve + 128 > memAddr + memSize)
+		{
+			put = memAddr;
+		}
 
-	raw_data.resize(old_size + size);
+		std::memmove(vm::base(put + 128), vm::base(addr + 128 + size), pending);
 
-	std::memcpy(raw_data.data() + old_size, vm::base(stream.addr), size); // append bytes
+		put_count++;
+	}
 
-	stream.skip(size);
+	verify(HERE), entries.push(addr, &dmux->is_closed);
 }
 
 bool ElementaryStream::release()
@@ -926,8 +962,8 @@ void ElementaryStream::reset()
 	put_count = 0;
 	got_count = 0;
 	released = 0;
-	raw_data.clear();
-	raw_pos = 0;
+	pending = 0;
+	packets.clear();
 }
 
 void dmuxQueryAttr(u32 info_addr /* may be 0 */, vm::ptr<CellDmuxAttr> attr)
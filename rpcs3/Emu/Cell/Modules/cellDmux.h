@@ -275,3 +275,32 @@ struct CellDmuxAuInfoEx
 	CellCodecTimeStamp pts;
 	CellCodecTimeStamp dts;
 };
+
+enum
+{
+	/* http://dvd.sourceforge.net/dvdinfo/mpeghdrs.html */
+
+	PACKET_START_CODE_MASK   = 0xffffff00,
+	PACKET_START_CODE_PREFIX = 0x00000100,
+
+	PACK_START_CODE          = 0x000001ba,
+	SYSTEM_HEADER_START_CODE = 0x000001bb,
+	PRIVATE_STREAM_1         = 0x000001bd,
+	PADDING_STREAM           = 0x000001be,
+	PRIVATE_STREAM_2         = 0x000001bf,
+};
+
+// Elementary stream packet payload found by the stream indexer
+struct DemuxerPacket
+{
+	u32 code;
+	u32 addr; // Payload address
+	u32 size; // Payload size
+	u8 fid_minor; // PRIVATE_STREAM_1 only
+	bool has_ts;
+	u64 pts;
+	u64 dts;
+};
+
+// Index PAMF (MPEG-PS) stream packets in one pass (only elementary stream packets are returned)
+void dmux_index_stream(const u8* data, u32 size, u32 addr, std::vector<DemuxerPacket>& out);
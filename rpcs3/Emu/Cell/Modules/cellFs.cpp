@@ -8,13 +8,164 @@
 #include "cellFs.h"
 
 #include "Utilities/StrUtil.h"
+#include "Utilities/GSL.h"
 
 #include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <deque>
 
 namespace vm { using namespace ps3; }
 
+extern u64 get_system_time();
+
 logs::channel cellFs("cellFs");
 
+// Thread executing cellFsStReadWaitCallback callbacks
+struct fs_st_thread : ppu_thread
+{
+	using ppu_thread::ppu_thread;
+
+	virtual void cpu_task() override
+	{
+		while (cmd64 cmd = cmd_wait())
+		{
+			const u32 fd = cmd.arg1<u32>();
+			const auto func = cmd.arg2<vm::ptr<void(s32 xfd, u64 xsize)>>();
+			const u64 size = cmd_get(1).as<u64>();
+			cmd_pop(1);
+
+			func(*this, fd, size);
+			lv2_obj::sleep(*this);
+		}
+	}
+};
+
+struct fs_st_manager
+{
+	std::mutex mutex;
+	std::unordered_map<u32, std::shared_ptr<fs_st_stream>> streams;
+	std::shared_ptr<fs_st_thread> thread;
+
+	std::shared_ptr<fs_st_stream> get(u32 fd)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const auto found = streams.find(fd);
+
+		if (found == streams.end())
+		{
+			return nullptr;
+		}
+
+		return found->second;
+	}
+};
+
+void fs_st_stream::check_callback()
+{
+	// Called with the mutex locked
+	if (cb_func && ready(cb_size))
+	{
+		const u64 size = std::min(cb_size, available());
+		const auto func = cb_func;
+		cb_func = vm::null;
+
+		cb_thread->cmd_list
+		({
+			{ fd, func },
+			{ size },
+		});
+
+		cb_thread->notify();
+	}
+}
+
+bool fs_st_stream::wait(u64 size)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (!ready(size))
+	{
+		const auto _this = thread_ctrl::get_current();
+
+		waiters.emplace_back(_this);
+
+		auto unregister = gsl::finally([&]()
+		{
+			if (!lock)
+			{
+				lock.lock();
+			}
+
+			waiters.erase(std::find(waiters.begin(), waiters.end(), _this));
+		});
+
+		while (!ready(size))
+		{
+			lock.unlock();
+			thread_ctrl::wait();
+			lock.lock();
+		}
+	}
+
+	return !quit;
+}
+
+void fs_st_stream::task()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (!quit && !Emu.IsStopped())
+	{
+		// Wait for free space in the ring buffer (all state changes are notified)
+		if (!progress || eof || ringbuf_size - available() < block_size)
+		{
+			cv.wait(lock);
+			continue;
+		}
+
+		// The first ring buffer worth of data is read immediately, further reads keep to the transfer rate
+		if (transfer_rate && write_pos > ringbuf_size)
+		{
+			const u64 target = start_time + (write_pos - ringbuf_size) * 1000000 / transfer_rate;
+			const u64 now = get_system_time();
+
+			if (now < target)
+			{
+				cv.wait_for(lock, std::chrono::microseconds(target - now));
+				continue;
+			}
+		}
+
+		const u32 gen = generation;
+		const u64 pos = offset;
+		const u64 size = std::min(block_size, end - pos);
+		const vm::ptr<void> dst = vm::cast(addr + write_pos % ringbuf_size, HERE);
+
+		lock.unlock();
+		const u64 result = file->op_read_at(pos, dst, size);
+		lock.lock();
+
+		if (gen != generation)
+		{
+			// Stream was stopped or restarted, discard the data
+			continue;
+		}
+
+		write_pos += result;
+		offset += result;
+
+		if (result < size || offset >= end)
+		{
+			eof = true;
+		}
+
+		check_callback();
+		wake();
+	}
+}
+
 error_code cellFsGetPath(u32 fd, vm::ptr<char> out_path)
 {
 	cellFs.trace("cellFsGetPath(fd=%d, out_path=*0x%x)", fd, out_path);
@@ -76,6 +227,25 @@ error_code cellFsClose(u32 fd)
 {
 	cellFs.trace("cellFsClose(fd=0x%x)", fd);
 
+	// Release streaming read resources
+	if (const auto m = fxm::get<fs_st_manager>())
+	{
+		std::shared_ptr<fs_st_stream> st;
+		{
+			std::lock_guard<std::mutex> lock(m->mutex);
+
+			const auto found = m->streams.find(fd);
+
+			if (found != m->streams.end())
+			{
+				// Waiters hold their own references
+				found->second->stop();
+				st = std::move(found->second);
+				m->streams.erase(found);
+			}
+		}
+	}
+
 	return sys_fs_close(fd);
 }
 
@@ -647,7 +817,7 @@ error_code cellFsSetDiscReadRetrySetting()
 
 s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 {
-	cellFs.todo("cellFsStReadInit(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
+	cellFs.warning("cellFsStReadInit(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
 
 	if (ringbuf->copy & ~CELL_FS_ST_COPYLESS)
 	{
@@ -659,7 +829,7 @@ s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 		return CELL_EINVAL;
 	}
 
-	if (ringbuf->ringbuf_size % ringbuf->block_size) // check if a multiple of block_size
+	if (!ringbuf->block_size || !ringbuf->ringbuf_size || ringbuf->ringbuf_size % ringbuf->block_size) // check if a multiple of block_size
 	{
 		return CELL_EINVAL;
 	}
@@ -676,14 +846,40 @@ s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 		return CELL_EPERM;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+
+	std::lock_guard<std::mutex> lock(m->mutex);
+
+	if (m->streams.count(fd))
+	{
+		return CELL_EBUSY;
+	}
+
+	const u32 addr = vm::alloc(::narrow<u32>(ringbuf->ringbuf_size, "cellFsStReadInit" HERE), vm::main);
+
+	if (!addr)
+	{
+		return CELL_ENOMEM;
+	}
+
+	if (!m->thread)
+	{
+		m->thread = idm::make_ptr<ppu_thread, fs_st_thread>("FS ST Thread", 500);
+		m->thread->run();
+	}
+
+	const auto st = std::make_shared<fs_st_stream>(fd, file, m->thread, *ringbuf, addr);
+
+	thread_ctrl::spawn(st->thread, "FS ST Reader", [st = st.get()] { st->task(); });
+
+	m->streams.emplace(fd, st);
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadFinish(u32 fd)
 {
-	cellFs.todo("cellFsStReadFinish(fd=%d)", fd);
+	cellFs.warning("cellFsStReadFinish(fd=%d)", fd);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -692,14 +888,34 @@ s32 cellFsStReadFinish(u32 fd)
 		return CELL_EBADF; // ???
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+
+	std::shared_ptr<fs_st_stream> st;
+	{
+		std::lock_guard<std::mutex> lock(m->mutex);
+
+		const auto found = m->streams.find(fd);
+
+		if (found == m->streams.end())
+		{
+			return CELL_ENXIO;
+		}
+
+		// Waiters hold their own references
+		found->second->stop();
+		st = std::move(found->second);
+		m->streams.erase(found);
+	}
+
+	// Free the ring buffer (or let the last waiter do it)
+	st.reset();
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetRingBuf(u32 fd, vm::ptr<CellFsRingBuffer> ringbuf)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
+	cellFs.trace("cellFsStReadGetRingBuf(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -708,14 +924,25 @@ s32 cellFsStReadGetRingBuf(u32 fd, vm::ptr<CellFsRingBuffer> ringbuf)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	ringbuf->ringbuf_size = st->ringbuf_size;
+	ringbuf->block_size = st->block_size;
+	ringbuf->transfer_rate = st->transfer_rate;
+	ringbuf->copy = st->copy;
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetStatus(u32 fd, vm::ptr<u64> status)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, status=*0x%x)", fd, status);
+	cellFs.trace("cellFsStReadGetStatus(fd=%d, status=*0x%x)", fd, status);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -724,14 +951,25 @@ s32 cellFsStReadGetStatus(u32 fd, vm::ptr<u64> status)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		*status = CELL_FS_ST_NOT_INITIALIZED;
+		return CELL_OK;
+	}
+
+	std::lock_guard<std::mutex> lock(st->mutex);
+
+	*status = CELL_FS_ST_INITIALIZED | (st->progress ? CELL_FS_ST_PROGRESS : CELL_FS_ST_STOP);
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetRegid(u32 fd, vm::ptr<u64> regid)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, regid=*0x%x)", fd, regid);
+	cellFs.todo("cellFsStReadGetRegid(fd=%d, regid=*0x%x)", fd, regid);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -740,14 +978,22 @@ s32 cellFsStReadGetRegid(u32 fd, vm::ptr<u64> regid)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+
+	if (!m->get(fd))
+	{
+		return CELL_ENXIO;
+	}
+
+	// No bandwidth reservation is made
+	*regid = 0;
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadStart(u32 fd, u64 offset, u64 size)
 {
-	cellFs.todo("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
+	cellFs.warning("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -756,14 +1002,38 @@ s32 cellFsStReadStart(u32 fd, u64 offset, u64 size)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	const u64 file_size = file->file.size();
+
+	{
+		std::lock_guard<std::mutex> lock(st->mutex);
+
+		st->generation++;
+		st->read_pos = 0;
+		st->write_pos = 0;
+		st->offset = offset;
+		st->end = size ? std::min(offset + size, file_size) : file_size; // Zero size means "until the end of file"
+		st->start_time = get_system_time();
+		st->progress = true;
+		st->eof = offset >= st->end;
+		st->cb_func = vm::null;
+	}
+
+	st->cv.notify_all();
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadStop(u32 fd)
 {
-	cellFs.todo("cellFsStReadStop(fd=%d)", fd);
+	cellFs.warning("cellFsStReadStop(fd=%d)", fd);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -772,14 +1042,29 @@ s32 cellFsStReadStop(u32 fd)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(st->mutex);
+
+		st->generation++;
+		st->progress = false;
+		st->cb_func = vm::null;
+		st->wake();
+	}
 
 	return CELL_OK;
 }
 
 s32 cellFsStRead(u32 fd, vm::ptr<u8> buf, u64 size, vm::ptr<u64> rsize)
 {
-	cellFs.todo("cellFsStRead(fd=%d, buf=*0x%x, size=0x%llx, rsize=*0x%x)", fd, buf, size, rsize);
+	cellFs.trace("cellFsStRead(fd=%d, buf=*0x%x, size=0x%llx, rsize=*0x%x)", fd, buf, size, rsize);
 	
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -788,14 +1073,35 @@ s32 cellFsStRead(u32 fd, vm::ptr<u8> buf, u64 size, vm::ptr<u64> rsize)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard<std::mutex> lock(st->mutex);
+
+	// Copy available data (two parts if wrapped around the end of the ring buffer)
+	const u64 result = std::min(size, st->available());
+	const u64 pos = st->read_pos % st->ringbuf_size;
+	const u64 part = std::min(result, st->ringbuf_size - pos);
+
+	std::memcpy(buf.get_ptr(), vm::base(st->addr + pos), part);
+	std::memcpy(buf.get_ptr() + part, vm::base(st->addr), result - part);
+
+	st->read_pos += result;
+	st->cv.notify_all();
+
+	*rsize = result;
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetCurrentAddr(u32 fd, vm::ptr<u32> addr, vm::ptr<u64> size)
 {
-	cellFs.todo("cellFsStReadGetCurrentAddr(fd=%d, addr=*0x%x, size=*0x%x)", fd, addr, size);
+	cellFs.trace("cellFsStReadGetCurrentAddr(fd=%d, addr=*0x%x, size=*0x%x)", fd, addr, size);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -804,14 +1110,28 @@ s32 cellFsStReadGetCurrentAddr(u32 fd, vm::ptr<u32> addr, vm::ptr<u64> size)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard<std::mutex> lock(st->mutex);
+
+	// Return contiguous part of available data (zero-copy)
+	const u64 pos = st->read_pos % st->ringbuf_size;
+
+	*addr = st->addr + ::narrow<u32>(pos, HERE);
+	*size = std::min(st->available(), st->ringbuf_size - pos);
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadPutCurrentAddr(u32 fd, vm::ptr<u8> addr, u64 size)
 {
-	cellFs.todo("cellFsStReadPutCurrentAddr(fd=%d, addr=*0x%x, size=0x%llx)", fd, addr, size);
+	cellFs.trace("cellFsStReadPutCurrentAddr(fd=%d, addr=*0x%x, size=0x%llx)", fd, addr, size);
 	
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -820,14 +1140,33 @@ s32 cellFsStReadPutCurrentAddr(u32 fd, vm::ptr<u8> addr, u64 size)
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	std::lock_guard<std::mutex> lock(st->mutex);
+
+	const u64 pos = st->read_pos % st->ringbuf_size;
+
+	if (addr.addr() != st->addr + pos || size > std::min(st->available(), st->ringbuf_size - pos))
+	{
+		return CELL_EINVAL;
+	}
+
+	// Release the data
+	st->read_pos += size;
+	st->cv.notify_all();
 
 	return CELL_OK;
 }
 
-s32 cellFsStReadWait(u32 fd, u64 size)
+s32 cellFsStReadWait(ppu_thread& ppu, u32 fd, u64 size)
 {
-	cellFs.todo("cellFsStReadWait(fd=%d, size=0x%llx)", fd, size);
+	cellFs.trace("cellFsStReadWait(fd=%d, size=0x%llx)", fd, size);
 	
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -836,14 +1175,31 @@ s32 cellFsStReadWait(u32 fd, u64 size)
 		return CELL_EBADF;
 	}
 
-	// TODO
-	
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (size > st->ringbuf_size)
+	{
+		return CELL_EINVAL;
+	}
+
+	// Woken up by the stream thread or by cellFsStReadFinish/cellFsClose (emulator stop throws from the wait)
+	if (!st->wait(size))
+	{
+		return CELL_ENXIO;
+	}
+
 	return CELL_OK;
 }
 
 s32 cellFsStReadWaitCallback(u32 fd, u64 size, vm::ptr<void(s32 xfd, u64 xsize)> func)
 {
-	cellFs.todo("cellFsStReadWaitCallback(fd=%d, size=0x%llx, func=*0x%x)", fd, size, func);
+	cellFs.trace("cellFsStReadWaitCallback(fd=%d, size=0x%llx, func=*0x%x)", fd, size, func);
 
 	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 
@@ -852,58 +1208,282 @@ s32 cellFsStReadWaitCallback(u32 fd, u64 size, vm::ptr<void(s32 xfd, u64 xsize)>
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
+
+	if (!st)
+	{
+		return CELL_ENXIO;
+	}
+
+	if (size > st->ringbuf_size || !func)
+	{
+		return CELL_EINVAL;
+	}
+
+	std::lock_guard<std::mutex> lock(st->mutex);
+
+	if (st->cb_func)
+	{
+		return CELL_EBUSY;
+	}
+
+	st->cb_size = size;
+	st->cb_func = func;
+	st->check_callback();
 	
 	return CELL_OK;
 }
 
 using fs_aio_cb_t = vm::ptr<void(vm::ptr<CellFsAio> xaio, s32 error, s32 xid, u64 size)>;
 
-// temporarily
-struct lv2_fs_mount_point
+struct fs_aio_request
 {
-	std::mutex mutex;
+	s32 xid;
+	u32 type; // 1 = read, 2 = write
+	vm::ptr<CellFsAio> aio;
+	fs_aio_cb_t func;
+
+	// Request parameters (copied on submission)
+	std::shared_ptr<lv2_file> file;
+	u64 offset;
+	vm::ptr<void> buf;
+	u64 size;
+
+	// Completion status
+	s32 error;
+	u64 result;
 };
 
 struct fs_aio_thread : ppu_thread
 {
 	using ppu_thread::ppu_thread;
 
+	std::mutex mutex;
+
+	// Completed requests waiting for their callbacks
+	std::vector<fs_aio_request> done;
+
+	// Queue completed requests (called by AIO workers)
+	void complete(std::vector<fs_aio_request>& reqs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Only the first completion of the batch needs to wake up the thread
+		const bool wake = done.empty();
+
+		for (auto& req : reqs)
+		{
+			done.emplace_back(std::move(req));
+		}
+
+		if (wake)
+		{
+			cmd_push({1, 0});
+			notify();
+		}
+	}
+
 	virtual void cpu_task() override
 	{
-		while (cmd64 cmd = cmd_wait())
+		std::vector<fs_aio_request> batch;
+
+		while (cmd_wait())
 		{
-			const u32 type = cmd.arg1<u32>();
-			const s32 xid = cmd.arg2<s32>();
-			const cmd64 cmd2 = cmd_get(1);
-			const auto aio = cmd2.arg1<vm::ptr<CellFsAio>>();
-			const auto func = cmd2.arg2<fs_aio_cb_t>();
-			cmd_pop(1);
+			cmd_pop();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				batch.swap(done);
+			}
+
+			// Deliver all callbacks which are ready
+			for (auto& req : batch)
+			{
+				req.func(*this, req.aio, req.error, req.xid, req.result);
+			}
+
+			batch.clear();
+			lv2_obj::sleep(*this);
+		}
+	}
+};
+
+// AIO worker pool for a single mount point
+struct fs_aio_mount
+{
+	// Maximal amount of data read at once by coalescing adjacent requests
+	static constexpr u64 coalesce_max = 0x100000;
+
+	const std::string name;
+	const std::shared_ptr<fs_aio_thread> cb_thread;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<fs_aio_request> queue;
+	bool quit = false;
+
+	std::vector<std::shared_ptr<thread_ctrl>> workers;
+
+	fs_aio_mount(const std::string& name, const std::shared_ptr<fs_aio_thread>& cb_thread)
+		: name(name)
+		, cb_thread(cb_thread)
+	{
+	}
+
+	~fs_aio_mount()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+
+		cv.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker->join();
+		}
+
+		// Cancel the requests left in the queue, every submitted request must get its callback
+		std::vector<fs_aio_request> reqs;
+
+		for (auto& req : queue)
+		{
+			req.error = CELL_ECANCELED;
+			req.result = 0;
+			reqs.emplace_back(std::move(req));
+		}
+
+		queue.clear();
+
+		if (!reqs.empty())
+		{
+			cellFs.warning("AIO mount point %s finished with %u pending request(s)", name, reqs.size());
+			cb_thread->complete(reqs);
+		}
+	}
+
+	void start(u32 count)
+	{
+		workers.resize(count);
+
+		for (u32 i = 0; i < count; i++)
+		{
+			thread_ctrl::spawn(workers[i], fmt::format("FS AIO Worker %s #%u", name, i), [this] { task(); });
+		}
+	}
+
+	void push(fs_aio_request&& req)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.emplace_back(std::move(req));
+		}
+
+		cv.notify_one();
+	}
+
+	// Remove queued request (returns false if it's already in progress or completed)
+	bool cancel(s32 xid)
+	{
+		std::vector<fs_aio_request> reqs;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			const auto found = std::find_if(queue.begin(), queue.end(), [&](const fs_aio_request& req) { return req.xid == xid; });
+
+			if (found == queue.end())
+			{
+				return false;
+			}
 
-			s32 error = CELL_OK;
-			u64 result = 0;
+			reqs.emplace_back(std::move(*found));
+			queue.erase(found);
+		}
+
+		reqs[0].error = CELL_ECANCELED;
+		reqs[0].result = 0;
+		cb_thread->complete(reqs);
+		return true;
+	}
+
+	void task()
+	{
+		std::vector<fs_aio_request> batch;
+		std::vector<u8> buffer;
+
+		std::unique_lock<std::mutex> lock(mutex);
 
-			const auto file = idm::get<lv2_fs_object, lv2_file>(aio->fd);
+		while (!quit && !Emu.IsStopped())
+		{
+			if (queue.empty())
+			{
+				cv.wait(lock);
+				continue;
+			}
 
-			if (!file || (type == 1 && file->flags & CELL_FS_O_WRONLY) || (type == 2 && !(file->flags & CELL_FS_O_ACCMODE)))
+			batch.emplace_back(std::move(queue.front()));
+			queue.pop_front();
+
+			const auto file = batch.front().file;
+			const u64 start = batch.front().offset;
+			const bool is_read = batch.front().type == 1 && !batch.front().error;
+
+			// Coalesce queued reads which continue the first one (not needed for memory-mapped files)
+			if (is_read && !file->file.get_mapped_data())
 			{
-				error = CELL_EBADF;
+				u64 end = start + batch.front().size;
+
+				for (auto it = queue.begin(); it != queue.end() && end - start < coalesce_max;)
+				{
+					if (it->type == 1 && !it->error && it->file == file && it->offset == end)
+					{
+						end += it->size;
+						batch.emplace_back(std::move(*it));
+						queue.erase(it);
+
+						// Rescan for the next adjacent request
+						it = queue.begin();
+						continue;
+					}
+
+					++it;
+				}
 			}
-			else
+
+			lock.unlock();
+
+			if (batch.size() > 1)
 			{
-				std::lock_guard<std::mutex> lock(file->mp->mutex);
+				// Single host read, then scatter the data to the individual buffers
+				const u64 total = batch.back().offset + batch.back().size - start;
+
+				buffer.resize(total);
+
+				const u64 nread = file->read_at(start, buffer.data(), total);
 
-				const auto old_pos = file->file.pos(); file->file.seek(aio->offset);
+				for (auto& req : batch)
+				{
+					const u64 pos = req.offset - start;
 
-				result = type == 2
-					? file->op_write(aio->buf, aio->size)
-					: file->op_read(aio->buf, aio->size);
+					req.result = pos < nread ? std::min(req.size, nread - pos) : 0;
+					std::memcpy(req.buf.get_ptr(), buffer.data() + pos, req.result);
+				}
+			}
+			else if (!batch.front().error)
+			{
+				auto& req = batch.front();
 
-				file->file.seek(old_pos);
+				req.result = req.type == 2
+					? req.file->op_write_at(req.offset, vm::static_ptr_cast<const void>(req.buf), req.size)
+					: req.file->op_read_at(req.offset, req.buf, req.size);
 			}
 
-			func(*this, aio, error, xid, result);
-			lv2_obj::sleep(*this);
+			cb_thread->complete(batch);
+			batch.clear();
+
+			lock.lock();
 		}
 	}
 };
@@ -911,40 +1491,78 @@ struct fs_aio_thread : ppu_thread
 struct fs_aio_manager
 {
 	std::shared_ptr<fs_aio_thread> thread;
+
+	std::mutex mutex;
+
+	// Initialized mount points (declared last to stop the workers first)
+	std::unordered_map<std::string, std::shared_ptr<fs_aio_mount>> mounts;
+
+	// Get the mount point for specified path
+	std::shared_ptr<fs_aio_mount> get(const char* path)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const auto found = mounts.find(get_mount_point(path));
+
+		if (found != mounts.end())
+		{
+			return found->second;
+		}
+
+		// Use any initialized mount point
+		if (!mounts.empty())
+		{
+			cellFs.warning("AIO is not initialized for %s, using %s", path, mounts.begin()->first);
+			return mounts.begin()->second;
+		}
+
+		return nullptr;
+	}
+
+	static std::string get_mount_point(const std::string& path)
+	{
+		// Take the first path component ("/dev_hdd0/a/b" -> "/dev_hdd0")
+		const auto pos = path.find_first_of('/', 1);
+		return path.substr(0, pos);
+	}
 };
 
 s32 cellFsAioInit(vm::cptr<char> mount_point)
 {
 	cellFs.warning("cellFsAioInit(mount_point=%s)", mount_point);
 
-	// TODO: create AIO thread (if not exists) for specified mount point
-	const auto m = fxm::make<fs_aio_manager>();
+	const auto m = fxm::get_always<fs_aio_manager>();
 
-	if (m)
+	std::lock_guard<std::mutex> lock(m->mutex);
+
+	if (!m->thread)
 	{
 		m->thread = idm::make_ptr<ppu_thread, fs_aio_thread>("FS AIO Thread", 500);
 		m->thread->run();
 	}
 
-	return CELL_OK;
-}
+	const std::string name = fs_aio_manager::get_mount_point(mount_point.get_ptr());
 
-s32 cellFsAioFinish(vm::cptr<char> mount_point)
-{
-	cellFs.warning("cellFsAioFinish(mount_point=%s)", mount_point);
+	if (m->mounts.count(name))
+	{
+		return CELL_OK;
+	}
+
+	if (m->mounts.size() >= CELL_FS_AIO_MAX_FS)
+	{
+		return CELL_EAGAIN;
+	}
 
-	// TODO: delete existing AIO thread for specified mount point
+	const auto mp = std::make_shared<fs_aio_mount>(name, m->thread);
+	mp->start(g_cfg.vfs.aio_threads);
+	m->mounts.emplace(name, mp);
 
 	return CELL_OK;
 }
 
-atomic_t<s32> g_fs_aio_id;
-
-s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
+s32 cellFsAioFinish(vm::cptr<char> mount_point)
 {
-	cellFs.warning("cellFsAioRead(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
-
-	// TODO: detect mount point and send AIO request to the AIO thread of this mount point
+	cellFs.warning("cellFsAioFinish(mount_point=%s)", mount_point);
 
 	const auto m = fxm::get<fs_aio_manager>();
 
@@ -953,25 +1571,31 @@ s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 		return CELL_ENXIO;
 	}
 
-	const s32 xid = (*id = ++g_fs_aio_id);
+	std::shared_ptr<fs_aio_mount> mp;
+	{
+		std::lock_guard<std::mutex> lock(m->mutex);
+
+		const auto found = m->mounts.find(fs_aio_manager::get_mount_point(mount_point.get_ptr()));
+
+		if (found == m->mounts.end())
+		{
+			return CELL_ENXIO;
+		}
 
-	m->thread->cmd_list
-	({
-		{ 1, xid },
-		{ aio, func },
-	});
+		mp = std::move(found->second);
+		m->mounts.erase(found);
+	}
 
-	m->thread->notify();
+	// Stop the workers (queued requests are completed with CELL_ECANCELED)
+	mp.reset();
 
 	return CELL_OK;
 }
 
-s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
-{
-	cellFs.warning("cellFsAioWrite(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
-
-	// TODO: detect mount point and send AIO request to the AIO thread of this mount point
+atomic_t<s32> g_fs_aio_id;
 
+static s32 fs_aio_submit(u32 type, vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
+{
 	const auto m = fxm::get<fs_aio_manager>();
 
 	if (!m)
@@ -979,24 +1603,71 @@ s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 		return CELL_ENXIO;
 	}
 
-	const s32 xid = (*id = ++g_fs_aio_id);
+	const auto file = idm::get<lv2_fs_object, lv2_file>(aio->fd);
+
+	// Use any mount point if the file is invalid (the error is reported through the callback)
+	const auto mp = m->get(file ? file->name.data() : "");
 
-	m->thread->cmd_list
-	({
-		{ 2, xid },
-		{ aio, func },
-	});
+	if (!mp)
+	{
+		return CELL_ENXIO;
+	}
+
+	fs_aio_request req{};
+	req.xid = (*id = ++g_fs_aio_id);
+	req.type = type;
+	req.aio = aio;
+	req.func = func;
+	req.file = file;
+	req.offset = aio->offset;
+	req.buf = aio->buf;
+	req.size = aio->size;
+
+	if (!file || (type == 1 && file->flags & CELL_FS_O_WRONLY) || (type == 2 && !(file->flags & CELL_FS_O_ACCMODE)))
+	{
+		req.error = CELL_EBADF;
+	}
 
-	m->thread->notify();
+	mp->push(std::move(req));
 
 	return CELL_OK;
 }
 
+s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
+{
+	cellFs.trace("cellFsAioRead(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
+
+	return fs_aio_submit(1, aio, id, func);
+}
+
+s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
+{
+	cellFs.trace("cellFsAioWrite(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
+
+	return fs_aio_submit(2, aio, id, func);
+}
+
 s32 cellFsAioCancel(s32 id)
 {
-	cellFs.todo("cellFsAioCancel(id=%d) -> CELL_EINVAL", id);
+	cellFs.warning("cellFsAioCancel(id=%d)", id);
 
-	// TODO: cancelled requests return CELL_ECANCELED through their own callbacks
+	const auto m = fxm::get<fs_aio_manager>();
+
+	if (!m)
+	{
+		return CELL_EINVAL;
+	}
+
+	std::lock_guard<std::mutex> lock(m->mutex);
+
+	// Cancelled requests return CELL_ECANCELED through their own callbacks
+	for (auto& mp : m->mounts)
+	{
+		if (mp.second->cancel(id))
+		{
+			return CELL_OK;
+		}
+	}
 
 	return CELL_EINVAL;
 }
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "Emu/Cell/lv2/sys_fs.h"
+#include "Utilities/Thread.h"
+
+#include <mutex>
+#include <condition_variable>
+
+namespace vm { using namespace ps3; }
 
 // CellFsRingBuffer.copy
 enum : s32
@@ -40,3 +46,110 @@ struct CellFsAio
 	be_t<u64> size;
 	be_t<u64> user_data;
 };
+
+// Streaming read state (one per file descriptor)
+struct fs_st_stream
+{
+	const u32 fd;
+	const std::shared_ptr<lv2_file> file;
+
+	// Callback thread
+	const std::shared_ptr<struct fs_st_thread> cb_thread;
+
+	// Ring buffer parameters
+	const u64 ringbuf_size;
+	const u64 block_size;
+	const u64 transfer_rate;
+	const s32 copy;
+
+	// Ring buffer in guest memory
+	const u32 addr;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	u64 read_pos = 0; // Amount of data consumed by the game
+	u64 write_pos = 0; // Amount of data written to the ring buffer
+	u64 offset = 0; // Current file offset
+	u64 end = 0; // File offset where streaming stops
+	u64 start_time = 0;
+	u32 generation = 0; // Incremented on start/stop to discard reads in flight
+	bool progress = false;
+	bool eof = false;
+	bool quit = false;
+
+	// Pending cellFsStReadWaitCallback request
+	u64 cb_size = 0;
+	vm::ptr<void(s32 xfd, u64 xsize)> cb_func{};
+
+	// Threads blocked in wait()
+	std::vector<thread_ctrl*> waiters;
+
+	std::shared_ptr<thread_ctrl> thread;
+
+	fs_st_stream(u32 fd, const std::shared_ptr<lv2_file>& file, const std::shared_ptr<fs_st_thread>& cb_thread, const CellFsRingBuffer& ringbuf, u32 addr)
+		: fd(fd)
+		, file(file)
+		, cb_thread(cb_thread)
+		, ringbuf_size(ringbuf.ringbuf_size)
+		, block_size(ringbuf.block_size)
+		, transfer_rate(ringbuf.transfer_rate)
+		, copy(ringbuf.copy)
+		, addr(addr)
+	{
+	}
+
+	~fs_st_stream()
+	{
+		stop();
+
+		if (thread)
+		{
+			thread->join();
+		}
+
+		if (addr)
+		{
+			vm::dealloc_verbose_nothrow(addr, vm::main);
+		}
+	}
+
+	// Terminate streaming and wake up all waiters (the object may still be referenced by them)
+	void stop()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+		progress = false;
+		wake();
+	}
+
+	// Amount of data available for reading
+	u64 available() const
+	{
+		return write_pos - read_pos;
+	}
+
+	// Check whether the wait for specified amount of data is over
+	bool ready(u64 size) const
+	{
+		return available() >= size || eof || !progress || quit;
+	}
+
+	// Notify the stream thread and waiting threads (must be called under the mutex)
+	void wake()
+	{
+		cv.notify_all();
+
+		for (thread_ctrl* waiter : waiters)
+		{
+			waiter->notify();
+		}
+	}
+
+	// Wait until ready(size) on the current thread (returns false if the stream was terminated)
+	bool wait(u64 size);
+
+	void task();
+
+	void check_callback();
+};
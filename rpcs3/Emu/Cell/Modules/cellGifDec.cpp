@@ -3,11 +3,9 @@
 #include "Emu/IdManager.h"
 #include "Emu/Cell/PPUModule.h"
 
-// STB_IMAGE_IMPLEMENTATION is already defined in stb_image.cpp
-#include <stb_image.h>
-
 #include "Emu/Cell/lv2/sys_fs.h"
 #include "cellGifDec.h"
+#include "ImageDecoder.h"
 
 logs::channel cellGifDec("cellGifDec");
 
@@ -28,6 +26,35 @@ using POutParam = vm::ptr<CellGifDecOutParam>;
 using PDataCtrlParam = vm::cptr<CellGifDecDataCtrlParam>;
 using PDataOutInfo = vm::ptr<CellGifDecDataOutInfo>;
 
+// img_decoder_pool request key
+static u64 gif_decode_key(PSubHandle subHandle)
+{
+	return u64{2} << 32 | subHandle.addr();
+}
+
+// Copy the GIF file to a buffer
+static std::vector<u8> gif_read_source(PSubHandle subHandle)
+{
+	std::vector<u8> gif(subHandle->fileSize);
+
+	switch (subHandle->src.srcSelect)
+	{
+	case CELL_GIFDEC_BUFFER:
+		std::memcpy(gif.data(), subHandle->src.streamPtr.get_ptr(), gif.size());
+		break;
+
+	case CELL_GIFDEC_FILE:
+	{
+		auto file = idm::get<lv2_fs_object, lv2_file>(subHandle->fd);
+		file->file.seek(0);
+		file->file.read(gif.data(), gif.size());
+		break;
+	}
+	}
+
+	return gif;
+}
+
 s32 cellGifDecCreate(PPMainHandle mainHandle, PThreadInParam threadInParam, PThreadOutParam threadOutParam)
 {
 	UNIMPLEMENTED_FUNC(cellGifDec);
@@ -121,7 +148,10 @@ s32 cellGifDecReadHeader(PMainHandle mainHandle, PSubHandle subHandle, PInfo inf
 	current_info.SPixelAspectRatio       = buffer[12];
 
 	*info = current_info;
-	
+
+	// Start decoding the whole file in the background
+	fxm::get_always<img_decoder_pool>()->submit(gif_decode_key(subHandle), gif_read_source(subHandle));
+
 	return CELL_OK;
 }
 
@@ -166,101 +196,34 @@ s32 cellGifDecDecodeData(PMainHandle mainHandle, PSubHandle subHandle, vm::ptr<u
 
 	dataOutInfo->status = CELL_GIFDEC_DEC_STATUS_STOP;
 
-	const u32& fd = subHandle->fd;
-	const u64& fileSize = subHandle->fileSize;
 	const CellGifDecOutParam& current_outParam = subHandle->outParam; 
 
-	//Copy the GIF file to a buffer
-	std::unique_ptr<u8[]> gif(new u8[fileSize]);
+	// Get the image decoded in the background (started by ReadHeader)
+	auto decode = fxm::get_always<img_decoder_pool>()->take(gif_decode_key(subHandle));
 
-	switch (subHandle->src.srcSelect)
+	if (!decode)
 	{
-	case CELL_GIFDEC_BUFFER:
-		std::memcpy(gif.get(), subHandle->src.streamPtr.get_ptr(), fileSize);
-		break;
-
-	case CELL_GIFDEC_FILE:
-	{
-		auto file = idm::get<lv2_fs_object, lv2_file>(fd);
-		file->file.seek(0);
-		file->file.read(gif.get(), fileSize);
-		break;
-	}
+		decode = std::make_shared<img_decode_task>(gif_read_source(subHandle));
 	}
 
-	//Decode GIF file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
-	int width, height, actual_components;
-	auto image = std::unique_ptr<unsigned char,decltype(&::free)>
-		(
-			stbi_load_from_memory(gif.get(), (s32)fileSize, &width, &height, &actual_components, 4),
-			&::free
-		);
+	// Decode GIF file (or wait for the worker)
+	s32 width, height;
+	const u8* image = decode->get(width, height);
 
 	if (!image)
 		return CELL_GIFDEC_ERROR_STREAM_FORMAT;
 
-	const int bytesPerLine = (u32)dataCtrlParam->outputBytesPerLine;
-	const char nComponents = 4;
-	uint image_size = width * height * nComponents;
+	const u32 bytesPerLine = (u32)dataCtrlParam->outputBytesPerLine;
 
 	switch((u32)current_outParam.outputColorSpace)
 	{
 	case CELL_GIFDEC_RGBA:
-	{
-		if (bytesPerLine > width * nComponents) // Check if we need padding
-		{
-			const int linesize = std::min(bytesPerLine, width * nComponents);
-			for (int i = 0; i < height; i++)
-			{
-				const int dstOffset = i * bytesPerLine;
-				const int srcOffset = width * nComponents * i;
-				memcpy(&data[dstOffset], &image.get()[srcOffset], linesize);
-			}
-		}
-		else
-		{
-			memcpy(data.get_ptr(), image.get(), image_size);
-		}
-	}
-	break;
-
 	case CELL_GIFDEC_ARGB:
 	{
-		if (bytesPerLine > width * nComponents) // Check if we need padding
-		{
-			//TODO: find out if we can't do padding without an extra copy
-			const int linesize = std::min(bytesPerLine, width * nComponents);
-			char *output = (char *) malloc(linesize);
-			for (int i = 0; i < height; i++)
-			{
-				const int dstOffset = i * bytesPerLine;
-				const int srcOffset = width * nComponents * i;
-				for (int j = 0; j < linesize; j += nComponents)
-				{
-					output[j + 0] = image.get()[srcOffset + j + 3];
-					output[j + 1] = image.get()[srcOffset + j + 0];
-					output[j + 2] = image.get()[srcOffset + j + 1];
-					output[j + 3] = image.get()[srcOffset + j + 2];
-				}
-				memcpy(&data[dstOffset], output, linesize);
-			}
-			free(output);
-		}
-		else
-		{
-			uint* img = (uint*)new char[image_size];
-			uint* source_current = (uint*)&(image.get()[0]);
-			uint* dest_current = img;
-			for (uint i = 0; i < image_size / nComponents; i++) 
-			{
-				uint val = *source_current;
-				*dest_current = (val >> 24) | (val << 8); // set alpha (A8) as leftmost byte
-				source_current++;
-				dest_current++;
-			}
-			memcpy(data.get_ptr(), img, image_size); 
-			delete[] img;
-		}
+		const img_format format = current_outParam.outputColorSpace == CELL_GIFDEC_RGBA ? img_format::rgba : img_format::argb;
+
+		// Convert directly into the output buffer
+		img_convert(data.get_ptr(), bytesPerLine ? bytesPerLine : width * 4, image, width, height, format, false);
 	}
 	break;
 
@@ -285,6 +248,11 @@ s32 cellGifDecClose(PMainHandle mainHandle, PSubHandle subHandle)
 
 	idm::remove<lv2_fs_object, lv2_file>(subHandle->fd);
 
+	if (const auto pool = fxm::get<img_decoder_pool>())
+	{
+		pool->cancel(gif_decode_key(subHandle));
+	}
+
 	vm::dealloc(subHandle.addr());
 
 	return CELL_OK;
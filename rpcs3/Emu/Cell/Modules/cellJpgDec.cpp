@@ -3,14 +3,18 @@
 #include "Emu/IdManager.h"
 #include "Emu/Cell/PPUModule.h"
 
-// STB_IMAGE_IMPLEMENTATION is already defined in stb_image.cpp
-#include <stb_image.h>
-
 #include "Emu/Cell/lv2/sys_fs.h"
 #include "cellJpgDec.h"
+#include "ImageDecoder.h"
 
 logs::channel cellJpgDec("cellJpgDec");
 
+// img_decoder_pool request key
+static u64 jpg_decode_key(u32 subHandle)
+{
+	return u64{1} << 32 | subHandle;
+}
+
 s32 cellJpgDecCreate(u32 mainHandle, u32 threadInParam, u32 threadOutParam)
 {
 	UNIMPLEMENTED_FUNC(cellJpgDec);
@@ -37,6 +41,7 @@ s32 cellJpgDecOpen(u32 mainHandle, vm::ptr<u32> subHandle, vm::ptr<CellJpgDecSrc
 
 	current_subHandle.fd = 0;
 	current_subHandle.src = *src;
+	current_subHandle.outputColorAlpha = 0xff;
 
 	switch (src->srcSelect)
 	{
@@ -81,6 +86,11 @@ s32 cellJpgDecClose(u32 mainHandle, u32 subHandle)
 	idm::remove<lv2_fs_object, lv2_file>(subHandle_data->fd);
 	idm::remove<CellJpgDecSubHandle>(subHandle);
 
+	if (const auto pool = fxm::get<img_decoder_pool>())
+	{
+		pool->cancel(jpg_decode_key(subHandle));
+	}
+
 	return CELL_OK;
 }
 
@@ -100,19 +110,19 @@ s32 cellJpgDecReadHeader(u32 mainHandle, u32 subHandle, vm::ptr<CellJpgDecInfo>
 	CellJpgDecInfo& current_info = subHandle_data->info;
 
 	// Write the header to buffer
-	std::unique_ptr<u8[]> buffer(new u8[fileSize]);
+	std::vector<u8> buffer(fileSize);
 
 	switch (subHandle_data->src.srcSelect)
 	{
 	case CELL_JPGDEC_BUFFER:
-		std::memcpy(buffer.get(), vm::base(subHandle_data->src.streamPtr), fileSize);
+		std::memcpy(buffer.data(), vm::base(subHandle_data->src.streamPtr), fileSize);
 		break;
 
 	case CELL_JPGDEC_FILE:
 	{
 		auto file = idm::get<lv2_fs_object, lv2_file>(fd);
 		file->file.seek(0);
-		file->file.read(buffer.get(), fileSize);
+		file->file.read(buffer.data(), fileSize);
 		break;
 	}
 	}
@@ -153,6 +163,9 @@ s32 cellJpgDecReadHeader(u32 mainHandle, u32 subHandle, vm::ptr<CellJpgDecInfo>
 
 	*info = current_info;
 
+	// Start decoding the whole file in the background
+	fxm::get_always<img_decoder_pool>()->submit(jpg_decode_key(subHandle), std::move(buffer));
+
 	return CELL_OK;
 }
 
@@ -178,102 +191,58 @@ s32 cellJpgDecDecodeData(u32 mainHandle, u32 subHandle, vm::ptr<u8> data, vm::cp
 	const u64& fileSize = subHandle_data->fileSize;
 	const CellJpgDecOutParam& current_outParam = subHandle_data->outParam; 
 
-	//Copy the JPG file to a buffer
-	std::unique_ptr<u8[]> jpg(new u8[fileSize]);
+	// Get the image decoded in the background (started by ReadHeader)
+	auto decode = fxm::get_always<img_decoder_pool>()->take(jpg_decode_key(subHandle));
 
-	switch (subHandle_data->src.srcSelect)
+	if (!decode)
 	{
-	case CELL_JPGDEC_BUFFER:
-		std::memcpy(jpg.get(), vm::base(subHandle_data->src.streamPtr), fileSize);
-		break;
+		//Copy the JPG file to a buffer
+		std::vector<u8> jpg(fileSize);
 
-	case CELL_JPGDEC_FILE:
-	{
-		auto file = idm::get<lv2_fs_object, lv2_file>(fd);
-		file->file.seek(0);
-		file->file.read(jpg.get(), fileSize);
-		break;
-	}
+		switch (subHandle_data->src.srcSelect)
+		{
+		case CELL_JPGDEC_BUFFER:
+			std::memcpy(jpg.data(), vm::base(subHandle_data->src.streamPtr), fileSize);
+			break;
+
+		case CELL_JPGDEC_FILE:
+		{
+			auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+			file->file.seek(0);
+			file->file.read(jpg.data(), fileSize);
+			break;
+		}
+		}
+
+		decode = std::make_shared<img_decode_task>(std::move(jpg));
 	}
 
-	//Decode JPG file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
-	int width, height, actual_components;
-	auto image = std::unique_ptr<unsigned char,decltype(&::free)>
-		(
-			stbi_load_from_memory(jpg.get(), (s32)fileSize, &width, &height, &actual_components, 4),
-			&::free
-		);
+	// Decode JPG file (or wait for the worker)
+	s32 width, height;
+	const u8* image = decode->get(width, height);
 
 	if (!image)
 		return CELL_JPGDEC_ERROR_STREAM_FORMAT;
 
 	const bool flip = current_outParam.outputMode == CELL_JPGDEC_BOTTOM_TO_TOP;
-	const int bytesPerLine = (u32)dataCtrlParam->outputBytesPerLine;
+	const u32 bytesPerLine = (u32)dataCtrlParam->outputBytesPerLine;
 	size_t image_size = width * height;
 
 	switch((u32)current_outParam.outputColorSpace)
 	{
 	case CELL_JPG_RGB:
 	case CELL_JPG_RGBA:
-	{
-		const char nComponents = current_outParam.outputColorSpace == CELL_JPG_RGBA ? 4 : 3;
-		image_size *= nComponents;
-		if (bytesPerLine > width * nComponents || flip) //check if we need padding
-		{
-			const int linesize = std::min(bytesPerLine, width * nComponents);
-			for (int i = 0; i < height; i++)
-			{
-				const int dstOffset = i * bytesPerLine;
-				const int srcOffset = width * nComponents * (flip ? height - i - 1 : i);
-				memcpy(&data[dstOffset], &image.get()[srcOffset], linesize);
-			}
-		}
-		else
-		{
-			memcpy(data.get_ptr(), image.get(), image_size);
-		}
-	}
-	break;
-
 	case CELL_JPG_ARGB:
 	{
-		const int nComponents = 4;
+		const img_format format =
+			current_outParam.outputColorSpace == CELL_JPG_RGB ? img_format::rgb :
+			current_outParam.outputColorSpace == CELL_JPG_RGBA ? img_format::rgba : img_format::argb;
+
+		const u32 nComponents = format == img_format::rgb ? 3 : 4;
 		image_size *= nComponents;
-		if (bytesPerLine > width * nComponents || flip) //check if we need padding
-		{
-			//TODO: Find out if we can't do padding without an extra copy
-			const int linesize = std::min(bytesPerLine, width * nComponents);
-			char *output = (char *) malloc(linesize);
-			for (int i = 0; i < height; i++)
-			{
-				const int dstOffset = i * bytesPerLine;
-				const int srcOffset = width * nComponents * (flip ? height - i - 1 : i);
-				for (int j = 0; j < linesize; j += nComponents)
-				{
-					output[j + 0] = image.get()[srcOffset + j + 3];
-					output[j + 1] = image.get()[srcOffset + j + 0];
-					output[j + 2] = image.get()[srcOffset + j + 1];
-					output[j + 3] = image.get()[srcOffset + j + 2];
-				}
-				memcpy(&data[dstOffset], output, linesize);
-			}
-			free(output);
-		}
-		else
-		{
-			uint* img = (uint*)new char[image_size];
-			uint* source_current = (uint*)&(image.get()[0]);
-			uint* dest_current = img;
-			for (uint i = 0; i < image_size / nComponents; i++) 
-			{
-				uint val = *source_current;
-				*dest_current = (val >> 24) | (val << 8); // set alpha (A8) as leftmost byte
-				source_current++;
-				dest_current++;
-			}
-			memcpy(data.get_ptr(), img, image_size); 
-			delete[] img;
-		}
+
+		// Convert directly into the output buffer (JPG has no alpha channel, it's set to outputColorAlpha)
+		img_convert(data.get_ptr(), bytesPerLine ? bytesPerLine : width * nComponents, image, width, height, format, flip, subHandle_data->outputColorAlpha);
 	}
 	break;
 
@@ -320,6 +289,7 @@ s32 cellJpgDecSetParameter(u32 mainHandle, u32 subHandle, vm::cptr<CellJpgDecInP
 	current_outParam.outputWidth      = current_info.imageWidth;
 	current_outParam.outputHeight     = current_info.imageHeight;
 	current_outParam.outputColorSpace = inParam->outputColorSpace;
+	subHandle_data->outputColorAlpha  = inParam->outputColorAlpha;
 
 	switch ((u32)current_outParam.outputColorSpace)
 	{
@@ -118,4 +118,5 @@ struct CellJpgDecSubHandle
 	CellJpgDecInfo info;
 	CellJpgDecOutParam outParam;
 	CellJpgDecSrc src;
+	u8 outputColorAlpha;
 };
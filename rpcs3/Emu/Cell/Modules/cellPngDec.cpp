@@ -765,17 +765,23 @@ s32 pngDecodeData(ppu_thread& ppu, PHandle handle, PStream stream, vm::ptr<u8> d
 		// Check if the image needs to be flipped
 		const bool flip = stream->out_param.outputMode == CELL_PNGDEC_BOTTOM_TO_TOP;
 
+		// Rows are decoded directly into the output buffer
+		const u32 height = stream->out_param.outputHeight;
+		std::vector<png_bytep> rows(height);
+
+		for (u32 i = 0; i < height; ++i)
+		{
+			const u32 line = flip ? height - i - 1 : i;
+			rows[i] = &data[line * bytes_per_line];
+		}
+
 		// Decode the image
 		// todo: commandptr
 		try 
 		{
 			for (int j = 0; j < stream->passes; j++)
 			{
-				for (int i = 0; i < stream->out_param.outputHeight; ++i)
-				{
-					const u32 line = flip ? stream->out_param.outputHeight - i - 1 : i;
-					png_read_row(stream->png_ptr, &data[line*bytes_per_line], nullptr);
-				}
+				png_read_rows(stream->png_ptr, rows.data(), nullptr, height);
 			}
 			png_read_end(stream->png_ptr, stream->info_ptr);
 		}
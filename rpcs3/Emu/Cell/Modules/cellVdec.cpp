@@ -11,8 +11,14 @@ extern "C"
 #include "libswscale/swscale.h"
 }
 
+// Decoding API with separate packet submission and frame retrieval
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 100)
+#define VDEC_SEND_RECEIVE
+#endif
+
 #include "cellPamf.h"
 #include "cellVdec.h"
+#include "cellVpost.h"
 
 #include <mutex>
 #include <queue>
@@ -79,6 +85,8 @@ struct vdec_thread : ppu_thread
 	std::queue<vdec_frame> out;
 	u32 max_frames = 20;
 
+	vpost_sws_cache sws; // For cellVdecGetPicture
+
 	vdec_thread(s32 type, u32 profile, u32 addr, u32 size, vm::ptr<CellVdecCbMsg> func, u32 arg, u32 prio, u32 stack)
 		: ppu_thread("HLE Video Decoder", prio, stack)
 		, type(type)
@@ -125,6 +133,10 @@ struct vdec_thread : ppu_thread
 			fmt::throw_exception("avcodec_alloc_context3() failed (type=0x%x)" HERE, type);
 		}
 
+		// Frame threading decodes several frames at once (adds the latency of one frame per thread)
+		ctx->thread_count = g_cfg.video.vdec_threads; // 0: auto
+		ctx->thread_type = g_cfg.video.vdec_frame_threading ? FF_THREAD_FRAME | FF_THREAD_SLICE : FF_THREAD_SLICE;
+
 		AVDictionary* opts{};
 		av_dict_set(&opts, "refcounted_frames", "1", 0);
 
@@ -150,6 +162,130 @@ struct vdec_thread : ppu_thread
 		return ppu_thread::dump();
 	}
 
+	// Set timestamps and frame rate of the decoded picture, then queue it and notify the guest
+	void output_frame(vdec_frame&& frame)
+	{
+		if (frame->interlaced_frame)
+		{
+			fmt::throw_exception("Interlaced frames not supported (0x%x)", frame->interlaced_frame);
+		}
+
+		if (frame->repeat_pict)
+		{
+			fmt::throw_exception("Repeated frames not supported (0x%x)", frame->repeat_pict);
+		}
+
+		if (frame->pkt_pts != AV_NOPTS_VALUE)
+		{
+			next_pts = frame->pkt_pts;
+		}
+
+		if (frame->pkt_dts != AV_NOPTS_VALUE)
+		{
+			next_dts = frame->pkt_dts;
+		}
+
+		frame.pts = next_pts;
+		frame.dts = next_dts;
+		frame.userdata = frame->reordered_opaque;
+
+		if (frc_set)
+		{
+			u64 amend = 0;
+
+			switch (frc_set)
+			{
+			case CELL_VDEC_FRC_24000DIV1001: amend = 1001 * 90000 / 24000; break;
+			case CELL_VDEC_FRC_24: amend = 90000 / 24; break;
+			case CELL_VDEC_FRC_25: amend = 90000 / 25; break;
+			case CELL_VDEC_FRC_30000DIV1001: amend = 1001 * 90000 / 30000; break;
+			case CELL_VDEC_FRC_30: amend = 90000 / 30; break;
+			case CELL_VDEC_FRC_50: amend = 90000 / 50; break;
+			case CELL_VDEC_FRC_60000DIV1001: amend = 1001 * 90000 / 60000; break;
+			case CELL_VDEC_FRC_60: amend = 90000 / 60; break;
+			default:
+			{
+				fmt::throw_exception("Invalid frame rate code set (0x%x)" HERE, frc_set);
+			}
+			}
+
+			next_pts += amend;
+			next_dts += amend;
+			frame.frc = frc_set;
+		}
+		else if (ctx->time_base.num == 0)
+		{
+			// Hack
+			const u64 amend = u64{90000} / 30;
+			frame.frc = CELL_VDEC_FRC_30;
+			next_pts += amend;
+			next_dts += amend;
+		}
+		else
+		{
+			const u64 amend = u64{90000} * ctx->time_base.num * ctx->ticks_per_frame / ctx->time_base.den;
+			next_pts += amend;
+			next_dts += amend;
+
+			const auto freq = 1. * ctx->time_base.den / ctx->time_base.num / ctx->ticks_per_frame;
+
+			if (std::abs(freq - 23.976) < 0.002)
+				frame.frc = CELL_VDEC_FRC_24000DIV1001;
+			else if (std::abs(freq - 24.000) < 0.001)
+				frame.frc = CELL_VDEC_FRC_24;
+			else if (std::abs(freq - 25.000) < 0.001)
+				frame.frc = CELL_VDEC_FRC_25;
+			else if (std::abs(freq - 29.970) < 0.002)
+				frame.frc = CELL_VDEC_FRC_30000DIV1001;
+			else if (std::abs(freq - 30.000) < 0.001)
+				frame.frc = CELL_VDEC_FRC_30;
+			else if (std::abs(freq - 50.000) < 0.001)
+				frame.frc = CELL_VDEC_FRC_50;
+			else if (std::abs(freq - 59.940) < 0.002)
+				frame.frc = CELL_VDEC_FRC_60000DIV1001;
+			else if (std::abs(freq - 60.000) < 0.001)
+				frame.frc = CELL_VDEC_FRC_60;
+			else
+				fmt::throw_exception("Unsupported time_base.num (%d/%d, tpf=%d)" HERE, ctx->time_base.den, ctx->time_base.num, ctx->ticks_per_frame);
+		}
+
+		cellVdec.trace("Got picture (pts=0x%llx[0x%llx], dts=0x%llx[0x%llx])", frame.pts, frame->pkt_pts, frame.dts, frame->pkt_dts);
+
+		std::lock_guard<std::mutex>{mutex}, out.push(std::move(frame));
+
+		cb_func(*this, id, CELL_VDEC_MSG_TYPE_PICOUT, CELL_OK, cb_arg);
+		lv2_obj::sleep(*this);
+	}
+
+#ifdef VDEC_SEND_RECEIVE
+	// Receive one decoded frame (returns false if the decoder needs more input or is drained)
+	bool receive_frame()
+	{
+		vdec_frame frame;
+		frame.avf.reset(av_frame_alloc());
+
+		if (!frame.avf)
+		{
+			fmt::throw_exception("av_frame_alloc() failed" HERE);
+		}
+
+		const int ret = avcodec_receive_frame(ctx, frame.avf.get());
+
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+		{
+			return false;
+		}
+
+		if (ret < 0)
+		{
+			fmt::throw_exception("AU decoding error(0x%x)" HERE, ret);
+		}
+
+		output_frame(std::move(frame));
+		return true;
+	}
+#endif
+
 	virtual void cpu_task() override
 	{
 		while (cmd64 cmd = cmd_wait())
@@ -174,8 +310,6 @@ struct vdec_thread : ppu_thread
 				AVPacket packet{};
 				packet.pos = -1;
 
-				u64 au_usrd{};
-
 				if (vcmd == vdec_cmd::decode)
 				{
 					const u32 au_mode = cmd.arg2<u32>();  // TODO
@@ -183,7 +317,7 @@ struct vdec_thread : ppu_thread
 					const u32 au_size = cmd_get(1).arg2<u32>();
 					const u64 au_pts = cmd_get(2).as<u64>();
 					const u64 au_dts = cmd_get(3).as<u64>();
-					au_usrd = cmd_get(4).as<u64>(); // TODO
+					const u64 au_usrd = cmd_get(4).as<u64>(); // TODO
 					const u64 au_spec = cmd_get(5).as<u64>(); // Unused
 					cmd_pop(5);
 
@@ -206,6 +340,9 @@ struct vdec_thread : ppu_thread
 						au_mode == CELL_VDEC_DEC_MODE_NORMAL ? AVDISCARD_DEFAULT :
 						au_mode == CELL_VDEC_DEC_MODE_B_SKIP ? AVDISCARD_NONREF : AVDISCARD_NONINTRA;
 
+					// Userdata follows the AU through reordering and frame threading delays
+					ctx->reordered_opaque = au_usrd;
+
 					cellVdec.trace("AU decoding: size=0x%x, pts=0x%llx, dts=0x%llx, userdata=0x%llx", au_size, au_pts, au_dts, au_usrd);
 				}
 				else
@@ -217,6 +354,48 @@ struct vdec_thread : ppu_thread
 					cellVdec.trace("End sequence...");
 				}
 
+				// Result reported with AUDONE
+				s32 au_result = CELL_OK;
+
+#ifdef VDEC_SEND_RECEIVE
+				if (vcmd == vdec_cmd::decode)
+				{
+					// Submit the AU (receive decoded frames while the decoder doesn't accept more input)
+					int ret = 0;
+
+					while (max_frames && (ret = avcodec_send_packet(ctx, &packet)) == AVERROR(EAGAIN))
+					{
+						if (!receive_frame())
+						{
+							// Neither input nor output is possible, the AU can't be decoded
+							cellVdec.error("AU decoding error: decoder doesn't accept input (size=0x%x)", packet.size);
+							au_result = CELL_VDEC_ERROR_AU;
+							break;
+						}
+					}
+
+					if (ret < 0 && ret != AVERROR(EAGAIN))
+					{
+						fmt::throw_exception("AU decoding error(0x%x)" HERE, ret);
+					}
+				}
+				else
+				{
+					// Drain the decoder
+					avcodec_send_packet(ctx, nullptr);
+				}
+
+				// Receive all frames available (decoding threads may still work on the following ones)
+				while (max_frames && receive_frame())
+				{
+				}
+
+				if (vcmd == vdec_cmd::end_seq)
+				{
+					// Leave the draining mode
+					avcodec_flush_buffers(ctx);
+				}
+#else
 				while (max_frames)
 				{
 					vdec_frame frame;
@@ -246,113 +425,23 @@ struct vdec_thread : ppu_thread
 						cellVdec.error("Incorrect AU size (0x%x, decoded 0x%x)", packet.size, decode);
 					}
 
-					if (got_picture)
-					{
-						if (frame->interlaced_frame)
-						{
-							fmt::throw_exception("Interlaced frames not supported (0x%x)", frame->interlaced_frame);
-						}
-
-						if (frame->repeat_pict)
-						{
-							fmt::throw_exception("Repeated frames not supported (0x%x)", frame->repeat_pict);
-						}
-
-						if (frame->pkt_pts != AV_NOPTS_VALUE)
-						{
-							next_pts = frame->pkt_pts;
-						}
-
-						if (frame->pkt_dts != AV_NOPTS_VALUE)
-						{
-							next_dts = frame->pkt_dts;
-						}
-
-						frame.pts = next_pts;
-						frame.dts = next_dts;
-						frame.userdata = au_usrd;
-
-						if (frc_set)
-						{
-							u64 amend = 0;
-
-							switch (frc_set)
-							{
-							case CELL_VDEC_FRC_24000DIV1001: amend = 1001 * 90000 / 24000; break;
-							case CELL_VDEC_FRC_24: amend = 90000 / 24; break;
-							case CELL_VDEC_FRC_25: amend = 90000 / 25; break;
-							case CELL_VDEC_FRC_30000DIV1001: amend = 1001 * 90000 / 30000; break;
-							case CELL_VDEC_FRC_30: amend = 90000 / 30; break;
-							case CELL_VDEC_FRC_50: amend = 90000 / 50; break;
-							case CELL_VDEC_FRC_60000DIV1001: amend = 1001 * 90000 / 60000; break;
-							case CELL_VDEC_FRC_60: amend = 90000 / 60; break;
-							default:
-							{
-								fmt::throw_exception("Invalid frame rate code set (0x%x)" HERE, frc_set);
-							}
-							}
-
-							next_pts += amend;
-							next_dts += amend;
-							frame.frc = frc_set;
-						}
-						else if (ctx->time_base.num == 0)
-						{
-							// Hack
-							const u64 amend = u64{90000} / 30;
-							frame.frc = CELL_VDEC_FRC_30;
-							next_pts += amend;
-							next_dts += amend;
-						}
-						else
-						{
-							const u64 amend = u64{90000} * ctx->time_base.num * ctx->ticks_per_frame / ctx->time_base.den;
-							next_pts += amend;
-							next_dts += amend;
-
-							const auto freq = 1. * ctx->time_base.den / ctx->time_base.num / ctx->ticks_per_frame;
-
-							if (std::abs(freq - 23.976) < 0.002)
-								frame.frc = CELL_VDEC_FRC_24000DIV1001;
-							else if (std::abs(freq - 24.000) < 0.001)
-								frame.frc = CELL_VDEC_FRC_24;
-							else if (std::abs(freq - 25.000) < 0.001)
-								frame.frc = CELL_VDEC_FRC_25;
-							else if (std::abs(freq - 29.970) < 0.002)
-								frame.frc = CELL_VDEC_FRC_30000DIV1001;
-							else if (std::abs(freq - 30.000) < 0.001)
-								frame.frc = CELL_VDEC_FRC_30;
-							else if (std::abs(freq - 50.000) < 0.001)
-								frame.frc = CELL_VDEC_FRC_50;
-							else if (std::abs(freq - 59.940) < 0.002)
-								frame.frc = CELL_VDEC_FRC_60000DIV1001;
-							else if (std::abs(freq - 60.000) < 0.001)
-								frame.frc = CELL_VDEC_FRC_60;
-							else
-								fmt::throw_exception("Unsupported time_base.num (%d/%d, tpf=%d)" HERE, ctx->time_base.den, ctx->time_base.num, ctx->ticks_per_frame);
-						}
-
-						cellVdec.trace("Got picture (pts=0x%llx[0x%llx], dts=0x%llx[0x%llx])", frame.pts, frame->pkt_pts, frame.dts, frame->pkt_dts);
-
-						std::lock_guard<std::mutex>{mutex}, out.push(std::move(frame));
-
-						cb_func(*this, id, CELL_VDEC_MSG_TYPE_PICOUT, CELL_OK, cb_arg);
-						lv2_obj::sleep(*this);
-					}
+					output_frame(std::move(frame));
 
 					if (vcmd == vdec_cmd::decode)
 					{
 						break;
 					}
 				}
+#endif
 
 				if (max_frames)
 				{
-					cb_func(*this, id, vcmd == vdec_cmd::decode ? CELL_VDEC_MSG_TYPE_AUDONE : CELL_VDEC_MSG_TYPE_SEQDONE, CELL_OK, cb_arg);
+					cb_func(*this, id, vcmd == vdec_cmd::decode ? CELL_VDEC_MSG_TYPE_AUDONE : CELL_VDEC_MSG_TYPE_SEQDONE, au_result, cb_arg);
 					lv2_obj::sleep(*this);
 				}
-				
-				while (std::lock_guard<std::mutex>{mutex}, max_frames && out.size() > max_frames)
+
+				// Bounded output queue: don't decode the next AU until the guest takes pictures (after the callbacks are sent)
+				while (std::lock_guard<std::mutex>{mutex}, max_frames && out.size() >= max_frames)
 				{
 					thread_ctrl::wait();
 				}
@@ -552,7 +641,7 @@ s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u
 
 		vdec->out.pop();
 
-		if (vdec->out.size() <= vdec->max_frames)
+		if (vdec->out.size() < vdec->max_frames)
 		{
 			vdec->notify();
 		}
@@ -567,12 +656,14 @@ s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u
 
 		AVPixelFormat out_f = AV_PIX_FMT_YUV420P;
 
-		std::unique_ptr<u8[]> alpha_plane;
+		bool alpha = false;
 
-		switch (const u32 type = format->formatType)
+		const u32 type = format->formatType;
+
+		switch (type)
 		{
-		case CELL_VDEC_PICFMT_ARGB32_ILV: out_f = AV_PIX_FMT_ARGB; alpha_plane.reset(new u8[w * h]); break;
-		case CELL_VDEC_PICFMT_RGBA32_ILV: out_f = AV_PIX_FMT_RGBA; alpha_plane.reset(new u8[w * h]); break;
+		case CELL_VDEC_PICFMT_ARGB32_ILV: out_f = AV_PIX_FMT_ARGB; alpha = true; break;
+		case CELL_VDEC_PICFMT_RGBA32_ILV: out_f = AV_PIX_FMT_RGBA; alpha = true; break;
 		case CELL_VDEC_PICFMT_UYVY422_ILV: out_f = AV_PIX_FMT_UYVY422; break;
 		case CELL_VDEC_PICFMT_YUV420_PLANAR: out_f = AV_PIX_FMT_YUV420P; break;
 
@@ -588,16 +679,11 @@ s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u
 			fmt::throw_exception("Unknown colorMatrixType (%d)" HERE, format->colorMatrixType);
 		}
 
-		if (alpha_plane)
-		{
-			std::memset(alpha_plane.get(), format->alpha, w * h);
-		}
-
 		AVPixelFormat in_f = AV_PIX_FMT_YUV420P;
 
 		switch (frame->format)
 		{
-		case AV_PIX_FMT_YUV420P: in_f = alpha_plane ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_YUV420P; break;
+		case AV_PIX_FMT_YUV420P: in_f = alpha ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_YUV420P; break;
 
 		default:
 		{
@@ -605,14 +691,45 @@ s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u
 		}
 		}
 
-		std::unique_ptr<SwsContext, void(*)(SwsContext*)> sws(sws_getContext(w, h, in_f, w, h, out_f, SWS_POINT, NULL, NULL, NULL), sws_freeContext);
+		// Fast paths (the output is written directly)
+		if (!(w & 1) && !(h & 1))
+		{
+			if (alpha)
+			{
+				vpost_yuv420_to_rgba(outBuff.get_ptr(), w * 4, frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1], frame->data[2], frame->linesize[2], w, h, format->alpha, type == CELL_VDEC_PICFMT_ARGB32_ILV);
+				return CELL_OK;
+			}
+
+			if (type == CELL_VDEC_PICFMT_YUV420_PLANAR)
+			{
+				u8* out = outBuff.get_ptr();
+
+				// Copy planes (without padding)
+				for (u32 i = 0; i < 3; i++)
+				{
+					const int pw = i ? w / 2 : w;
+					const int ph = i ? h / 2 : h;
+
+					for (int y = 0; y < ph; y++, out += pw)
+					{
+						std::memcpy(out, frame->data[i] + y * frame->linesize[i], pw);
+					}
+				}
+
+				return CELL_OK;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(vdec->sws.mutex);
+
+		SwsContext* const sws = vdec->sws.get(w, h, in_f, w, h, out_f, SWS_POINT);
 
-		u8* in_data[4] = { frame->data[0], frame->data[1], frame->data[2], alpha_plane.get() };
+		const u8* in_data[4] = { frame->data[0], frame->data[1], frame->data[2], alpha ? vdec->sws.alpha_plane(w * h, format->alpha) : nullptr };
 		int in_line[4] = { frame->linesize[0], frame->linesize[1], frame->linesize[2], w * 1 };
 		u8* out_data[4] = { outBuff.get_ptr() };
 		int out_line[4] = { w * 4 };
 
-		if (!alpha_plane)
+		if (!alpha)
 		{
 			out_data[1] = out_data[0] + w * h;
 			out_data[2] = out_data[0] + w * h * 5 / 4;
@@ -621,7 +738,7 @@ s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u
 			out_line[2] = w / 2;
 		}
 
-		sws_scale(sws.get(), in_data, in_line, 0, h, out_data, out_line);
+		sws_scale(sws, in_data, in_line, 0, h, out_data, out_line);
 
 		//const u32 buf_size = align(av_image_get_buffer_size(vdec->ctx->pix_fmt, vdec->ctx->width, vdec->ctx->height, 1), 128);
 
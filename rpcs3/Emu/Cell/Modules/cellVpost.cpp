@@ -12,6 +12,174 @@ extern "C"
 
 logs::channel cellVpost("cellVpost");
 
+vpost_sws_cache::~vpost_sws_cache()
+{
+	for (auto& e : m_entries)
+	{
+		sws_freeContext(e.ctx);
+	}
+}
+
+SwsContext* vpost_sws_cache::get(s32 in_w, s32 in_h, s32 in_f, s32 out_w, s32 out_h, s32 out_f, s32 flags)
+{
+	entry* lru = &m_entries[0];
+
+	for (auto& e : m_entries)
+	{
+		if (e.ctx && e.in_w == in_w && e.in_h == in_h && e.in_f == in_f && e.out_w == out_w && e.out_h == out_h && e.out_f == out_f && e.flags == flags)
+		{
+			e.used = ++m_stamp;
+			return e.ctx;
+		}
+
+		if (e.used < lru->used)
+		{
+			lru = &e;
+		}
+	}
+
+	sws_freeContext(lru->ctx);
+
+	*lru = {sws_getContext(in_w, in_h, static_cast<AVPixelFormat>(in_f), out_w, out_h, static_cast<AVPixelFormat>(out_f), flags, NULL, NULL, NULL), in_w, in_h, in_f, out_w, out_h, out_f, flags, ++m_stamp};
+
+	if (!lru->ctx)
+	{
+		fmt::throw_exception("sws_getContext() failed (%dx%d, fmt=%d -> %dx%d, fmt=%d)" HERE, in_w, in_h, in_f, out_w, out_h, out_f);
+	}
+
+	return lru->ctx;
+}
+
+const u8* vpost_sws_cache::alpha_plane(u32 size, u8 alpha)
+{
+	if (m_alpha.size() < size)
+	{
+		m_alpha.resize(size);
+		m_alpha_value = -1;
+	}
+
+	if (m_alpha_value != alpha)
+	{
+		std::memset(m_alpha.data(), alpha, m_alpha.size());
+		m_alpha_value = alpha;
+	}
+
+	return m_alpha.data();
+}
+
+// BT.601 limited range coefficients scaled by 2^13 (_mm_mulhrs_epi16 with inputs scaled by 2^7 gives results scaled by 2^5)
+static const s16 s_vpost_cy = 9535; // 1.164
+static const s16 s_vpost_crv = 13074; // 1.596
+static const s16 s_vpost_cgu = 3203; // 0.391
+static const s16 s_vpost_cgv = 6660; // 0.813
+static const s16 s_vpost_cbu = 16531; // 2.018
+
+void vpost_yuv420_to_rgba(u8* dst, u32 dst_pitch, const u8* y, u32 y_pitch, const u8* u, u32 u_pitch, const u8* v, u32 v_pitch, u32 width, u32 height, u8 alpha, bool argb)
+{
+	const __m128i cy = _mm_set1_epi16(s_vpost_cy);
+	const __m128i crv = _mm_set1_epi16(s_vpost_crv);
+	const __m128i cgu = _mm_set1_epi16(s_vpost_cgu);
+	const __m128i cgv = _mm_set1_epi16(s_vpost_cgv);
+	const __m128i cbu = _mm_set1_epi16(s_vpost_cbu);
+	const __m128i y_bias = _mm_set1_epi16(16);
+	const __m128i c_bias = _mm_set1_epi16(128);
+	const __m128i round = _mm_set1_epi16(16);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i va = _mm_set1_epi8(alpha);
+
+	// Same arithmetic as _mm_mulhrs_epi16
+	const auto mulhrs = [](s32 a, s32 b) -> s32
+	{
+		return (a * b + 0x4000) >> 15;
+	};
+
+	const auto clamp = [](s32 c) -> u8
+	{
+		return c < 0 ? 0 : c > 255 ? 255 : c;
+	};
+
+	for (u32 row = 0; row < height; row++)
+	{
+		const u8* const ys = y + row * y_pitch;
+		const u8* const us = u + row / 2 * u_pitch;
+		const u8* const vs = v + row / 2 * v_pitch;
+		u8* const out = dst + row * dst_pitch;
+
+		u32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + x));
+			const __m128i u_lo = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(us + x / 2));
+			const __m128i v_lo = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(vs + x / 2));
+
+			// Each chroma sample covers two pixels
+			const __m128i uu = _mm_unpacklo_epi8(u_lo, u_lo);
+			const __m128i vv = _mm_unpacklo_epi8(v_lo, v_lo);
+
+			__m128i r[2], g[2], b[2];
+
+			for (u32 i = 0; i < 2; i++)
+			{
+				const __m128i yw = i ? _mm_unpackhi_epi8(y8, zero) : _mm_unpacklo_epi8(y8, zero);
+				const __m128i uw = i ? _mm_unpackhi_epi8(uu, zero) : _mm_unpacklo_epi8(uu, zero);
+				const __m128i vw = i ? _mm_unpackhi_epi8(vv, zero) : _mm_unpacklo_epi8(vv, zero);
+
+				const __m128i yc = _mm_mulhrs_epi16(_mm_slli_epi16(_mm_sub_epi16(yw, y_bias), 7), cy);
+				const __m128i uc = _mm_slli_epi16(_mm_sub_epi16(uw, c_bias), 7);
+				const __m128i vc = _mm_slli_epi16(_mm_sub_epi16(vw, c_bias), 7);
+
+				r[i] = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(yc, _mm_mulhrs_epi16(vc, crv)), round), 5);
+				g[i] = _mm_srai_epi16(_mm_add_epi16(_mm_sub_epi16(_mm_sub_epi16(yc, _mm_mulhrs_epi16(uc, cgu)), _mm_mulhrs_epi16(vc, cgv)), round), 5);
+				b[i] = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(yc, _mm_mulhrs_epi16(uc, cbu)), round), 5);
+			}
+
+			const __m128i r8 = _mm_packus_epi16(r[0], r[1]);
+			const __m128i g8 = _mm_packus_epi16(g[0], g[1]);
+			const __m128i b8 = _mm_packus_epi16(b[0], b[1]);
+
+			// Interleave (RG, BA) or (AR, GB) byte pairs, then pixels
+			const __m128i p0 = argb ? va : r8;
+			const __m128i p1 = argb ? r8 : g8;
+			const __m128i p2 = argb ? g8 : b8;
+			const __m128i p3 = argb ? b8 : va;
+
+			const __m128i lo0 = _mm_unpacklo_epi8(p0, p1);
+			const __m128i hi0 = _mm_unpackhi_epi8(p0, p1);
+			const __m128i lo1 = _mm_unpacklo_epi8(p2, p3);
+			const __m128i hi1 = _mm_unpackhi_epi8(p2, p3);
+
+			__m128i* const o = reinterpret_cast<__m128i*>(out + x * 4);
+			_mm_storeu_si128(o + 0, _mm_unpacklo_epi16(lo0, lo1));
+			_mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo0, lo1));
+			_mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi0, hi1));
+			_mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi0, hi1));
+		}
+
+		for (; x < width; x++)
+		{
+			const s32 yc = mulhrs((ys[x] - 16) << 7, s_vpost_cy);
+			const s32 uc = (us[x / 2] - 128) << 7;
+			const s32 vc = (vs[x / 2] - 128) << 7;
+
+			const u8 r8 = clamp((yc + mulhrs(vc, s_vpost_crv) + 16) >> 5);
+			const u8 g8 = clamp((yc - mulhrs(uc, s_vpost_cgu) - mulhrs(vc, s_vpost_cgv) + 16) >> 5);
+			const u8 b8 = clamp((yc + mulhrs(uc, s_vpost_cbu) + 16) >> 5);
+
+			u8* const o = out + x * 4;
+
+			if (argb)
+			{
+				o[0] = alpha, o[1] = r8, o[2] = g8, o[3] = b8;
+			}
+			else
+			{
+				o[0] = r8, o[1] = g8, o[2] = b8, o[3] = alpha;
+			}
+		}
+	}
+}
+
 s32 cellVpostQueryAttr(vm::cptr<CellVpostCfgParam> cfgParam, vm::ptr<CellVpostAttr> attr)
 {
 	cellVpost.warning("cellVpostQueryAttr(cfgParam=*0x%x, attr=*0x%x)", cfgParam, attr);
@@ -113,26 +281,24 @@ s32 cellVpostExec(u32 handle, vm::cptr<u8> inPicBuff, vm::cptr<CellVpostCtrlPara
 	picInfo->reserved1 = 0;
 	picInfo->reserved2 = 0;
 
-	//u64 stamp0 = get_system_time();
-	std::unique_ptr<u8[]> pA(new u8[w*h]);
-
-	memset(pA.get(), ctrlParam->outAlpha, w*h);
-
-	//u64 stamp1 = get_system_time();
+	if (ow == static_cast<u32>(w) && oh == h && !(w & 1) && !(h & 1))
+	{
+		// Unscaled conversion directly into the output buffer
+		vpost_yuv420_to_rgba(outPicBuff.get_ptr(), ow * 4, &inPicBuff[0], w, &inPicBuff[w * h], w / 2, &inPicBuff[w * h * 5 / 4], w / 2, w, h, ctrlParam->outAlpha, false);
+		return CELL_OK;
+	}
 
-	std::unique_ptr<SwsContext, void(*)(SwsContext*)> sws(sws_getContext(w, h, AV_PIX_FMT_YUVA420P, ow, oh, AV_PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL), sws_freeContext);
+	std::lock_guard<std::mutex> lock(vpost->sws.mutex);
 
-	//u64 stamp2 = get_system_time();
+	SwsContext* const sws = vpost->sws.get(w, h, AV_PIX_FMT_YUVA420P, ow, oh, AV_PIX_FMT_RGBA, SWS_BILINEAR);
 
-	const u8* in_data[4] = { &inPicBuff[0], &inPicBuff[w * h], &inPicBuff[w * h * 5 / 4], pA.get() };
+	const u8* in_data[4] = { &inPicBuff[0], &inPicBuff[w * h], &inPicBuff[w * h * 5 / 4], vpost->sws.alpha_plane(w * h, ctrlParam->outAlpha) };
 	int in_line[4] = { w, w/2, w/2, w };
 	u8* out_data[4] = { outPicBuff.get_ptr(), NULL, NULL, NULL };
 	int out_line[4] = { static_cast<int>(ow*4), 0, 0, 0 };
 
-	sws_scale(sws.get(), in_data, in_line, 0, h, out_data, out_line);
+	sws_scale(sws, in_data, in_line, 0, h, out_data, out_line);
 
-	//ConLog.Write("cellVpostExec() perf (access=%d, getContext=%d, scale=%d, finalize=%d)",
-		//stamp1 - stamp0, stamp2 - stamp1, stamp3 - stamp2, get_system_time() - stamp3);
 	return CELL_OK;
 }
 
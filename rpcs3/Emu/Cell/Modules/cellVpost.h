@@ -1,5 +1,9 @@
 #pragma once
 
+#include <mutex>
+#include <array>
+#include <vector>
+
 namespace vm { using namespace ps3; }
 
 // Error Codes
@@ -318,6 +322,46 @@ struct CellVpostPictureInfo
 	be_t<u32> reserved2;
 };
 
+struct SwsContext;
+
+// Small cache of swscale contexts keyed by conversion parameters (must be used under the mutex)
+class vpost_sws_cache
+{
+	struct entry
+	{
+		SwsContext* ctx;
+		s32 in_w, in_h, in_f;
+		s32 out_w, out_h, out_f;
+		s32 flags;
+		u64 used; // Last use stamp
+	};
+
+	std::array<entry, 4> m_entries{};
+	u64 m_stamp = 0;
+
+	// Constant alpha plane for YUVA input
+	std::vector<u8> m_alpha;
+	s32 m_alpha_value = -1;
+
+public:
+	std::mutex mutex;
+
+	vpost_sws_cache() = default;
+
+	vpost_sws_cache(const vpost_sws_cache&) = delete;
+
+	~vpost_sws_cache();
+
+	// Get existing context or replace the least recently used one (formats are AVPixelFormat values)
+	SwsContext* get(s32 in_w, s32 in_h, s32 in_f, s32 out_w, s32 out_h, s32 out_f, s32 flags);
+
+	// Get plane of specified size filled with alpha value
+	const u8* alpha_plane(u32 size, u8 alpha);
+};
+
+// Convert YUV420 planar picture to interleaved RGBA (or ARGB) with constant alpha (BT.601, limited range, no scaling)
+void vpost_yuv420_to_rgba(u8* dst, u32 dst_pitch, const u8* y, u32 y_pitch, const u8* u, u32 u_pitch, const u8* v, u32 v_pitch, u32 width, u32 height, u8 alpha, bool argb);
+
 class VpostInstance
 {
 public:
@@ -327,6 +371,8 @@ public:
 
 	const bool to_rgba;
 
+	vpost_sws_cache sws;
+
 	VpostInstance(bool rgba)
 		: to_rgba(rgba)
 	{
@@ -170,6 +170,7 @@ namespace sys_net
 			thread_ctrl::atexit([addr = g_tls_net_data.addr()]
 			{
 				vm::dealloc_verbose_nothrow(addr, vm::main);
+				g_tls_net_data.set(0);
 			});
 		}
 	}
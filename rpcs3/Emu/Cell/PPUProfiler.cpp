@@ -0,0 +1,304 @@
+#include "stdafx.h"
+#include "Emu/Memory/Memory.h"
+#include "Emu/System.h"
+#include "Emu/IdManager.h"
+#include "PPUThread.h"
+#include "PPUFunction.h"
+#include "PPUAnalyser.h"
+#include "PPUProfiler.h"
+
+#include <algorithm>
+
+extern std::vector<std::string> g_ppu_function_names;
+
+// Get HLE function index by the stub address (0 if not HLE)
+static u32 ppu_get_hle_index(u32 addr)
+{
+	if (addr >= ppu_function_manager::addr && addr - ppu_function_manager::addr < g_ppu_function_names.size() * 8)
+	{
+		return (addr - ppu_function_manager::addr) / 8;
+	}
+
+	return 0;
+}
+
+void ppu_symbol_table::add_module(const ppu_module& info)
+{
+	writer_lock lock(m_mutex);
+
+	for (const auto& func : info.funcs)
+	{
+		auto& sym = m_symbols[func.addr];
+		sym.size = func.size;
+
+		if (func.name.empty())
+		{
+			sym.name = fmt::format("sub_%x", func.addr);
+		}
+		else
+		{
+			sym.name = func.name;
+		}
+
+		if (!info.name.empty())
+		{
+			sym.name = info.name + ':' + sym.name;
+		}
+	}
+}
+
+u32 ppu_symbol_table::find(u32 addr) const
+{
+	if (const u32 index = ppu_get_hle_index(addr))
+	{
+		return ppu_function_manager::addr + index * 8;
+	}
+
+	reader_lock lock(m_mutex);
+
+	auto found = m_symbols.upper_bound(addr);
+
+	if (found == m_symbols.begin())
+	{
+		return addr;
+	}
+
+	found--;
+
+	// Functions of unknown size extend to the next symbol
+	if (found->second.size && addr - found->first >= found->second.size)
+	{
+		return addr;
+	}
+
+	return found->first;
+}
+
+std::string ppu_symbol_table::get_name(u32 addr) const
+{
+	if (const u32 index = ppu_get_hle_index(addr))
+	{
+		return "HLE:" + g_ppu_function_names[index];
+	}
+
+	reader_lock lock(m_mutex);
+
+	const auto found = m_symbols.find(addr);
+
+	if (found == m_symbols.end())
+	{
+		return fmt::format("sub_%x", addr);
+	}
+
+	return found->second.name;
+}
+
+ppu_profiler::ppu_profiler(u32 interval)
+{
+	thread_ctrl::spawn(m_thread, "PPU Profiler", [this, interval]
+	{
+		task(interval);
+	});
+}
+
+ppu_profiler::~ppu_profiler()
+{
+	m_quit = true;
+	m_thread->notify();
+	m_thread->join();
+}
+
+void ppu_profiler::task(u32 interval)
+{
+	while (!m_quit && !Emu.IsStopped())
+	{
+		thread_ctrl::wait_for(interval);
+
+		if (m_quit || !Emu.IsRunning())
+		{
+			continue;
+		}
+
+		sample();
+	}
+}
+
+void ppu_profiler::sample()
+{
+	const auto table = fxm::get_always<ppu_symbol_table>();
+
+	// Guest memory reader (only the stack of the thread is accessed)
+	const auto read_stack = [](u32 addr, u32 low, u32 high, u32& out)
+	{
+		if (addr < low || addr > high - 8 || addr % 8 || !vm::check_addr(addr, 8))
+		{
+			return false;
+		}
+
+		out = static_cast<u32>(vm::ps3::read64(addr));
+		return true;
+	};
+
+	std::vector<std::pair<std::string, std::vector<u32>>> samples;
+
+	idm::select<ppu_thread>([&](u32, ppu_thread& ppu)
+	{
+		if (test(ppu.state, cpu_state_pause + cpu_flag::stop + cpu_flag::exit))
+		{
+			return;
+		}
+
+		// Registers of the running thread are read without synchronization
+		const u32 cia = ppu.cia;
+		const u32 lr = static_cast<u32>(ppu.lr);
+		const u32 low = ppu.stack_addr;
+		const u32 high = ppu.stack_addr + ppu.stack_size;
+
+		// Leaf first
+		std::vector<u32> stack;
+		stack.reserve(16);
+		stack.push_back(table->find(cia));
+
+		if (lr >= 4)
+		{
+			stack.push_back(table->find(lr - 4));
+		}
+
+		// Follow the back chain, return addresses are saved at +16 in the caller's frame
+		const u32 top = static_cast<u32>(ppu.gpr[1]);
+		u32 sp = top;
+
+		for (u32 next, ret; stack.size() < max_depth && read_stack(sp, low, high, next) && next > sp && read_stack(next + 16, low, high, ret); sp = next)
+		{
+			// The first one is usually the LR value
+			if (ret < 4 || (sp == top && ret == lr))
+			{
+				continue;
+			}
+
+			stack.push_back(table->find(ret - 4));
+		}
+
+		std::reverse(stack.begin(), stack.end());
+		samples.emplace_back(ppu.get_name(), std::move(stack));
+	});
+
+	writer_lock lock(m_mutex);
+
+	for (auto& s : samples)
+	{
+		m_stacks[s.first][std::move(s.second)]++;
+		m_samples++;
+	}
+}
+
+bool ppu_profiler::save(const std::string& path) const
+{
+	const auto table = fxm::get_always<ppu_symbol_table>();
+
+	fs::file file(path, fs::rewrite);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	reader_lock lock(m_mutex);
+
+	std::string line;
+
+	for (const auto& thread : m_stacks)
+	{
+		for (const auto& stack : thread.second)
+		{
+			line = thread.first;
+
+			for (u32 addr : stack.first)
+			{
+				line += ';';
+				line += table->get_name(addr);
+			}
+
+			line += fmt::format(" %llu\n", stack.second);
+			file.write(line);
+		}
+	}
+
+	return true;
+}
+
+void ppu_profiler::report(u32 count) const
+{
+	const auto table = fxm::get_always<ppu_symbol_table>();
+
+	std::map<u32, u64> self;
+
+	{
+		reader_lock lock(m_mutex);
+
+		for (const auto& thread : m_stacks)
+		{
+			for (const auto& stack : thread.second)
+			{
+				self[stack.first.back()] += stack.second;
+			}
+		}
+	}
+
+	std::vector<std::pair<u64, u32>> top;
+
+	for (const auto& func : self)
+	{
+		top.emplace_back(func.second, func.first);
+	}
+
+	std::sort(top.rbegin(), top.rend());
+
+	const u64 total = m_samples;
+
+	LOG_NOTICE(PPU, "PPU Profiler: %llu samples", total);
+
+	for (u32 i = 0; i < count && i < top.size(); i++)
+	{
+		LOG_NOTICE(PPU, "PPU Profiler: %5.1f%% (%llu) %s (0x%x)", top[i].first * 100. / total, top[i].first, table->get_name(top[i].second), top[i].second);
+	}
+}
+
+void ppu_profiler::start()
+{
+	if (Emu.IsStopped() || fxm::check<ppu_profiler>())
+	{
+		return;
+	}
+
+	const u32 interval = g_cfg.core.ppu_profiler_interval;
+
+	if (fxm::make<ppu_profiler>(interval))
+	{
+		LOG_SUCCESS(PPU, "PPU Profiler started (interval: %u us)", interval);
+	}
+}
+
+void ppu_profiler::stop()
+{
+	if (const auto profiler = fxm::withdraw<ppu_profiler>())
+	{
+		profiler->report(20);
+
+		const std::string path = fmt::format("%sppu_profile_%s.txt", fs::get_config_dir(), Emu.GetTitleID().empty() ? "unknown" : Emu.GetTitleID());
+
+		if (profiler->save(path))
+		{
+			LOG_SUCCESS(PPU, "PPU Profiler: collapsed stacks saved to %s", path);
+		}
+		else
+		{
+			LOG_ERROR(PPU, "PPU Profiler: failed to save %s (%s)", path, fs::g_tls_error);
+		}
+	}
+}
+
+bool ppu_profiler::is_active()
+{
+	return fxm::check<ppu_profiler>() != nullptr;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Utilities/types.h"
+#include "Utilities/Atomic.h"
+#include "Utilities/mutex.h"
+#include "Utilities/Thread.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ppu_module;
+
+// Guest function symbols used by the PPU profiler (filled by ppu_initialize)
+class ppu_symbol_table final
+{
+	mutable shared_mutex m_mutex;
+
+	struct symbol
+	{
+		u32 size;
+		std::string name;
+	};
+
+	// Function address -> symbol
+	std::map<u32, symbol> m_symbols;
+
+public:
+	void add_module(const ppu_module& info);
+
+	// Get function start address (HLE function stub, or the address itself if unknown)
+	u32 find(u32 addr) const;
+
+	// Get function name ("module:name", "sub_{addr}" if unknown)
+	std::string get_name(u32 addr) const;
+};
+
+// Guest-level PPU sampling profiler (see "PPU Profiler" option and the debugger).
+// Samples cia and the LR/stack back chain of every running PPU thread, aggregated per guest function.
+class ppu_profiler final
+{
+	atomic_t<bool> m_quit{false};
+
+	std::shared_ptr<thread_ctrl> m_thread;
+
+	mutable shared_mutex m_mutex;
+
+	// Thread name -> function call stack (root first) -> sample count
+	std::map<std::string, std::map<std::vector<u32>, u64>> m_stacks;
+
+	atomic_t<u64> m_samples{0};
+
+	void sample();
+
+	void task(u32 interval);
+
+public:
+	static constexpr u32 max_depth = 64;
+
+	ppu_profiler(u32 interval);
+
+	~ppu_profiler();
+
+	u64 get_samples() const
+	{
+		return m_samples;
+	}
+
+	// Write samples in collapsed stack format (for flame graph tools), returns false on error
+	bool save(const std::string& path) const;
+
+	// Log top functions by self samples
+	void report(u32 count) const;
+
+	// Start profiling (does nothing if already active)
+	static void start();
+
+	// Stop profiling, log the summary and save the profile to the default location
+	static void stop();
+
+	static bool is_active();
+};
@@ -1,12 +1,15 @@
 #include "stdafx.h"
 #include "Utilities/VirtualMemory.h"
+#include "Utilities/perf_jit.h"
 #include "Crypto/sha1.h"
 #include "Emu/Memory/Memory.h"
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
+#include "Emu/CPU/CPUPlacement.h"
 #include "PPUThread.h"
 #include "PPUInterpreter.h"
 #include "PPUAnalyser.h"
+#include "PPUProfiler.h"
 #include "PPUModule.h"
 #include "lv2/sys_sync.h"
 #include "lv2/sys_prx.h"
@@ -271,6 +274,11 @@ extern void ppu_breakpoint(u32 addr)
 	}
 }
 
+void ppu_thread::on_spawn()
+{
+	thread_placement::apply(thread_class::ppu, get_name());
+}
+
 void ppu_thread::on_init(const std::shared_ptr<void>& _this)
 {
 	if (!stack_addr)
@@ -819,19 +827,19 @@ extern bool ppu_stwcx(ppu_thread& ppu, u32 addr, u32 reg_value)
 {
 	atomic_be_t<u32>& data = vm::_ref<atomic_be_t<u32>>(addr);
 
-	if (ppu.raddr != addr || ppu.rdata != data.load())
+	// Lock only the reservation line (fails if the reservation was lost)
+	if (ppu.raddr != addr || ppu.rdata != data.load() || !vm::reservation_trylock(addr, ppu.rtime))
 	{
 		ppu.raddr = 0;
 		return false;
 	}
 
-	vm::writer_lock lock(0);
+	const bool result = data.compare_and_swap_test(static_cast<u32>(ppu.rdata), reg_value);
+
+	vm::reservation_unlock(addr, ppu.rtime, result);
 
-	const bool result = ppu.rtime == vm::reservation_acquire(addr, sizeof(u32)) && data.compare_and_swap_test(static_cast<u32>(ppu.rdata), reg_value);
-	
 	if (result)
 	{
-		vm::reservation_update(addr, sizeof(u32));
 		vm::notify(addr, sizeof(u32));
 	}
 
@@ -843,19 +851,19 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 {
 	atomic_be_t<u64>& data = vm::_ref<atomic_be_t<u64>>(addr);
 
-	if (ppu.raddr != addr || ppu.rdata != data.load())
+	// Lock only the reservation line (fails if the reservation was lost)
+	if (ppu.raddr != addr || ppu.rdata != data.load() || !vm::reservation_trylock(addr, ppu.rtime))
 	{
 		ppu.raddr = 0;
 		return false;
 	}
 
-	vm::writer_lock lock(0);
+	const bool result = data.compare_and_swap_test(ppu.rdata, reg_value);
 
-	const bool result = ppu.rtime == vm::reservation_acquire(addr, sizeof(u64)) && data.compare_and_swap_test(ppu.rdata, reg_value);
+	vm::reservation_unlock(addr, ppu.rtime, result);
 
 	if (result)
 	{
-		vm::reservation_update(addr, sizeof(u64));
 		vm::notify(addr, sizeof(u64));
 	}
 
@@ -1037,6 +1045,8 @@ extern void ppu_initialize()
 
 extern void ppu_initialize(const ppu_module& info)
 {
+	fxm::get_always<ppu_symbol_table>()->add_module(info);
+
 	if (g_cfg.core.ppu_decoder != ppu_decoder_type::llvm)
 	{
 		// Temporarily
@@ -1135,6 +1145,16 @@ extern void ppu_initialize(const ppu_module& info)
 				entry.size = block.second;
 				entry.toc  = func.toc;
 				fmt::append(entry.name, "__0x%x", block.first);
+
+#ifdef LLVM_AVAILABLE
+				if (utils::perf_jit_enabled())
+				{
+					// Guest function and block address for host profilers
+					const auto name = fxm::get_always<ppu_symbol_table>()->get_name(func.addr);
+					jit_compiler::set_name(entry.name, block.first == func.addr ? fmt::format("PPU 0x%x %s", block.first, name) : fmt::format("PPU 0x%x %s+0x%x", block.first, name, block.first - func.addr));
+				}
+#endif
+
 				part.funcs.emplace_back(std::move(entry));
 			}
 
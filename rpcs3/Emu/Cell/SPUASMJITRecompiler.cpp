@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "Emu/Memory/Memory.h"
 #include "Emu/System.h"
+#include "Utilities/perf_jit.h"
 
 #include "SPUDisAsm.h"
 #include "SPUThread.h"
@@ -23,6 +24,8 @@
 const spu_decoder<spu_interpreter_fast> s_spu_interpreter; // TODO: remove
 const spu_decoder<spu_recompiler> s_spu_decoder;
 
+extern const spu_decoder<spu_itype> s_spu_itype;
+
 spu_recompiler::spu_recompiler()
 	: m_jit(std::make_shared<asmjit::JitRuntime>())
 {
@@ -125,6 +128,29 @@ void spu_recompiler::compile(spu_function_t& f)
 		pos_labels[addr / 4] = compiler.newLabel();
 	}
 
+	// Find loop headers (block entries targeted by backward branches) for the statistics
+	std::set<u32> loop_headers;
+
+	if (g_cfg.core.spu_stats)
+	{
+		for (u32 i = 0; i < f.data.size(); i++)
+		{
+			const u32 pos = f.addr + i * 4;
+			const spu_opcode_t op{f.data[i]};
+			const auto type = s_spu_itype.decode(op.opcode);
+
+			if (type == spu_itype::BR || type == spu_itype::BRA || type == spu_itype::BRZ || type == spu_itype::BRNZ || type == spu_itype::BRHZ || type == spu_itype::BRHNZ)
+			{
+				const u32 target = spu_branch_target(type == spu_itype::BRA ? 0 : pos, op.i16);
+
+				if (target >= f.addr && target <= pos && f.blocks.count(target))
+				{
+					loop_headers.emplace(target);
+				}
+			}
+		}
+	}
+
 	// Register label for post-the-end address
 	pos_labels[(f.addr + f.size) / 4 % 0x10000] = compiler.newLabel();
 
@@ -158,6 +184,12 @@ void spu_recompiler::compile(spu_function_t& f)
 			{
 				compiler.comment("Block:");
 			}
+
+			if (loop_headers.count(m_pos))
+			{
+				// Count loop iterations (collected by spu_recompiler_base::enter)
+				compiler.add(SPU_OFF_64(stat_loops), 1);
+			}
 		}
 
 		if (g_cfg.core.spu_debug)
@@ -236,6 +268,11 @@ void spu_recompiler::compile(spu_function_t& f)
 	m_jit->add(&fn, codeHolder);
 
 	f.compiled = asmjit::Internal::ptr_cast<decltype(f.compiled)>(fn);
+
+	if (utils::perf_jit_enabled())
+	{
+		utils::perf_jit_announce(reinterpret_cast<const void*>(fn), codeHolder->getCodeSize(), fmt::format("SPU 0x%05x-0x%05x", f.addr, f.addr + f.size));
+	}
 	
 	if (g_cfg.core.spu_debug)
 	{
@@ -7,6 +7,7 @@
 
 #include <cmath>
 #include <cfenv>
+#include <chrono>
 
 // Compare 16 packed unsigned bytes (greater than)
 inline __m128i sse_cmpgt_epu8(__m128i A, __m128i B)
@@ -28,6 +29,12 @@ inline __m128i sse_cmpgt_epu32(__m128i A, __m128i B)
 	return _mm_cmpgt_epi32(_mm_xor_si128(A, sign), _mm_xor_si128(B, sign));
 }
 
+// Timestamp for the channel blocking time statistics (ns)
+static inline u64 get_stall_stamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void spu_interpreter::UNK(SPUThread& spu, spu_opcode_t op)
 {
 	fmt::throw_exception("Unknown/Illegal instruction (0x%08x)" HERE, op.opcode);
@@ -91,7 +98,15 @@ void spu_interpreter::RDCH(SPUThread& spu, spu_opcode_t op)
 {
 	u32 result;
 
-	if (!spu.get_ch_value(op.ra, result))
+	const u64 stamp = spu.stats ? get_stall_stamp() : 0;
+	const bool ok = spu.get_ch_value(op.ra, result);
+
+	if (stamp)
+	{
+		spu.stat_stall += get_stall_stamp() - stamp;
+	}
+
+	if (!ok)
 	{
 		spu.pc -= 4;
 	}
@@ -315,7 +330,15 @@ void spu_interpreter::MTSPR(SPUThread& spu, spu_opcode_t op)
 
 void spu_interpreter::WRCH(SPUThread& spu, spu_opcode_t op)
 {
-	if (!spu.set_ch_value(op.ra, spu.gpr[op.rt]._u32[3]))
+	const u64 stamp = spu.stats ? get_stall_stamp() : 0;
+	const bool ok = spu.set_ch_value(op.ra, spu.gpr[op.rt]._u32[3]);
+
+	if (stamp)
+	{
+		spu.stat_stall += get_stall_stamp() - stamp;
+	}
+
+	if (!ok)
 	{
 		spu.pc -= 4;
 	}
@@ -1,11 +1,14 @@
 #include "stdafx.h"
 #include "Emu/IdManager.h"
 #include "Emu/Memory/Memory.h"
+#include "Emu/System.h"
 
 #include "SPUThread.h"
 #include "SPURecompiler.h"
 #include "SPUASMJITRecompiler.h"
 
+#include <algorithm>
+
 extern u64 get_system_time();
 
 spu_recompiler_base::~spu_recompiler_base()
@@ -44,8 +47,33 @@ void spu_recompiler_base::enter(SPUThread& spu)
 		if (!func->compiled) fmt::throw_exception("Compilation failed" HERE);
 	}
 
+	// Counters of the caller (statistics are exclusive)
+	u64 loops = 0, stall = 0, dma = 0;
+
+	if (spu.stats)
+	{
+		loops = std::exchange(spu.stat_loops, 0);
+		stall = std::exchange(spu.stat_stall, 0);
+		dma = spu.stat_dma.exchange(0);
+	}
+
 	const u32 res = func->compiled(&spu, _ls);
 
+	if (spu.stats)
+	{
+		auto& stats = spu.stats_cache[func.get()];
+
+		if (!stats)
+		{
+			stats = &spu.stats->get(*func);
+		}
+
+		stats->calls++;
+		stats->loops += std::exchange(spu.stat_loops, loops);
+		stats->stall += std::exchange(spu.stat_stall, stall);
+		stats->dma += spu.stat_dma.exchange(dma);
+	}
+
 	if (const auto exception = spu.pending_exception)
 	{
 		spu.pending_exception = nullptr;
@@ -83,3 +111,89 @@ void spu_recompiler_base::enter(SPUThread& spu)
 		spu.srr0 = std::exchange(spu.pc, 0);
 	}
 }
+
+spu_function_stats& spu_image_stats::get(const spu_function_t& func)
+{
+	writer_lock lock(m_mutex);
+
+	return m_funcs.emplace(std::piecewise_construct, std::forward_as_tuple(&func), std::forward_as_tuple(func.addr, func.size)).first->second;
+}
+
+std::string spu_image_stats::format(u32 count) const
+{
+	std::vector<const spu_function_stats*> funcs;
+
+	reader_lock lock(m_mutex);
+
+	for (const auto& pair : m_funcs)
+	{
+		funcs.emplace_back(&pair.second);
+	}
+
+	std::sort(funcs.begin(), funcs.end(), [](const spu_function_stats* a, const spu_function_stats* b)
+	{
+		const u64 a_stall = a->stall, b_stall = b->stall;
+		return a_stall != b_stall ? a_stall > b_stall : a->loops.load() > b->loops.load();
+	});
+
+	if (count && funcs.size() > count)
+	{
+		funcs.resize(count);
+	}
+
+	std::string result;
+
+	for (const auto f : funcs)
+	{
+		fmt::append(result, "[0x%05x, size 0x%05x] entries: %llu, loops: %llu, channel stall: %llu us, DMA: %llu KB\n", f->addr, f->size, f->calls.load(), f->loops.load(), f->stall / 1000, f->dma / 1024);
+	}
+
+	return result;
+}
+
+std::shared_ptr<spu_image_stats> spu_statistics::get_image(const std::string& name)
+{
+	const auto _this = fxm::get_always<spu_statistics>();
+
+	std::lock_guard<std::mutex> lock(_this->m_mutex);
+
+	auto& image = _this->m_images[name];
+
+	if (!image)
+	{
+		image = std::make_shared<spu_image_stats>(name);
+	}
+
+	return image;
+}
+
+void spu_statistics::save()
+{
+	const auto _this = fxm::check<spu_statistics>();
+
+	if (!_this)
+	{
+		return;
+	}
+
+	std::string log;
+
+	std::lock_guard<std::mutex> lock(_this->m_mutex);
+
+	for (const auto& image : _this->m_images)
+	{
+		fmt::append(log, "========== SPU IMAGE '%s' ==========\n\n%s\n\n", image.first, image.second->format(0));
+	}
+
+	const std::string path = Emu.GetCachePath() + "SPUStats.log";
+
+	if (fs::file file{path, fs::rewrite})
+	{
+		file.write(log);
+		LOG_SUCCESS(SPU, "SPU statistics of %u image(s) saved to %s", _this->m_images.size(), path);
+	}
+	else
+	{
+		LOG_ERROR(SPU, "Failed to save SPU statistics to %s (%s)", path, fs::g_tls_error);
+	}
+}
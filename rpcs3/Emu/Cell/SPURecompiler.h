@@ -1,8 +1,15 @@
 #pragma once
 
 #include "SPUAnalyser.h"
+#include "Utilities/Atomic.h"
+#include "Utilities/mutex.h"
 
+#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 // SPU Recompiler instance base (must be global or PS3 process-local)
 class spu_recompiler_base
@@ -23,3 +30,59 @@ public:
 	// Run
 	static void enter(class SPUThread&);
 };
+
+// Execution statistics of an SPU function (see "SPU Statistics" option)
+struct spu_function_stats
+{
+	u32 addr;
+	u32 size;
+
+	atomic_t<u64> calls{0}; // Function entries
+	atomic_t<u64> loops{0}; // Loop iterations (loop header executions)
+	atomic_t<u64> stall{0}; // Channel blocking time (ns)
+	atomic_t<u64> dma{0}; // DMA bytes transferred
+
+	spu_function_stats(u32 addr, u32 size)
+		: addr(addr)
+		, size(size)
+	{
+	}
+};
+
+// Statistics of SPU functions run by one SPU image (identified by the thread group name)
+class spu_image_stats final
+{
+	mutable shared_mutex m_mutex;
+
+	// Elements are never removed (stable references)
+	std::unordered_map<const spu_function_t*, spu_function_stats> m_funcs;
+
+public:
+	const std::string name;
+
+	spu_image_stats(const std::string& name)
+		: name(name)
+	{
+	}
+
+	// Get function statistics (created if necessary)
+	spu_function_stats& get(const spu_function_t& func);
+
+	// Format function statistics sorted by the channel blocking time and the amount of loop iterations (0: all functions)
+	std::string format(u32 count) const;
+};
+
+// SPU statistics of all images (fxm object)
+class spu_statistics final
+{
+	std::mutex m_mutex;
+
+	std::map<std::string, std::shared_ptr<spu_image_stats>> m_images;
+
+public:
+	// Get image statistics by name (created if necessary)
+	static std::shared_ptr<spu_image_stats> get_image(const std::string& name);
+
+	// Write statistics of all images to SPUStats.log in the cache directory
+	static void save();
+};
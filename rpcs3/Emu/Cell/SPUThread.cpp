@@ -4,6 +4,7 @@
 #include "Emu/System.h"
 
 #include "Emu/IdManager.h"
+#include "Emu/CPU/CPUPlacement.h"
 #include "Emu/Cell/PPUThread.h"
 #include "Emu/Cell/ErrorCodes.h"
 #include "Emu/Cell/lv2/sys_spu.h"
@@ -138,7 +139,12 @@ spu_imm_table_t::spu_imm_table_t()
 
 void SPUThread::on_spawn()
 {
-	if (g_cfg.core.bind_spu_cores)
+	if (g_cfg.core.thread_placement != thread_placement_policy::disabled)
+	{
+		// SPU threads of the same group are kept together
+		thread_placement::apply(thread_class::spu, get_name(), reinterpret_cast<u64>(group));
+	}
+	else if (g_cfg.core.bind_spu_cores)
 	{
 		//Get next secondary core number
 		auto core_count = std::thread::hardware_concurrency();
@@ -147,13 +153,28 @@ void SPUThread::on_spawn()
 			auto half_count = core_count / 2;
 			auto assigned_secondary_core = ((g_num_spu_threads % half_count) * 2) + 1;
 
-			set_ideal_processor_core(assigned_secondary_core);
+			const int prev_core = set_ideal_processor_core(assigned_secondary_core);
+
+			// Host threads are reused
+			if (prev_core >= 0)
+			{
+				thread_ctrl::atexit([this, prev_core]
+				{
+					set_ideal_processor_core(prev_core);
+				});
+			}
 		}
 	}
 
 	if (g_cfg.core.lower_spu_priority)
 	{
 		set_native_priority(-1);
+
+		// Host threads are reused
+		thread_ctrl::atexit([this]
+		{
+			set_native_priority(0);
+		});
 	}
 
 	g_num_spu_threads++;
@@ -178,6 +199,24 @@ std::string SPUThread::dump() const
 {
 	std::string&& ret = cpu_thread::dump();
 	ret += fmt::format("\n" "Tag mask: 0x%08x\n" "MFC entries: %u\n", +ch_tag_mask, mfc_queue.size());
+
+	const auto dump_wait = [&](const char* name, const adaptive_wait& waiter)
+	{
+		const auto stats = waiter.get_stats();
+		ret += fmt::format("%s waits: spin %llu, parked %llu, spin limit %u ns\n", name, stats.spin_ok, stats.parked, waiter.get_limit());
+	};
+
+	dump_wait("In_MBox", ch_in_mbox_wait);
+	dump_wait("Tag status", ch_tag_wait);
+	dump_wait("Atomic status", ch_atomic_wait);
+	dump_wait("SNR1", ch_snr1_wait);
+	dump_wait("SNR2", ch_snr2_wait);
+
+	if (stats)
+	{
+		ret += fmt::format("Hot functions of '%s':\n%s", stats->name, stats->format(8));
+	}
+
 	ret += "Registers:\n=========\n";
 
 	for (uint i = 0; i<128; ++i) ret += fmt::format("GPR[%d] = %s\n", i, gpr[i]);
@@ -288,6 +327,10 @@ SPUThread::SPUThread(const std::string& name)
 	, offset(0)
 	, group(nullptr)
 {
+	if (g_cfg.core.spu_stats && g_cfg.core.spu_decoder == spu_decoder_type::asmjit)
+	{
+		stats = spu_statistics::get_image(name);
+	}
 }
 
 SPUThread::SPUThread(const std::string& name, u32 index, lv2_spu_group* group)
@@ -297,6 +340,10 @@ SPUThread::SPUThread(const std::string& name, u32 index, lv2_spu_group* group)
 	, offset(0)
 	, group(group)
 {
+	if (g_cfg.core.spu_stats && g_cfg.core.spu_decoder == spu_decoder_type::asmjit)
+	{
+		stats = spu_statistics::get_image(group->name);
+	}
 }
 
 void SPUThread::push_snr(u32 number, u32 value)
@@ -317,6 +364,11 @@ void SPUThread::push_snr(u32 number, u32 value)
 
 void SPUThread::do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc)
 {
+	if (stats)
+	{
+		stat_dma += args.size;
+	}
+
 	const bool is_get = (args.cmd & ~(MFC_BARRIER_MASK | MFC_FENCE_MASK)) == MFC_GET_CMD;
 
 	u32 eal = args.eal;
@@ -500,6 +552,12 @@ void SPUThread::process_mfc_cmd()
 		_mm_lfence();
 	}
 
+	if (stats && (ch_mfc_cmd.cmd == MFC_GETLLAR_CMD || ch_mfc_cmd.cmd == MFC_PUTLLC_CMD || ch_mfc_cmd.cmd == MFC_PUTLLUC_CMD))
+	{
+		// Atomic commands don't use do_dma_transfer
+		stat_dma += 128;
+	}
+
 	switch (ch_mfc_cmd.cmd)
 	{
 	case MFC_GETLLAR_CMD:
@@ -507,14 +565,14 @@ void SPUThread::process_mfc_cmd()
 		auto& data = vm::ps3::_ref<decltype(rdata)>(ch_mfc_cmd.eal);
 
 		const u32 _addr = ch_mfc_cmd.eal;
-		const u64 _time = vm::reservation_acquire(raddr, 128);
+		const u64 _time = vm::reservation_acquire(_addr, 128);
 
 		if (raddr && raddr != ch_mfc_cmd.eal)
 		{
 			ch_event_stat |= SPU_EVENT_LR;
 		}
 
-		const bool is_polling = false;// raddr == _addr && rtime == _time; // TODO
+		bool is_polling = false;// raddr == _addr && rtime == _time; // TODO
 
 		_mm_lfence();
 		raddr = _addr;
@@ -547,13 +605,15 @@ void SPUThread::process_mfc_cmd()
 			_mm_lfence();
 		}
 
-		// Hack: ensure no other atomic updates have happened during reading the data
-		if (is_polling || UNLIKELY(vm::reservation_acquire(raddr, 128) != rtime))
+		// Ensure no other atomic updates have happened during reading the data (seqlock)
+		while (is_polling || UNLIKELY(vm::reservation_acquire(raddr, 128) != rtime))
 		{
 			// TODO: vm::check_addr
-			vm::reader_lock lock;
+			is_polling = false;
 			rtime = vm::reservation_acquire(raddr, 128);
+			_mm_lfence();
 			rdata = data;
+			_mm_lfence();
 		}
 
 		// Copy to LS
@@ -570,17 +630,22 @@ void SPUThread::process_mfc_cmd()
 
 		bool result = false;
 
-		if (raddr == ch_mfc_cmd.eal && rtime == vm::reservation_acquire(raddr, 128) && rdata == data)
+		// Lock only the reservation line (other threads are not paused)
+		if (raddr == ch_mfc_cmd.eal && rdata == data && vm::reservation_trylock(raddr, rtime))
 		{
 			// TODO: vm::check_addr
-			vm::writer_lock lock;
+			// Other 128-byte writers are excluded by the line lock: compare and store as PUTLLUC does
+			result = rdata == data;
 
-			if (rtime == vm::reservation_acquire(raddr, 128) && rdata == data)
+			if (result)
 			{
 				data = to_write;
-				result = true;
+			}
 
-				vm::reservation_update(raddr, 128);
+			vm::reservation_unlock(raddr, rtime, result);
+
+			if (result)
+			{
 				vm::notify(raddr, 128);
 			}
 		}
@@ -613,13 +678,11 @@ void SPUThread::process_mfc_cmd()
 		auto& data = vm::ps3::_ref<decltype(rdata)>(ch_mfc_cmd.eal);
 		const auto to_write = _ref<decltype(rdata)>(ch_mfc_cmd.lsa & 0x3ffff);
 
-		vm::reservation_acquire(ch_mfc_cmd.eal, 128);
-
 		// Store unconditionally
 		// TODO: vm::check_addr
-		vm::writer_lock lock(0);
+		const u64 stamp = vm::reservation_lock(ch_mfc_cmd.eal, 128);
 		data = to_write;
-		vm::reservation_update(ch_mfc_cmd.eal, 128);
+		vm::reservation_unlock(ch_mfc_cmd.eal, stamp, true);
 		vm::notify(ch_mfc_cmd.eal, 128);
 
 		ch_atomic_stat.set_value(MFC_PUTLLUC_SUCCESS);
@@ -871,12 +934,9 @@ bool SPUThread::get_ch_value(u32 ch, u32& out)
 {
 	LOG_TRACE(SPU, "get_ch_value(ch=%d [%s])", ch, ch < 128 ? spu_ch_name[ch] : "???");
 
-	auto read_channel = [&](spu_channel_t& channel)
+	auto read_channel = [&](spu_channel_t& channel, adaptive_wait& waiter)
 	{
-		for (int i = 0; i < 10 && channel.get_count() == 0; i++)
-		{
-			busy_wait();
-		}
+		const u64 stamp = waiter.spin([&] { return channel.get_count() != 0; });
 
 		while (!channel.try_pop(out))
 		{
@@ -888,6 +948,7 @@ bool SPUThread::get_ch_value(u32 ch, u32& out)
 			thread_ctrl::wait();
 		}
 
+		waiter.parked(stamp);
 		return true;
 	};
 
@@ -900,13 +961,10 @@ bool SPUThread::get_ch_value(u32 ch, u32& out)
 	}
 	case SPU_RdInMbox:
 	{
+		const u64 stamp = ch_in_mbox_wait.spin([&] { return ch_in_mbox.get_count() != 0; });
+
 		while (true)
 		{
-			for (int i = 0; i < 10 && ch_in_mbox.get_count() == 0; i++)
-			{
-				busy_wait();
-			}
-
 			if (const uint old_count = ch_in_mbox.try_pop(out))
 			{
 				if (old_count == 4 /* SPU_IN_MBOX_THRESHOLD */) // TODO: check this
@@ -914,6 +972,7 @@ bool SPUThread::get_ch_value(u32 ch, u32& out)
 					int_ctrl[2].set(SPU_INT2_STAT_SPU_MAILBOX_THRESHOLD_INT);
 				}
 
+				ch_in_mbox_wait.parked(stamp);
 				return true;
 			}
 
@@ -928,7 +987,7 @@ bool SPUThread::get_ch_value(u32 ch, u32& out)
 
 	case MFC_RdTagStat:
 	{
-		return read_channel(ch_tag_stat);
+		return read_channel(ch_tag_stat, ch_tag_wait);
 	}
 
 	case MFC_RdTagMask:
@@ -939,22 +998,22 @@ bool SPUThread::get_ch_value(u32 ch, u32& out)
 
 	case SPU_RdSigNotify1:
 	{
-		return read_channel(ch_snr1);
+		return read_channel(ch_snr1, ch_snr1_wait);
 	}
 
 	case SPU_RdSigNotify2:
 	{
-		return read_channel(ch_snr2);
+		return read_channel(ch_snr2, ch_snr2_wait);
 	}
 
 	case MFC_RdAtomicStat:
 	{
-		return read_channel(ch_atomic_stat);
+		return read_channel(ch_atomic_stat, ch_atomic_wait);
 	}
 
 	case MFC_RdListStallStat:
 	{
-		return read_channel(ch_stall_stat);
+		return read_channel(ch_stall_stat, ch_stall_wait);
 	}
 
 	case SPU_RdDec:
@@ -8,6 +8,9 @@
 struct lv2_event_queue;
 struct lv2_spu_group;
 struct lv2_int_tag;
+struct spu_function_t;
+struct spu_function_stats;
+class spu_image_stats;
 
 // SPU Channels
 enum : u32
@@ -558,6 +561,14 @@ public:
 	spu_channel_t ch_snr1; // SPU Signal Notification Register 1
 	spu_channel_t ch_snr2; // SPU Signal Notification Register 2
 
+	// Adaptive waiting state of blocking channel reads
+	adaptive_wait ch_tag_wait;
+	adaptive_wait ch_stall_wait;
+	adaptive_wait ch_atomic_wait;
+	adaptive_wait ch_in_mbox_wait;
+	adaptive_wait ch_snr1_wait;
+	adaptive_wait ch_snr2_wait;
+
 	atomic_t<u32> ch_event_mask;
 	atomic_t<u32> ch_event_stat;
 
@@ -586,6 +597,13 @@ public:
 	std::shared_ptr<class spu_recompiler_base> spu_rec;
 	u32 recursion_level = 0;
 
+	// Execution statistics (see "SPU Statistics" option, counters of the current function are collected by spu_recompiler_base::enter)
+	std::shared_ptr<spu_image_stats> stats;
+	std::unordered_map<const spu_function_t*, spu_function_stats*> stats_cache;
+	u64 stat_loops = 0; // Loop iterations (incremented by the recompiled code)
+	u64 stat_stall = 0; // Channel blocking time (ns)
+	atomic_t<u64> stat_dma{0}; // DMA bytes (also updated by the MFC thread)
+
 	void push_snr(u32 number, u32 value);
 	void do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc = true);
 
@@ -235,6 +235,8 @@ error_code sys_cond_wait(ppu_thread& ppu, u32 cond_id, u64 timeout)
 		ppu.gpr[3] = CELL_OK;
 	}
 
+	const u64 stamp = cond->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -271,6 +273,8 @@ error_code sys_cond_wait(ppu_thread& ppu, u32 cond_id, u64 timeout)
 		}
 	}
 
+	cond->waiter.parked(stamp);
+
 	// Verify ownership
 	verify(HERE), cond->mutex->owner >> 1 == ppu.id;
 
@@ -265,6 +265,8 @@ error_code sys_event_queue_receive(ppu_thread& ppu, u32 equeue_id, vm::ptr<sys_e
 	// If cancelled, gpr[3] will be non-zero. Other registers must contain event data.
 	ppu.gpr[3] = 0;
 
+	const u64 stamp = queue->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -293,6 +295,8 @@ error_code sys_event_queue_receive(ppu_thread& ppu, u32 equeue_id, vm::ptr<sys_e
 		}
 	}
 
+	queue->waiter.parked(stamp);
+
 	return not_an_error(ppu.gpr[3]);
 }
 
@@ -150,6 +150,8 @@ error_code sys_event_flag_wait(ppu_thread& ppu, u32 id, u64 bitptn, u32 mode, vm
 		return CELL_OK;
 	}
 
+	const u64 stamp = flag->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -179,6 +181,8 @@ error_code sys_event_flag_wait(ppu_thread& ppu, u32 id, u64 bitptn, u32 mode, vm
 			thread_ctrl::wait();
 		}
 	}
+
+	flag->waiter.parked(stamp);
 	
 	ppu.test_state();
 	if (result) *result = ppu.gpr[6];
@@ -364,7 +368,7 @@ error_code sys_event_flag_get(u32 id, vm::ptr<u64> flags)
 		return CELL_EFAULT;
 	}
 
-	const auto flag = idm::check<lv2_obj, lv2_event_flag>(id, [](lv2_event_flag& flag)
+	const auto flag = idm::borrow<lv2_obj, lv2_event_flag>(id, [](lv2_event_flag& flag)
 	{
 		return +flag.pattern;
 	});
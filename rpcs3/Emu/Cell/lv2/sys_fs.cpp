@@ -3,6 +3,7 @@
 
 #include <mutex>
 
+#include "Emu/System.h"
 #include "Emu/Cell/PPUThread.h"
 #include "Crypto/unedat.h"
 #include "Emu/VFS.h"
@@ -64,6 +65,12 @@ lv2_fs_mount_point* lv2_fs_object::get_mp(const char* filename)
 
 u64 lv2_file::op_read(vm::ps3::ptr<void> buf, u64 size)
 {
+	// Memory-mapped file: read is a plain memory copy, so it can be done directly into guest memory
+	if (file.get_mapped_data())
+	{
+		return file.read(buf.get_ptr(), size);
+	}
+
 	// Copy data from intermediate buffer (avoid passing vm pointer to a native API)
 	std::unique_ptr<u8[]> local_buf(new u8[size]);
 	const u64 result = file.read(local_buf.get(), size);
@@ -79,6 +86,50 @@ u64 lv2_file::op_write(vm::ps3::cptr<void> buf, u64 size)
 	return file.write(local_buf.get(), size);
 }
 
+u64 lv2_file::read_at(u64 offset, void* buffer, u64 size)
+{
+	// Try lock-free positional read first
+	const u64 result = file.read_at(offset, buffer, size);
+
+	if (result != -1)
+	{
+		return result;
+	}
+
+	// Emulate it with the file lock held
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const u64 old_pos = file.pos();
+	file.seek(offset);
+	const u64 nread = file.read(buffer, size);
+	verify(HERE), old_pos == file.seek(old_pos);
+	return nread;
+}
+
+u64 lv2_file::op_read_at(u64 offset, vm::ps3::ptr<void> buf, u64 size)
+{
+	if (file.get_mapped_data())
+	{
+		return file.read_at(offset, buf.get_ptr(), size);
+	}
+
+	std::unique_ptr<u8[]> local_buf(new u8[size]);
+	const u64 result = read_at(offset, local_buf.get(), size);
+	std::memcpy(buf.get_ptr(), local_buf.get(), result);
+	return result;
+}
+
+u64 lv2_file::op_write_at(u64 offset, vm::ps3::cptr<void> buf, u64 size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const u64 old_pos = file.pos();
+	file.seek(offset);
+	const u64 result = op_write(buf, size);
+	verify(HERE), old_pos == file.seek(old_pos);
+	return result;
+}
+
 struct lv2_file::file_view : fs::file_base
 {
 	const std::shared_ptr<lv2_file> m_file;
@@ -108,10 +159,7 @@ struct lv2_file::file_view : fs::file_base
 
 	u64 read(void* buffer, u64 size) override
 	{
-		const u64 old_pos = m_file->file.pos();
-		const u64 new_pos = m_file->file.seek(m_off + m_pos);
-		const u64 result = m_file->file.read(buffer, size);
-		verify(HERE), old_pos == m_file->file.seek(old_pos);
+		const u64 result = m_file->read_at(m_off + m_pos, buffer, size);
 
 		m_pos += result;
 		return result;
@@ -273,6 +321,17 @@ error_code sys_fs_open(vm::cptr<char> path, s32 flags, vm::ptr<u32> fd, s32 mode
 		fmt::throw_exception("sys_fs_open(%s): Invalid or unimplemented flags: %#o" HERE, path, flags);
 	}
 
+	// Map read-only game data (falls back to the regular file if not possible)
+	if (open_mode == fs::read && g_cfg.vfs.mmap_game_data)
+	{
+		const std::string vpath = path.get_ptr();
+
+		if (vpath.compare(0, 10, "/dev_bdvd/") == 0 || vpath.compare(0, 10, "/app_home/") == 0)
+		{
+			open_mode += fs::mmap;
+		}
+	}
+
 	fs::file file(local_path, open_mode);
 
 	if (!file)
@@ -359,7 +418,7 @@ error_code sys_fs_read(u32 fd, vm::ptr<void> buf, u64 nbytes, vm::ptr<u64> nread
 		return CELL_EBADF;
 	}
 
-	std::lock_guard<std::mutex> lock(file->mp->mutex);
+	std::lock_guard<std::mutex> lock(file->mutex);
 
 	*nread = file->op_read(buf, nbytes);
 
@@ -377,7 +436,7 @@ error_code sys_fs_write(u32 fd, vm::cptr<void> buf, u64 nbytes, vm::ptr<u64> nwr
 		return CELL_EBADF;
 	}
 
-	std::lock_guard<std::mutex> lock(file->mp->mutex);
+	std::lock_guard<std::mutex> lock(file->mutex);
 
 	if (file->lock)
 	{
@@ -541,7 +600,7 @@ error_code sys_fs_fstat(u32 fd, vm::ptr<CellFsStat> sb)
 		return CELL_EBADF;
 	}
 
-	std::lock_guard<std::mutex> lock(file->mp->mutex);
+	std::lock_guard<std::mutex> lock(file->mutex);
 
 	const fs::stat_t& info = file->file.stat();
 
@@ -690,21 +749,14 @@ error_code sys_fs_fcntl(u32 fd, u32 op, vm::ptr<void> _arg, u32 _size)
 			return CELL_EBADF;
 		}
 
-		std::lock_guard<std::mutex> lock(file->mp->mutex);
-
 		if (op == 0x8000000b && file->lock)
 		{
 			return CELL_EBUSY;
 		}
 
-		const u64 old_pos = file->file.pos();
-		const u64 new_pos = file->file.seek(arg->offset);
-
 		arg->out_size = op == 0x8000000a
-			? file->op_read(arg->buf, arg->size)
-			: file->op_write(arg->buf, arg->size);
-
-		verify(HERE), old_pos == file->file.seek(old_pos);
+			? file->op_read_at(arg->offset, arg->buf, arg->size)
+			: file->op_write_at(arg->offset, arg->buf, arg->size);
 
 		arg->out_code = CELL_OK;
 		return CELL_OK;
@@ -1017,7 +1069,7 @@ error_code sys_fs_lseek(u32 fd, s64 offset, s32 whence, vm::ptr<u64> pos)
 		return CELL_EBADF;
 	}
 
-	std::lock_guard<std::mutex> lock(file->mp->mutex);
+	std::lock_guard<std::mutex> lock(file->mutex);
 
 	const u64 result = file->file.seek(offset, static_cast<fs::seek_mode>(whence));
 
@@ -1129,7 +1181,7 @@ error_code sys_fs_ftruncate(u32 fd, u64 size)
 		return CELL_EBADF;
 	}
 
-	std::lock_guard<std::mutex> lock(file->mp->mutex);
+	std::lock_guard<std::mutex> lock(file->mutex);
 
 	if (!file->file.trunc(size))
 	{
@@ -3,6 +3,8 @@
 #include "Emu/Memory/Memory.h"
 #include "Emu/Cell/ErrorCodes.h"
 
+#include <mutex>
+
 // Open Flags
 enum : s32
 {
@@ -169,6 +171,9 @@ struct lv2_file final : lv2_fs_object
 	// Stream lock
 	atomic_t<u32> lock{0};
 
+	// File lock (protects the current position, not required for positional reads)
+	std::mutex mutex;
+
 	lv2_file(const char* filename, fs::file&& file, s32 mode, s32 flags)
 		: lv2_fs_object(lv2_fs_object::get_mp(filename), filename)
 		, file(std::move(file))
@@ -191,6 +196,15 @@ struct lv2_file final : lv2_fs_object
 	// File writing with intermediate buffer
 	u64 op_write(vm::ps3::cptr<void> buf, u64 size);
 
+	// Positional file reading (doesn't change the position, lock-free if supported by the host file)
+	u64 op_read_at(u64 offset, vm::ps3::ptr<void> buf, u64 size);
+
+	// Positional file writing (doesn't change the position)
+	u64 op_write_at(u64 offset, vm::ps3::cptr<void> buf, u64 size);
+
+	// Positional read into host memory (doesn't change the position)
+	u64 read_at(u64 offset, void* buffer, u64 size);
+
 	// For MSELF support
 	struct file_view;
 
@@ -266,6 +266,8 @@ error_code _sys_lwcond_queue_wait(ppu_thread& ppu, u32 lwcond_id, u32 lwmutex_id
 
 	ppu.gpr[3] = CELL_OK;
 
+	const u64 stamp = cond->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -302,6 +304,8 @@ error_code _sys_lwcond_queue_wait(ppu_thread& ppu, u32 lwcond_id, u32 lwmutex_id
 		}
 	}
 
+	cond->waiter.parked(stamp);
+
 	// Return cause
 	return not_an_error(ppu.gpr[3]);
 }
@@ -110,6 +110,8 @@ error_code _sys_lwmutex_lock(ppu_thread& ppu, u32 lwmutex_id, u64 timeout)
 
 	ppu.gpr[3] = CELL_OK;
 
+	const u64 stamp = mutex->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -138,6 +140,8 @@ error_code _sys_lwmutex_lock(ppu_thread& ppu, u32 lwmutex_id, u64 timeout)
 		}
 	}
 
+	mutex->waiter.parked(stamp);
+
 	return not_an_error(ppu.gpr[3]);
 }
 
@@ -145,7 +149,7 @@ error_code _sys_lwmutex_trylock(u32 lwmutex_id)
 {
 	sys_lwmutex.trace("_sys_lwmutex_trylock(lwmutex_id=0x%x)", lwmutex_id);
 
-	const auto mutex = idm::check<lv2_obj, lv2_lwmutex>(lwmutex_id, [&](lv2_lwmutex& mutex)
+	const auto mutex = idm::borrow<lv2_obj, lv2_lwmutex>(lwmutex_id, [&](lv2_lwmutex& mutex)
 	{
 		if (u32 value = mutex.signaled)
 		{
@@ -175,7 +179,7 @@ error_code _sys_lwmutex_unlock(ppu_thread& ppu, u32 lwmutex_id)
 {
 	sys_lwmutex.trace("_sys_lwmutex_unlock(lwmutex_id=0x%x)", lwmutex_id);
 
-	const auto mutex = idm::check<lv2_obj, lv2_lwmutex>(lwmutex_id, [&](lv2_lwmutex& mutex) -> cpu_thread*
+	const auto mutex = idm::borrow<lv2_obj, lv2_lwmutex>(lwmutex_id, [&](lv2_lwmutex& mutex) -> cpu_thread*
 	{
 		semaphore_lock lock(mutex.mutex);
 
@@ -142,6 +142,8 @@ error_code sys_mutex_lock(ppu_thread& ppu, u32 mutex_id, u64 timeout)
 
 	ppu.gpr[3] = CELL_OK;
 
+	const u64 stamp = mutex->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -170,6 +172,8 @@ error_code sys_mutex_lock(ppu_thread& ppu, u32 mutex_id, u64 timeout)
 		}
 	}
 
+	mutex->waiter.parked(stamp);
+
 	return not_an_error(ppu.gpr[3]);
 }
 
@@ -177,7 +181,7 @@ error_code sys_mutex_trylock(ppu_thread& ppu, u32 mutex_id)
 {
 	sys_mutex.trace("sys_mutex_trylock(mutex_id=0x%x)", mutex_id);
 
-	const auto mutex = idm::check<lv2_obj, lv2_mutex>(mutex_id, [&](lv2_mutex& mutex)
+	const auto mutex = idm::borrow<lv2_obj, lv2_mutex>(mutex_id, [&](lv2_mutex& mutex)
 	{
 		return mutex.try_lock(ppu.id);
 	});
@@ -204,7 +208,7 @@ error_code sys_mutex_unlock(ppu_thread& ppu, u32 mutex_id)
 {
 	sys_mutex.trace("sys_mutex_unlock(mutex_id=0x%x)", mutex_id);
 
-	const auto mutex = idm::check<lv2_obj, lv2_mutex>(mutex_id, [&](lv2_mutex& mutex)
+	const auto mutex = idm::borrow<lv2_obj, lv2_mutex>(mutex_id, [&](lv2_mutex& mutex)
 	{
 		return mutex.try_unlock(ppu.id);
 	});
@@ -121,6 +121,8 @@ error_code sys_semaphore_wait(ppu_thread& ppu, u32 sem_id, u64 timeout)
 
 	ppu.gpr[3] = CELL_OK;
 
+	const u64 stamp = sem->waiter.spin([&] { return test(ppu.state, cpu_flag::signal); });
+
 	while (!ppu.state.test_and_reset(cpu_flag::signal))
 	{
 		if (timeout)
@@ -158,6 +160,8 @@ error_code sys_semaphore_wait(ppu_thread& ppu, u32 sem_id, u64 timeout)
 		}
 	}
 
+	sem->waiter.parked(stamp);
+
 	return not_an_error(ppu.gpr[3]);
 }
 
@@ -262,7 +266,7 @@ error_code sys_semaphore_get_value(u32 sem_id, vm::ptr<s32> count)
 		return CELL_EFAULT;
 	}
 
-	if (!idm::check<lv2_obj, lv2_sema>(sem_id, [=](lv2_sema& sema)
+	if (!idm::borrow<lv2_obj, lv2_sema>(sem_id, [=](lv2_sema& sema)
 	{
 		*count = std::max<s32>(0, sema.val);
 	}))
@@ -57,6 +57,9 @@ struct lv2_obj
 	static const u32 id_step = 0x100;
 	static const u32 id_count = 8192;
 
+	// Spin-then-park state of threads waiting on the object
+	adaptive_wait waiter;
+
 	// Find and remove the object from the container (deque or vector)
 	template <typename T, typename E>
 	static bool unqueue(std::deque<T*>& queue, const E& object)
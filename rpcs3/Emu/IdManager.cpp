@@ -1,12 +1,92 @@
 #include "stdafx.h"
 #include "IdManager.h"
 
+#include <mutex>
+#include <thread>
+#include <deque>
+
 shared_mutex id_manager::g_mutex;
 
+DECLARE(id_manager::id_epoch::g_epoch){0};
+DECLARE(id_manager::id_epoch::g_shards);
+
 thread_local DECLARE(idm::g_id);
 DECLARE(idm::g_map);
+DECLARE(idm::g_tables);
 DECLARE(fxm::g_vec);
 
+// Unpublished records waiting for the readers (tagged with the epoch of removal, oldest first)
+static std::mutex s_retire_mutex;
+static std::deque<std::pair<u64, std::unique_ptr<const id_manager::id_record>>> s_retired;
+
+bool id_manager::id_epoch::try_advance()
+{
+	const u64 epoch = g_epoch.load();
+
+	// New readers can't register with the previous epoch parity anymore
+	for (auto& shard : g_shards)
+	{
+		if (shard.readers[(epoch - 1) & 1])
+		{
+			return false;
+		}
+	}
+
+	g_epoch = epoch + 1;
+	return true;
+}
+
+void id_manager::id_epoch::retire(std::unique_ptr<const id_record> data)
+{
+	std::vector<std::unique_ptr<const id_record>> freed;
+	{
+		std::lock_guard<std::mutex> lock(s_retire_mutex);
+
+		if (data)
+		{
+			s_retired.emplace_back(g_epoch.load(), std::move(data));
+		}
+
+		// Readers at the epoch of removal are gone after two steps (usually done at once, otherwise left to the next writer)
+		while (!s_retired.empty() && s_retired.back().first + 2 > g_epoch.load() && try_advance())
+		{
+		}
+
+		while (!s_retired.empty() && s_retired.front().first + 2 <= g_epoch.load())
+		{
+			freed.emplace_back(std::move(s_retired.front().second));
+			s_retired.pop_front();
+		}
+	}
+
+	// Records (and possibly objects) are destroyed without the lock
+}
+
+void id_manager::id_epoch::synchronize()
+{
+	std::vector<std::unique_ptr<const id_record>> freed;
+	{
+		std::lock_guard<std::mutex> lock(s_retire_mutex);
+
+		const u64 target = g_epoch.load() + 2;
+
+		while (g_epoch.load() < target)
+		{
+			if (!try_advance())
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		for (auto& pair : s_retired)
+		{
+			freed.emplace_back(std::move(pair.second));
+		}
+
+		s_retired.clear();
+	}
+}
+
 id_manager::id_map::pointer idm::allocate_id(const id_manager::id_key& info, u32 base, u32 step, u32 count)
 {
 	// Base type id is stored in value
@@ -46,21 +126,91 @@ id_manager::id_map::pointer idm::allocate_id(const id_manager::id_key& info, u32
 	return nullptr;
 }
 
+void idm::publish(u32 type, u32 index, u32 count, const id_manager::id_record& data)
+{
+	auto& ref = g_tables[type];
+
+	auto table = ref.ptr.load();
+
+	if (UNLIKELY(!table || index >= table->size))
+	{
+		// Allocate or grow the table (the old table is kept alive for the readers)
+		const auto _new = new id_manager::id_table(std::max(count, index + 1), std::unique_ptr<id_manager::id_table>(table));
+
+		if (table)
+		{
+			for (u32 i = 0; i < table->size; i++)
+			{
+				_new->slots[i] = table->slots[i].load();
+			}
+		}
+
+		ref.ptr = _new;
+
+		if (table)
+		{
+			// Readers of the old table fall back to the locked lookup
+			for (u32 i = 0; i < table->size; i++)
+			{
+				table->slots[i] = nullptr;
+			}
+		}
+
+		table = _new;
+	}
+
+	verify(HERE), !table->slots[index].exchange(new id_manager::id_record(data));
+}
+
+std::unique_ptr<const id_manager::id_record> idm::unpublish(u32 type, u32 index)
+{
+	const auto table = g_tables[type].ptr.load();
+
+	if (!table || index >= table->size)
+	{
+		return nullptr;
+	}
+
+	return std::unique_ptr<const id_manager::id_record>(table->slots[index].exchange(nullptr));
+}
+
+void idm::retire(std::unique_ptr<const id_manager::id_record> data)
+{
+	id_manager::id_epoch::retire(std::move(data));
+}
+
 void idm::init()
 {
 	// Allocate
 	g_map.resize(id_manager::typeinfo::get_count());
+
+	if (!g_tables)
+	{
+		g_tables.reset(new id_manager::id_table_ref[id_manager::typeinfo::get_count()]);
+	}
 }
 
 void idm::clear()
 {
+	// Unpublished records (freed at once when the readers are gone)
+	std::vector<std::unique_ptr<const id_manager::id_record>> retired;
+
 	// Call recorded finalization functions for all IDs
-	for (auto& map : g_map)
+	for (u32 type = 0; type < g_map.size(); type++)
 	{
-		for (auto& pair : map)
+		auto& map = g_map[type];
+
+		for (u32 i = 0; i < map.size(); i++)
 		{
+			auto& pair = map[i];
+
 			if (auto ptr = pair.second.get())
 			{
+				if (auto data = unpublish(type, i))
+				{
+					retired.emplace_back(std::move(data));
+				}
+
 				pair.first.on_stop()(ptr);
 				pair.second.reset();
 				pair.first = {};
@@ -69,6 +219,8 @@ void idm::clear()
 
 		map.clear();
 	}
+
+	id_manager::id_epoch::synchronize();
 }
 
 void fxm::init()
@@ -172,6 +172,111 @@ namespace id_manager
 	};
 
 	using id_map = std::vector<std::pair<id_key, std::shared_ptr<void>>>;
+
+	// Immutable copy of the ID map entry, published for lock-free lookups
+	using id_record = id_map::value_type;
+
+	// Lock-free lookup table (one per base type)
+	struct id_table
+	{
+		const u32 size;
+		const std::unique_ptr<atomic_t<const id_record*>[]> slots;
+
+		// Previous (smaller) table, kept alive for readers which may still access it
+		const std::unique_ptr<id_table> prev;
+
+		id_table(u32 size, std::unique_ptr<id_table> prev)
+			: size(size)
+			, slots(new atomic_t<const id_record*>[size]{})
+			, prev(std::move(prev))
+		{
+		}
+	};
+
+	// Owning pointer to the current lookup table
+	struct id_table_ref
+	{
+		atomic_t<id_table*> ptr{nullptr};
+
+		~id_table_ref()
+		{
+			delete ptr.load();
+		}
+	};
+
+	// Epoch-based reclamation of published records: lookups never lock, removed records are freed after the readers
+	class id_epoch
+	{
+		// Active readers for each epoch parity (sharded by thread)
+		struct alignas(64) shard
+		{
+			atomic_t<u32> readers[2]{};
+		};
+
+		static constexpr u32 shard_count = 16;
+
+		static atomic_t<u64> g_epoch;
+		static shard g_shards[shard_count];
+
+		// Advance the epoch if the readers of the previous one are gone (retire mutex must be locked)
+		static bool try_advance();
+
+		static shard& get_shard()
+		{
+			static atomic_t<u32> g_next{0};
+
+			static thread_local shard* result = nullptr;
+
+			if (UNLIKELY(!result))
+			{
+				result = &g_shards[g_next++ % shard_count];
+			}
+
+			return *result;
+		}
+
+	public:
+		// Reader registration (keep it short: removal waits for it)
+		class reader final
+		{
+			atomic_t<u32>* m_count;
+
+		public:
+			reader()
+			{
+				auto& shard = get_shard();
+
+				while (true)
+				{
+					const u64 epoch = g_epoch.load();
+
+					m_count = &shard.readers[epoch & 1];
+					(*m_count)++;
+
+					// Retry if the epoch was advanced before the registration became visible
+					if (LIKELY(g_epoch.load() == epoch))
+					{
+						break;
+					}
+
+					(*m_count)--;
+				}
+			}
+
+			reader(const reader&) = delete;
+
+			~reader()
+			{
+				(*m_count)--;
+			}
+		};
+
+		// Free the unpublished record when the readers are gone (deferred if some are still active)
+		static void retire(std::unique_ptr<const id_record> data);
+
+		// Wait until all readers which could access unpublished records are gone, free all retired records
+		static void synchronize();
+	};
 }
 
 // Object manager for emulated process. Multiple objects of specified arbitrary type are given unique IDs.
@@ -183,6 +288,9 @@ class idm
 	// Type Index -> ID -> Object. Use global since only one process is supported atm.
 	static std::vector<id_manager::id_map> g_map;
 
+	// Type Index -> lock-free lookup table
+	static std::unique_ptr<id_manager::id_table_ref[]> g_tables;
+
 	template <typename T>
 	static inline u32 get_type()
 	{
@@ -266,6 +374,40 @@ class idm
 	// Prepare new ID (returns nullptr if out of resources)
 	static id_manager::id_map::pointer allocate_id(const id_manager::id_key& info, u32 base, u32 step, u32 count);
 
+	// Publish the record for lock-free lookups (called under writer lock)
+	static void publish(u32 type, u32 index, u32 count, const id_manager::id_record& data);
+
+	// Remove the record from lock-free lookups (called under writer lock)
+	static std::unique_ptr<const id_manager::id_record> unpublish(u32 type, u32 index);
+
+	// Free the unpublished record when lock-free readers are gone (called without lock, doesn't wait)
+	static void retire(std::unique_ptr<const id_manager::id_record> data);
+
+	// Find the published record (called under id_epoch::reader)
+	template <typename T, typename Type>
+	static const id_manager::id_record* find_record(u32 id)
+	{
+		static_assert(id_manager::id_verify<T, Type>::value, "Invalid ID type combination");
+
+		const u32 index = get_index<Type>(id);
+
+		const auto table = g_tables[get_type<T>()].ptr.load();
+
+		if (!table || index >= table->size || index >= id_manager::id_traits<Type>::count)
+		{
+			return nullptr;
+		}
+
+		const auto data = table->slots[index].load();
+
+		if (data && (std::is_same<T, Type>::value || data->first.type() == get_type<Type>()))
+		{
+			return data;
+		}
+
+		return nullptr;
+	}
+
 	// Find ID (additionally check type if types are not equal)
 	template <typename T, typename Type>
 	static id_manager::id_map::pointer find_id(u32 id)
@@ -316,6 +458,7 @@ class idm
 
 			if (place->second)
 			{
+				publish(get_type<T>(), get_index<Type>(place->first), traits::count, *place);
 				return place;
 			}
 		}
@@ -407,10 +550,20 @@ public:
 		return nullptr;
 	}
 
-	// Check the ID
+	// Check the ID (lock-free)
 	template <typename T, typename Get = T>
 	static inline Get* check(u32 id)
 	{
+		{
+			id_manager::id_epoch::reader lock;
+
+			if (const auto found = find_record<T, Get>(id))
+			{
+				return static_cast<Get*>(found->second.get());
+			}
+		}
+
+		// Not published (or the table was being reallocated)
 		reader_lock lock(id_manager::g_mutex);
 
 		return check_unlocked<T, Get>(id);
@@ -445,6 +598,43 @@ public:
 		return {nullptr};
 	}
 
+	// Access the object without locking and refcounting (for short syscall bodies: func must not access idm, the object can be removed concurrently but stays valid until func returns)
+	template <typename T, typename Get = T, typename F, typename FRT = std::result_of_t<F(Get&)>, typename = std::enable_if_t<std::is_void<FRT>::value>>
+	static inline Get* borrow(u32 id, F&& func, int = 0)
+	{
+		{
+			id_manager::id_epoch::reader lock;
+
+			if (const auto found = find_record<T, Get>(id))
+			{
+				const auto ptr = static_cast<Get*>(found->second.get());
+
+				func(*ptr);
+				return ptr;
+			}
+		}
+
+		return check<T, Get>(id, std::forward<F>(func));
+	}
+
+	// Access the object without locking and refcounting, propagate return value
+	template <typename T, typename Get = T, typename F, typename FRT = std::result_of_t<F(Get&)>, typename = std::enable_if_t<!std::is_void<FRT>::value>>
+	static inline return_pair<Get*, FRT> borrow(u32 id, F&& func)
+	{
+		{
+			id_manager::id_epoch::reader lock;
+
+			if (const auto found = find_record<T, Get>(id))
+			{
+				const auto ptr = static_cast<Get*>(found->second.get());
+
+				return {ptr, func(*ptr)};
+			}
+		}
+
+		return check<T, Get>(id, std::forward<F>(func));
+	}
+
 	// Get the object without locking (can be called from other method)
 	template <typename T, typename Get = T>
 	static inline std::shared_ptr<Get> get_unlocked(u32 id)
@@ -459,10 +649,19 @@ public:
 		return {found->second, static_cast<Get*>(found->second.get())};
 	}
 
-	// Get the object
+	// Get the object (lock-free)
 	template <typename T, typename Get = T>
 	static inline std::shared_ptr<Get> get(u32 id)
 	{
+		{
+			id_manager::id_epoch::reader lock;
+
+			if (const auto found = find_record<T, Get>(id))
+			{
+				return {found->second, static_cast<Get*>(found->second.get())};
+			}
+		}
+
 		reader_lock lock(id_manager::g_mutex);
 
 		const auto found = find_id<T, Get>(id);
@@ -575,12 +774,14 @@ public:
 	static inline explicit_bool_t remove(u32 id)
 	{
 		std::shared_ptr<void> ptr;
+		std::unique_ptr<const id_manager::id_record> data;
 		{
 			writer_lock lock(id_manager::g_mutex);
 
 			if (const auto found = find_id<T, Get>(id))
 			{
 				ptr = std::move(found->second);
+				data = unpublish(get_type<T>(), get_index<Get>(id));
 			}
 			else
 			{
@@ -588,6 +789,7 @@ public:
 			}
 		}
 
+		retire(std::move(data));
 		id_manager::on_stop<Get>::func(static_cast<Get*>(ptr.get()));
 		return true;
 	}
@@ -597,12 +799,14 @@ public:
 	static inline std::shared_ptr<Get> withdraw(u32 id)
 	{
 		std::shared_ptr<void> ptr;
+		std::unique_ptr<const id_manager::id_record> data;
 		{
 			writer_lock lock(id_manager::g_mutex);
 
 			if (const auto found = find_id<T, Get>(id))
 			{
 				ptr = std::move(found->second);
+				data = unpublish(get_type<T>(), get_index<Get>(id));
 			}
 			else
 			{
@@ -610,6 +814,7 @@ public:
 			}
 		}
 
+		retire(std::move(data));
 		id_manager::on_stop<Get>::func(static_cast<Get*>(ptr.get()));
 		return {ptr, static_cast<Get*>(ptr.get())};
 	}
@@ -621,6 +826,7 @@ public:
 		using result_type = std::shared_ptr<Get>;
 
 		std::shared_ptr<void> ptr;
+		std::unique_ptr<const id_manager::id_record> data;
 		{
 			writer_lock lock(id_manager::g_mutex);
 
@@ -629,6 +835,7 @@ public:
 				func(*static_cast<Get*>(found->second.get()));
 
 				ptr = std::move(found->second);
+				data = unpublish(get_type<T>(), get_index<Get>(id));
 			}
 			else
 			{
@@ -636,6 +843,7 @@ public:
 			}
 		}
 
+		retire(std::move(data));
 		id_manager::on_stop<Get>::func(static_cast<Get*>(ptr.get()));
 		return result_type{ptr, static_cast<Get*>(ptr.get())};
 	}
@@ -647,6 +855,7 @@ public:
 		using result_type = return_pair<Get, FRT>;
 
 		std::shared_ptr<void> ptr;
+		std::unique_ptr<const id_manager::id_record> data;
 		FRT ret;
 		{
 			writer_lock lock(id_manager::g_mutex);
@@ -663,6 +872,7 @@ public:
 				}
 
 				ptr = std::move(found->second);
+				data = unpublish(get_type<T>(), get_index<Get>(id));
 			}
 			else
 			{
@@ -670,6 +880,7 @@ public:
 			}
 		}
 
+		retire(std::move(data));
 		id_manager::on_stop<Get>::func(static_cast<Get*>(ptr.get()));
 		return result_type{{ptr, static_cast<Get*>(ptr.get())}, std::move(ret)};
 	}
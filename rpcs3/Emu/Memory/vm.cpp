@@ -56,6 +56,12 @@ namespace vm
 	// Registered waiters
 	std::deque<vm::waiter*> g_waiters;
 
+	// Protects g_waiters
+	shared_mutex g_waiters_mutex;
+
+	// Amount of registered waiters (fast check)
+	atomic_t<u32> g_waiters_count{0};
+
 	// Memory mutex core
 	shared_mutex g_mutex;
 
@@ -257,22 +263,59 @@ namespace vm
 
 	u64 reservation_acquire(u32 addr, u32 _size)
 	{
-		// Access reservation info: stamp and the lock bit
-		return g_pages[addr >> 12][addr].load(std::memory_order_acquire);
+		auto& res = g_pages[addr >> 12][addr];
+
+		// Access reservation info: stamp and the lock bit (wait while the line is being updated)
+		while (true)
+		{
+			const u64 stamp = res.load(std::memory_order_acquire);
+
+			if (LIKELY((stamp & 1) == 0))
+			{
+				return stamp;
+			}
+
+			busy_wait();
+		}
 	}
 
 	void reservation_update(u32 addr, u32 _size)
 	{
-		// Update reservation info with new timestamp (unsafe, assume allocated)
-		(*g_pages[addr >> 12].reservations)[(addr & 0xfff) >> 7].store(__rdtsc(), std::memory_order_release);
+		// Update reservation info with new stamp
+		reservation_unlock(addr, reservation_lock(addr, _size), true);
+	}
+
+	bool reservation_trylock(u32 addr, u64 stamp)
+	{
+		return g_pages[addr >> 12][addr].compare_exchange_strong(stamp, stamp | 1);
+	}
+
+	u64 reservation_lock(u32 addr, u32 _size)
+	{
+		while (true)
+		{
+			const u64 stamp = reservation_acquire(addr, _size);
+
+			if (reservation_trylock(addr, stamp))
+			{
+				return stamp;
+			}
+		}
+	}
+
+	void reservation_unlock(u32 addr, u64 stamp, bool modified)
+	{
+		// New stamp breaks other reservations on the line
+		g_pages[addr >> 12][addr].store(modified ? stamp + 2 : stamp, std::memory_order_release);
 	}
 
 	void waiter::init()
 	{
 		// Register waiter
-		writer_lock lock(0);
+		::writer_lock lock(g_waiters_mutex);
 
 		g_waiters.emplace_back(this);
+		g_waiters_count++;
 	}
 
 	void waiter::test() const
@@ -303,7 +346,7 @@ namespace vm
 	waiter::~waiter()
 	{
 		// Unregister waiter
-		writer_lock lock(0);
+		::writer_lock lock(g_waiters_mutex);
 
 		// Find waiter
 		const auto found = std::find(g_waiters.cbegin(), g_waiters.cend(), this);
@@ -311,11 +354,19 @@ namespace vm
 		if (found != g_waiters.cend())
 		{
 			g_waiters.erase(found);
+			g_waiters_count--;
 		}
 	}
 
 	void notify(u32 addr, u32 size)
 	{
+		if (!g_waiters_count)
+		{
+			return;
+		}
+
+		::reader_lock lock(g_waiters_mutex);
+
 		for (const waiter* ptr : g_waiters)
 		{
 			if (ptr->addr / 128 == addr / 128)
@@ -327,6 +378,8 @@ namespace vm
 
 	void notify_all()
 	{
+		::reader_lock lock(g_waiters_mutex);
+
 		for (const waiter* ptr : g_waiters)
 		{
 			ptr->test();
@@ -414,15 +467,8 @@ namespace vm
 			{
 				if (u32 page_size = (i - start) * 4096)
 				{
-#ifdef _WIN32
-					DWORD old;
-
-					auto protection = start_value & page_writable ? PAGE_READWRITE : (start_value & page_readable ? PAGE_READONLY : PAGE_NOACCESS);
-					verify(__func__), ::VirtualProtect(vm::base(start * 4096), page_size, protection, &old);
-#else
-					auto protection = start_value & page_writable ? PROT_WRITE | PROT_READ : (start_value & page_readable ? PROT_READ : PROT_NONE);
-					verify(__func__), !::mprotect(vm::base(start * 4096), page_size, protection);
-#endif
+					const auto protection = start_value & page_writable ? utils::protection::rw : (start_value & page_readable ? utils::protection::ro : utils::protection::no);
+					utils::memory_protect(vm::base(start * 4096), page_size, protection);
 				}
 
 				start_value = new_val;
@@ -532,22 +578,118 @@ namespace vm
 		}
 	}
 
-	bool block_t::try_alloc(u32 addr, u32 size, u8 flags, u32 sup)
+	u32 block_t::find_used(u32 start, u32 end) const
 	{
-		// Check if memory area is already mapped
-		for (u32 i = addr / 4096; i <= (addr + size - 1) / 4096; i++)
+		for (u32 i = start; i < end;)
 		{
-			if (g_pages[i].flags)
+			const u64 bits = m_pages[i / 64] & (~0ull << (i % 64));
+
+			if (bits)
 			{
-				return false;
+				return std::min<u32>(i / 64 * 64 + static_cast<u32>(cnttz64(bits, true)), end);
+			}
+
+			i = (i / 64 + 1) * 64;
+		}
+
+		return end;
+	}
+
+	u32 block_t::find_free(u32 start) const
+	{
+		const u32 count = size / 4096;
+
+		if (start >= count)
+		{
+			return count;
+		}
+
+		u32 word = start / 64;
+		u64 bits = ~m_pages[word] & (~0ull << (start % 64));
+
+		while (!bits)
+		{
+			// Skip fully allocated words
+			word++;
+
+			u32 group = word / 64;
+
+			if (group >= m_full.size())
+			{
+				return count;
+			}
+
+			u64 free = ~m_full[group] & (~0ull << (word % 64));
+
+			while (!free)
+			{
+				if (++group >= m_full.size())
+				{
+					return count;
+				}
+
+				free = ~m_full[group];
 			}
+
+			word = group * 64 + static_cast<u32>(cnttz64(free, true));
+			bits = ~m_pages[word];
+		}
+
+		// Pages past the end of the block are always marked as allocated
+		return word * 64 + static_cast<u32>(cnttz64(bits, true));
+	}
+
+	void block_t::set_pages(u32 start, u32 count, bool used)
+	{
+		for (u32 i = start; i < start + count;)
+		{
+			const u32 word = i / 64;
+			const u32 bits = std::min<u32>(64 - i % 64, start + count - i);
+			const u64 mask = (bits == 64 ? ~0ull : (1ull << bits) - 1) << (i % 64);
+
+			if (used)
+			{
+				m_pages[word] |= mask;
+			}
+			else
+			{
+				m_pages[word] &= ~mask;
+			}
+
+			if (~m_pages[word])
+			{
+				m_full[word / 64] &= ~(1ull << (word % 64));
+			}
+			else
+			{
+				m_full[word / 64] |= 1ull << (word % 64);
+			}
+
+			i += bits;
+		}
+	}
+
+	bool block_t::try_alloc(u32 addr, u32 size, u8 flags, u32 sup)
+	{
+		const u32 page = (addr - this->addr) / 4096;
+
+		// Check if memory area is already mapped
+		if (find_used(page, page + size / 4096) != page + size / 4096)
+		{
+			return false;
+		}
+
+		// Map "real" memory pages (the global lock is only required to update page tables)
+		{
+			writer_lock lock;
+			_page_map(addr, size, flags);
 		}
 
-		// Map "real" memory pages
-		_page_map(addr, size, flags);
+		set_pages(page, size / 4096, true);
 
 		// Add entry
 		m_map[addr] = size;
+		m_used += size;
 
 		// Add supplementary info if necessary
 		if (sup) m_sup[addr] = sup;
@@ -560,6 +702,22 @@ namespace vm
 		, size(size)
 		, flags(flags)
 	{
+		const u32 count = size / 4096;
+		const u32 words = (count + 63) / 64;
+
+		m_pages.resize(words);
+		m_full.resize((words + 63) / 64);
+
+		// Mark nonexistent pages and words as allocated
+		if (count % 64)
+		{
+			m_pages[words - 1] = ~0ull << (count % 64);
+		}
+
+		if (words % 64)
+		{
+			m_full.back() = ~0ull << (words % 64);
+		}
 	}
 
 	block_t::~block_t()
@@ -575,8 +733,6 @@ namespace vm
 
 	u32 block_t::alloc(u32 size, u32 align, u32 sup)
 	{
-		writer_lock lock;
-
 		// Align to minimal page size
 		size = ::align(size, 4096);
 
@@ -603,13 +759,36 @@ namespace vm
 			pflags |= page_64k_size;
 		}
 
-		// Search for an appropriate place (unoptimized)
-		for (u32 addr = ::align(this->addr, align); addr < this->addr + this->size - 1; addr += align)
+		// Don't block other threads taking the global lock while waiting
+		vm::temporary_unlock();
+
+		::writer_lock lock(m_mutex);
+
+		const u32 count = this->size / 4096;
+		const u32 pages = size / 4096;
+
+		// Search for the first fitting free range (in address order)
+		for (u32 page = find_free(0); page < count;)
 		{
-			if (try_alloc(addr, size, pflags, sup))
+			// Align absolute address
+			const u64 addr = ::align<u64>(this->addr + u64{page} * 4096, align);
+
+			if (addr + size > u64{this->addr} + this->size)
+			{
+				break;
+			}
+
+			page = static_cast<u32>((addr - this->addr) / 4096);
+
+			const u32 used = find_used(page, page + pages);
+
+			if (used == page + pages)
 			{
-				return addr;
+				verify(HERE), try_alloc(static_cast<u32>(addr), size, pflags, sup);
+				return static_cast<u32>(addr);
 			}
+
+			page = find_free(used + 1);
 		}
 
 		return 0;
@@ -617,8 +796,6 @@ namespace vm
 
 	u32 block_t::falloc(u32 addr, u32 size, u32 sup)
 	{
-		writer_lock lock;
-
 		// align to minimal page size
 		size = ::align(size, 4096);
 
@@ -637,6 +814,10 @@ namespace vm
 			pflags |= page_64k_size;
 		}
 
+		vm::temporary_unlock();
+
+		::writer_lock lock(m_mutex);
+
 		if (!try_alloc(addr, size, pflags, sup))
 		{
 			return 0;
@@ -647,7 +828,9 @@ namespace vm
 
 	u32 block_t::dealloc(u32 addr, u32* sup_out)
 	{
-		writer_lock lock;
+		vm::temporary_unlock();
+
+		::writer_lock lock(m_mutex);
 
 		const auto found = m_map.find(addr);
 
@@ -659,7 +842,13 @@ namespace vm
 			m_map.erase(found);
 
 			// Unmap "real" memory pages
-			_page_unmap(addr, size);
+			{
+				writer_lock page_lock;
+				_page_unmap(addr, size);
+			}
+
+			set_pages((addr - this->addr) / 4096, size / 4096, false);
+			m_used -= size;
 
 			// Write supplementary info if necessary
 			if (sup_out) *sup_out = m_sup[addr];
@@ -675,16 +864,7 @@ namespace vm
 
 	u32 block_t::used()
 	{
-		reader_lock lock;
-
-		u32 result = 0;
-
-		for (auto& entry : m_map)
-		{
-			result += entry.second;
-		}
-
-		return result;
+		return m_used;
 	}
 
 	std::shared_ptr<block_t> map(u32 addr, u32 size, u64 flags)
@@ -3,6 +3,8 @@
 #include <map>
 #include <functional>
 #include <memory>
+#include <vector>
+#include "Utilities/mutex.h"
 
 class named_thread;
 class cpu_thread;
@@ -99,12 +101,21 @@ namespace vm
 		explicit operator bool() const { return locked; }
 	};
 
-	// Get reservation status for further atomic update: last update timestamp
+	// Get reservation status for further atomic update: last update stamp (waits while the line is locked)
 	u64 reservation_acquire(u32 addr, u32 size);
 
-	// End atomic update
+	// Unconditional atomic update: advance the stamp
 	void reservation_update(u32 addr, u32 size);
 
+	// Lock the reservation line (128 bytes) for the update if the stamp didn't change (bit 0 of the stamp is the lock bit)
+	bool reservation_trylock(u32 addr, u64 stamp);
+
+	// Lock the reservation line unconditionally, returns the stamp
+	u64 reservation_lock(u32 addr, u32 size);
+
+	// Unlock the reservation line (modified: advance the stamp to break other reservations)
+	void reservation_unlock(u32 addr, u64 stamp, bool modified);
+
 	// Check and notify memory changes at address
 	void notify(u32 addr, u32 size);
 
@@ -132,9 +143,27 @@ namespace vm
 	// Object that handles memory allocations inside specific constant bounds ("location")
 	class block_t final
 	{
+		// Protects allocation info (the global memory lock is only taken to update page tables)
+		shared_mutex m_mutex;
+
 		std::map<u32, u32> m_map; // Mapped memory: addr -> size
 		std::unordered_map<u32, u32> m_sup; // Supplementary info for allocations
 
+		std::vector<u64> m_pages; // Allocated pages (one bit per 4 KiB page)
+		std::vector<u64> m_full; // Fully allocated words of m_pages (one bit per word)
+
+		atomic_t<u32> m_used{0}; // Allocated memory size
+
+		// Find first allocated page in the range, return `end` if none
+		u32 find_used(u32 start, u32 end) const;
+
+		// Find first free page starting from the specified one, return page count if none
+		u32 find_free(u32 start) const;
+
+		// Mark pages as allocated or free
+		void set_pages(u32 start, u32 count, bool used);
+
+		// Allocate at fixed location (called with m_mutex locked)
 		bool try_alloc(u32 addr, u32 size, u8 flags, u32 sup);
 
 	public:
@@ -936,6 +936,7 @@ void GLGSRender::flip(int buffer)
 		m_text_printer.print_text(0, 36, m_frame->client_width(), m_frame->client_height(), "vertex upload time: " + std::to_string(m_vertex_upload_time) + "us");
 		m_text_printer.print_text(0, 54, m_frame->client_width(), m_frame->client_height(), "textures upload time: " + std::to_string(m_textures_upload_time) + "us");
 		m_text_printer.print_text(0, 72, m_frame->client_width(), m_frame->client_height(), "draw call execution: " + std::to_string(m_draw_time) + "us");
+		m_text_printer.print_text(0, 90, m_frame->client_width(), m_frame->client_height(), "memory protection calls: " + std::to_string(utils::memory_protect_count() - m_protect_count));
 	}
 
 	m_frame->flip(m_context);
@@ -945,6 +946,7 @@ void GLGSRender::flip(int buffer)
 	m_draw_time = 0;
 	m_vertex_upload_time = 0;
 	m_textures_upload_time = 0;
+	m_protect_count = utils::memory_protect_count();
 
 	m_gl_texture_cache.clear_temporary_surfaces();
 
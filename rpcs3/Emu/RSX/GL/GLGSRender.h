@@ -56,6 +56,7 @@ private:
 	s64 m_draw_time = 0;
 	s64 m_vertex_upload_time = 0;
 	s64 m_textures_upload_time = 0;
+	u64 m_protect_count = 0; // Host memory protection calls at the start of the frame
 
 	//Compare to see if transform matrix have changed
 	size_t m_transform_buffer_hash = 0;
@@ -541,7 +541,7 @@ namespace gl
 			return nullptr;
 		}
 
-		cached_texture_section *create_locked_view_of_section(u32 base, u32 size)
+		cached_texture_section *create_locked_view_of_section(u32 base, u32 size, utils::memory_protect_batch& batch)
 		{
 			cached_texture_section *region = find_cached_rtt_section(base, size);
 
@@ -552,7 +552,7 @@ namespace gl
 					if (rtt.is_dirty())
 					{
 						rtt.reset(base, size, true);
-						rtt.protect(utils::protection::no);
+						rtt.protect(utils::protection::no, batch);
 						region = &rtt;
 						break;
 					}
@@ -563,7 +563,7 @@ namespace gl
 					cached_texture_section section;
 					section.reset(base, size, true);
 					section.set_dirty(true);
-					section.protect(utils::protection::no);
+					section.protect(utils::protection::no, batch);
 
 					no_access_memory_sections.push_back(section);
 					region = &no_access_memory_sections.back();
@@ -576,13 +576,13 @@ namespace gl
 				//This section view already exists
 				if (region->get_section_size() != size)
 				{
-					region->unprotect();
+					region->unprotect(batch);
 					region->reset(base, size, true);
 				}
 
 				if (!region->is_locked() || region->is_flushed())
 				{
-					region->protect(utils::protection::no);
+					region->protect(utils::protection::no, batch);
 				}
 			}
 
@@ -846,9 +846,10 @@ namespace gl
 			gl_texture.init(index, tex);
 
 			std::lock_guard<std::mutex> lock(m_section_mutex);
+			utils::memory_protect_batch batch;
 
 			cached_texture_section &cached = create_texture(gl_texture.id(), texaddr, (const u32)get_texture_size(tex), tex_width, tex_height);
-			cached.protect(utils::protection::ro);
+			cached.protect(utils::protection::ro, batch);
 			cached.set_dirty(false);
 
 			//external gl::texture objects should always be undefined/uninitialized!
@@ -872,7 +873,8 @@ namespace gl
 				verify(HERE), region->is_dirty();
 				LOG_WARNING(RSX, "Cell write to bound render target area");
 
-				region->protect(utils::protection::no);
+				utils::memory_protect_batch batch;
+				region->protect(utils::protection::no, batch);
 				region->set_dirty(false);
 			}
 
@@ -882,17 +884,18 @@ namespace gl
 		void lock_rtt_region(const u32 base, const u32 size, const u16 width, const u16 height, const u16 pitch, const texture::format format, const texture::type type, const bool swap_bytes, gl::texture &source)
 		{
 			std::lock_guard<std::mutex> lock(m_section_mutex);
+			utils::memory_protect_batch batch;
 
-			cached_texture_section *region = create_locked_view_of_section(base, size);
+			cached_texture_section *region = create_locked_view_of_section(base, size, batch);
 
 			if (!region->matches(base, size))
 			{
 				//This memory region overlaps our own region, but does not match it exactly
 				if (region->is_locked())
-					region->unprotect();
+					region->unprotect(batch);
 
 				region->reset(base, size, true);
-				region->protect(utils::protection::no);
+				region->protect(utils::protection::no, batch);
 			}
 
 			region->set_dimensions(width, height, pitch);
@@ -932,6 +935,7 @@ namespace gl
 				address < read_only_range.second)
 			{
 				std::lock_guard<std::mutex> lock(m_section_mutex);
+				utils::memory_protect_batch batch;
 
 				for (int i = 0; i < read_only_memory_sections.size(); ++i)
 				{
@@ -950,7 +954,7 @@ namespace gl
 							i = 0;
 						}
 
-						tex.unprotect();
+						tex.unprotect(batch);
 						tex.set_dirty(true);
 						response = true;
 					}
@@ -961,6 +965,7 @@ namespace gl
 				address < no_access_range.second)
 			{
 				std::lock_guard<std::mutex> lock(m_section_mutex);
+				utils::memory_protect_batch batch;
 
 				for (int i = 0; i < no_access_memory_sections.size(); ++i)
 				{
@@ -979,7 +984,7 @@ namespace gl
 							i = 0;
 						}
 
-						tex.unprotect();
+						tex.unprotect(batch);
 						tex.set_dirty(true);
 
 						response = true;
@@ -993,6 +998,7 @@ namespace gl
 		void invalidate_range(u32 base, u32 size)
 		{
 			std::lock_guard<std::mutex> lock(m_section_mutex);
+			utils::memory_protect_batch batch;
 			std::pair<u32, u32> range = std::make_pair(base, size);
 
 			if (base < read_only_range.second &&
@@ -1001,7 +1007,10 @@ namespace gl
 				for (cached_texture_section &tex : read_only_memory_sections)
 				{
 					if (!tex.is_dirty() && tex.overlaps(range))
+					{
+						tex.unprotect(batch);
 						tex.destroy();
+					}
 				}
 			}
 
@@ -1012,7 +1021,7 @@ namespace gl
 				{
 					if (!tex.is_dirty() && tex.overlaps(range))
 					{
-						tex.unprotect();
+						tex.unprotect(batch);
 						tex.set_dirty(true);
 					}
 				}
@@ -1199,9 +1208,10 @@ namespace gl
 					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, src.width, src.slice_h, src_gl_format, src_gl_type, src.pixels);
 
 					std::lock_guard<std::mutex> lock(m_section_mutex);
-					
+					utils::memory_protect_batch batch;
+
 					auto &section = create_texture(vram_texture, src_address, src.pitch * src.slice_h, src.width, src.slice_h);
-					section.protect(utils::protection::ro);
+					section.protect(utils::protection::ro, batch);
 					section.set_dirty(false);
 				}
 			}
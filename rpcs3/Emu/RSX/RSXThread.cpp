@@ -2,6 +2,7 @@
 #include "Emu/Memory/Memory.h"
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
+#include "Emu/CPU/CPUPlacement.h"
 #include "RSXThread.h"
 
 #include "Emu/Cell/PPUCallback.h"
@@ -331,6 +332,8 @@ namespace rsx
 
 	void thread::on_task()
 	{
+		thread_placement::apply(thread_class::rsx, get_name());
+
 		on_init_thread();
 
 		reset();
@@ -339,34 +342,33 @@ namespace rsx
 
 		thread_ctrl::spawn(m_vblank_thread, "VBlank Thread", [this]()
 		{
-			const u64 start_time = get_system_time();
+			// 60 Hz
+			periodic_timer timer(1000000, 60);
+			timer.start();
 
 			vblank_count = 0;
 
 			// TODO: exit condition
 			while (!Emu.IsStopped())
 			{
-				if (get_system_time() - start_time > vblank_count * 1000000 / 60)
-				{
-					vblank_count++;
+				timer.wait();
 
-					if (vblank_handler)
-					{
-						intr_thread->cmd_list
-						({
-							{ ppu_cmd::set_args, 1 }, u64{1},
-							{ ppu_cmd::lle_call, vblank_handler },
-							{ ppu_cmd::sleep, 0 }
-						});
-
-						intr_thread->notify();
-					}
+				vblank_count++;
 
-					continue;
+				if (vblank_handler)
+				{
+					intr_thread->cmd_list
+					({
+						{ ppu_cmd::set_args, 1 }, u64{1},
+						{ ppu_cmd::lle_call, vblank_handler },
+						{ ppu_cmd::sleep, 0 }
+					});
+
+					intr_thread->notify();
 				}
-
-				std::this_thread::sleep_for(1ms); // hack
 			}
+
+			LOG_NOTICE(RSX, "VBlank timer: %s", timer.get_stats());
 		});
 
 		// TODO: exit condition
@@ -161,6 +161,7 @@ private:
 	s64 m_textures_upload_time = 0;
 	s64 m_draw_time = 0;
 	s64 m_flip_time = 0;
+	u64 m_protect_count = 0; // Host memory protection calls at the start of the frame
 
 	u32 m_used_descriptors = 0;
 	u8 m_draw_buffers_count = 0;
@@ -340,6 +340,8 @@ namespace vk
 
 		void purge_cache()
 		{
+			utils::memory_protect_batch batch;
+
 			for (auto &tex : m_cache)
 			{
 				if (tex.exists())
@@ -349,11 +351,13 @@ namespace vk
 				}
 
 				if (tex.is_locked())
-					tex.unprotect();
+					tex.unprotect(batch);
 
 				tex.release_dma_resources();
 			}
 
+			batch.apply();
+
 			m_temporary_image_view.clear();
 			m_dirty_textures.clear();
 
@@ -590,9 +594,11 @@ namespace vk
 
 			vk::leave_uninterruptible();
 
+			utils::memory_protect_batch batch;
+
 			region.reset(texaddr, range);
 			region.create(tex.width(), height, depth, tex.get_exact_mipmap_count(), view, image);
-			region.protect(utils::protection::ro);
+			region.protect(utils::protection::ro, batch);
 			region.set_dirty(false);
 
 			texture_cache_range = region.get_min_max(texture_cache_range);
@@ -602,7 +608,8 @@ namespace vk
 		void lock_memory_region(vk::render_target* image, const u32 memory_address, const u32 memory_size, const u32 width, const u32 height)
 		{
 			cached_texture_section& region = find_cached_texture(memory_address, memory_size, true, width, height, 1);
-			
+			utils::memory_protect_batch batch;
+
 			if (!region.is_locked())
 			{
 				region.reset(memory_address, memory_size);
@@ -610,7 +617,7 @@ namespace vk
 				texture_cache_range = region.get_min_max(texture_cache_range);
 			}
 
-			region.protect(utils::protection::no);
+			region.protect(utils::protection::no, batch);
 			region.create(width, height, 1, 1, nullptr, image, image->native_pitch, false);
 		}
 
@@ -691,6 +698,7 @@ namespace vk
 
 			bool response = false;
 			std::pair<u32, u32> trampled_range = std::make_pair(0xffffffff, 0x0);
+			utils::memory_protect_batch batch;
 
 			for (int i = 0; i < m_cache.size(); ++i)
 			{
@@ -712,7 +720,7 @@ namespace vk
 					}
 
 					tex.set_dirty(true);
-					tex.unprotect();
+					tex.unprotect(batch);
 
 					response = true;
 				}
@@ -91,6 +91,22 @@ namespace rsx
 			locked = false;
 		}
 
+		// Queue protection change (applied by the batch, before the cache lock is released)
+		void protect(utils::protection prot, utils::memory_protect_batch& batch)
+		{
+			if (prot == protection) return;
+
+			batch.protect(vm::base(locked_address_base), locked_address_range, prot);
+			protection = prot;
+			locked = prot != utils::protection::rw;
+		}
+
+		void unprotect(utils::memory_protect_batch& batch)
+		{
+			protect(utils::protection::rw, batch);
+			locked = false;
+		}
+
 		bool overlaps(std::pair<u32, u32> range)
 		{
 			return region_overlaps(locked_address_base, locked_address_base + locked_address_range, range.first, range.first + range.second);
@@ -7,7 +7,9 @@
 #include "Emu/Cell/PPUThread.h"
 #include "Emu/Cell/PPUCallback.h"
 #include "Emu/Cell/PPUOpcodes.h"
+#include "Emu/Cell/PPUProfiler.h"
 #include "Emu/Cell/SPUThread.h"
+#include "Emu/Cell/SPURecompiler.h"
 #include "Emu/Cell/RawSPUThread.h"
 #include "Emu/Cell/lv2/sys_sync.h"
 #include "Emu/PSP2/ARMv7Thread.h"
@@ -19,6 +21,7 @@
 #include "Loader/ELF.h"
 
 #include "Utilities/StrUtil.h"
+#include "Utilities/perf_jit.h"
 
 #include "../Crypto/unself.h"
 
@@ -166,6 +169,7 @@ void fmt_class_string<audio_renderer>::format(std::string& out, u64 arg)
 		case audio_renderer::alsa: return "ALSA";
 #endif
 		case audio_renderer::openal: return "OpenAL";
+		case audio_renderer::null_clocked: return "Null (Real Clock)";
 		}
 
 		return unknown;
@@ -332,6 +336,9 @@ void Emulator::Load()
 
 		LOG_NOTICE(LOADER, "Used configuration:\n%s\n", g_cfg.to_string());
 
+		// Must be set up before any code is compiled
+		utils::perf_jit_init(!!g_cfg.core.perf_map, !!g_cfg.core.jitdump);
+
 		// Load patches from different locations
 		fxm::check_unlocked<patch_engine>()->append(fs::get_config_dir() + "data/" + m_title_id + "/patch.yml");
 		fxm::check_unlocked<patch_engine>()->append(m_cache_path + "/patch.yml");
@@ -539,6 +546,11 @@ void Emulator::Run()
 	idm::select<ARMv7Thread>(on_select);
 	idm::select<RawSPUThread>(on_select);
 	idm::select<SPUThread>(on_select);
+
+	if (g_cfg.core.ppu_profiler)
+	{
+		ppu_profiler::start();
+	}
 }
 
 bool Emulator::Pause()
@@ -664,6 +676,15 @@ void Emulator::Stop()
 
 	LOG_NOTICE(GENERAL, "All threads stopped...");
 
+	const auto stats = thread_ctrl::get_stats();
+	LOG_NOTICE(GENERAL, "Threads started: %llu, finished: %llu; host threads created: %llu, exited: %llu", stats.started, stats.finished, stats.created, stats.exited);
+
+	const auto waits = adaptive_wait::get_total();
+	LOG_NOTICE(GENERAL, "Adaptive waits: %llu completed while spinning, %llu parked (spin success rate %.1f%%)", waits.spin_ok, waits.parked, waits.spin_ok * 100. / std::max<u64>(waits.spin_ok + waits.parked, 1));
+
+	ppu_profiler::stop();
+	spu_statistics::save();
+
 	lv2_obj::cleanup();
 	idm::clear();
 	fxm::clear();
@@ -37,6 +37,13 @@ enum class spu_decoder_type
 	llvm,
 };
 
+enum class thread_placement_policy
+{
+	disabled,
+	automatic,
+	manual,
+};
+
 enum class lib_loading_type
 {
 	automatic,
@@ -89,6 +96,7 @@ enum class audio_renderer
 	alsa,
 #endif
 	openal,
+	null_clocked,
 };
 
 enum class camera_handler
@@ -259,13 +267,24 @@ struct cfg_root : cfg::node
 		cfg::_enum<ppu_decoder_type> ppu_decoder{this, "PPU Decoder", ppu_decoder_type::fast};
 		cfg::_int<1, 16> ppu_threads{this, "PPU Threads", 2}; // Amount of PPU threads running simultaneously (must be 2)
 		cfg::_bool ppu_debug{this, "PPU Debug"};
+		cfg::_bool ppu_profiler{this, "PPU Profiler"}; // Start the sampling profiler with the emulation
+		cfg::_int<100, 1000000> ppu_profiler_interval{this, "PPU Profiler Interval", 1000}; // Sampling interval (us)
 		cfg::_bool llvm_logs{this, "Save LLVM logs"};
 		cfg::string llvm_cpu{this, "Use LLVM CPU"};
+		cfg::_bool perf_map{this, "Write perf map"}; // /tmp/perf-<pid>.map with JIT code symbols (Linux)
+		cfg::_bool jitdump{this, "Write jitdump"}; // /tmp/jit-<pid>.dump for perf inject --jit (Linux)
 
 		cfg::_enum<spu_decoder_type> spu_decoder{this, "SPU Decoder", spu_decoder_type::asmjit};
 		cfg::_bool bind_spu_cores{this, "Bind SPU threads to secondary cores"};
 		cfg::_bool lower_spu_priority{this, "Lower SPU thread priority"};
 		cfg::_bool spu_debug{this, "SPU Debug"};
+		cfg::_bool spu_stats{this, "SPU Statistics"}; // Count entries, loop iterations, channel stalls and DMA bytes per SPU function (ASMJIT only)
+
+		cfg::_enum<thread_placement_policy> thread_placement{this, "Thread Placement", thread_placement_policy::disabled};
+		cfg::string rsx_cpus{this, "RSX Thread CPUs"}; // Manual placement: logical processor lists (like "0-3,8"), empty: not pinned
+		cfg::string ppu_cpus{this, "PPU Thread CPUs"};
+		cfg::string spu_cpus{this, "SPU Thread CPUs"}; // SPU thread groups are kept within a single cache group of the list
+		cfg::string mfc_cpus{this, "MFC Thread CPUs"};
 
 		cfg::_enum<lib_loading_type> lib_loading{this, "Lib Loader", lib_loading_type::automatic};
 		cfg::_bool hook_functions{this, "Hook static functions"};
@@ -286,6 +305,8 @@ struct cfg_root : cfg::node
 		cfg::string app_home{this, "/app_home/"}; // Not mounted
 
 		cfg::_bool host_root{this, "Enable /host_root/"};
+		cfg::_bool mmap_game_data{this, "Memory-map read-only game data", true}; // /dev_bdvd/ and /app_home/ files opened for reading
+		cfg::_int<1, 16> aio_threads{this, "AIO worker threads", 2}; // Per mount point (cellFsAio)
 
 	} vfs{this};
 
@@ -312,6 +333,8 @@ struct cfg_root : cfg::node
 		cfg::_bool force_high_precision_z_buffer{this, "Force High Precision Z buffer"};
 		cfg::_bool invalidate_surface_cache_every_frame{this, "Invalidate Cache Every Frame", true};
 		cfg::_bool strict_rendering_mode{this, "Strict Rendering Mode"};
+		cfg::_int<0, 16> vdec_threads{this, "Video Decoder Threads", 0}; // cellVdec (0: auto)
+		cfg::_bool vdec_frame_threading{this, "Video Decoder Frame Threading", true};
 
 		struct node_d3d12 : cfg::node
 		{
@@ -340,6 +363,8 @@ struct cfg_root : cfg::node
 		cfg::_bool dump_to_file{this, "Dump to file"};
 		cfg::_bool convert_to_u16{this, "Convert to 16 bit"};
 		cfg::_bool downmix_to_2ch{this, "Downmix to Stereo", true};
+		cfg::_bool enable_buffering{this, "Enable Buffering", true};
+		cfg::_bool time_stretching{this, "Enable Time Stretching"};
 
 	} audio{this};
 	
@@ -186,6 +186,7 @@ void rpcs3_app::InitializeCallbacks()
 		case audio_renderer::alsa: return std::make_shared<ALSAThread>();
 #endif
 		case audio_renderer::openal: return std::make_shared<OpenALThread>();
+		case audio_renderer::null_clocked: return std::make_shared<NullClockedAudioThread>();
 		default: fmt::throw_exception("Invalid audio renderer: %s" HERE, type);
 		}
 	};
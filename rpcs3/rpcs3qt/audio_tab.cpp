@@ -21,6 +21,8 @@ audio_tab::audio_tab(std::shared_ptr<emu_settings> xemu_settings, QWidget *paren
 	QCheckBox *audioDump = xemu_settings->CreateEnhancedCheckBox(emu_settings::DumpToFile, this);
 	QCheckBox *conv = xemu_settings->CreateEnhancedCheckBox(emu_settings::ConvertTo16Bit, this);
 	QCheckBox *downmix = xemu_settings->CreateEnhancedCheckBox(emu_settings::DownmixStereo, this);
+	QCheckBox *buffering = xemu_settings->CreateEnhancedCheckBox(emu_settings::AudioBuffering, this);
+	QCheckBox *stretching = xemu_settings->CreateEnhancedCheckBox(emu_settings::TimeStretching, this);
 
 	// Main layout
 	QVBoxLayout *vbox = new QVBoxLayout;
@@ -28,6 +30,8 @@ audio_tab::audio_tab(std::shared_ptr<emu_settings> xemu_settings, QWidget *paren
 	vbox->addWidget(audioDump);
 	vbox->addWidget(conv);
 	vbox->addWidget(downmix);
+	vbox->addWidget(buffering);
+	vbox->addWidget(stretching);
 	vbox->addStretch();
 
 	QHBoxLayout *hbox = new QHBoxLayout;
@@ -33,6 +33,8 @@ debugger_frame::debugger_frame(QWidget *parent) : QDockWidget(tr("Debugger"), pa
 	m_btn_step = new QPushButton(tr("Step"), this);
 	m_btn_run = new QPushButton(tr("Run"), this);
 	m_btn_pause = new QPushButton(tr("Pause"), this);
+	m_btn_profiler = new QPushButton(tr("Start Profiler"), this);
+	m_btn_profiler->setToolTip(tr("Sample PPU threads, the profile is saved in the collapsed stack format when stopped"));
 
 	EnableButtons(!Emu.IsStopped());
 
@@ -41,6 +43,7 @@ debugger_frame::debugger_frame(QWidget *parent) : QDockWidget(tr("Debugger"), pa
 	hbox_b_main->addWidget(m_btn_step);
 	hbox_b_main->addWidget(m_btn_run);
 	hbox_b_main->addWidget(m_btn_pause);
+	hbox_b_main->addWidget(m_btn_profiler);
 	hbox_b_main->addWidget(m_choice_units);
 	hbox_b_main->addStretch();
 
@@ -86,6 +89,13 @@ debugger_frame::debugger_frame(QWidget *parent) : QDockWidget(tr("Debugger"), pa
 		if (const auto cpu = this->cpu.lock()) cpu->state += cpu_flag::dbg_pause;
 		UpdateUI();
 	});
+	connect(m_btn_profiler, &QAbstractButton::clicked, [=](){
+		if (ppu_profiler::is_active())
+			ppu_profiler::stop();
+		else
+			ppu_profiler::start();
+		UpdateUI();
+	});
 	connect(m_choice_units, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated), this, &debugger_frame::UpdateUI);
 	connect(m_choice_units, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &debugger_frame::OnSelectUnit);
 	connect(this, &QDockWidget::visibilityChanged, this, &debugger_frame::EnableUpdateTimer);
@@ -133,6 +143,8 @@ void debugger_frame::UpdateUI()
 {
 	UpdateUnitList();
 
+	m_btn_profiler->setText(ppu_profiler::is_active() ? tr("Stop Profiler") : tr("Start Profiler"));
+
 	if (m_noThreadSelected) return;
 
 	const auto cpu = this->cpu.lock();
@@ -408,6 +420,7 @@ void debugger_frame::EnableButtons(bool enable)
 	m_btn_step->setEnabled(enable);
 	m_btn_run->setEnabled(enable);
 	m_btn_pause->setEnabled(enable);
+	m_btn_profiler->setEnabled(enable);
 }
 
 debugger_list::debugger_list(debugger_frame* parent) : QListWidget(parent)
@@ -15,6 +15,7 @@
 #include "Emu/Cell/SPUDisAsm.h"
 #include "Emu/PSP2/ARMv7DisAsm.h"
 #include "Emu/Cell/PPUInterpreter.h"
+#include "Emu/Cell/PPUProfiler.h"
 
 #include "instruction_editor_dialog.h"
 #include "register_editor_dialog.h"
@@ -44,6 +45,7 @@ class debugger_frame : public QDockWidget
 	QPushButton* m_btn_step;
 	QPushButton* m_btn_run;
 	QPushButton* m_btn_pause;
+	QPushButton* m_btn_profiler;
 	QComboBox* m_choice_units;
 	QString m_current_choice;
 	bool m_noThreadSelected = true;
@@ -72,6 +72,8 @@ public:
 		DumpToFile,
 		ConvertTo16Bit,
 		DownmixStereo,
+		AudioBuffering,
+		TimeStretching,
 
 		// Input / Output
 		PadHandler,
@@ -164,6 +166,8 @@ private:
 		{ DumpToFile,		{ "Audio", "Dump to file"}},
 		{ ConvertTo16Bit,	{ "Audio", "Convert to 16 bit"}},
 		{ DownmixStereo,	{ "Audio", "Downmix to Stereo"}},
+		{ AudioBuffering,	{ "Audio", "Enable Buffering"}},
+		{ TimeStretching,	{ "Audio", "Enable Time Stretching"}},
 
 		// Input / Output
 		{ PadHandler,		{ "Input/Output", "Pad"}},
@@ -8,6 +8,7 @@
 #include <QProgressDialog>
 #include <QDesktopWidget>
 #include <QDesktopServices>
+#include <QPushButton>
 
 #include "vfs_dialog.h"
 #include "save_data_utility.h"
@@ -286,12 +287,24 @@ void main_window::InstallPkg()
 	// Get full path
 	const auto& local_path = Emu.GetGameDir() + std::string(std::begin(title_id), std::end(title_id));
 
+	// Continue partially extracted files instead of rewriting them
+	bool resume = false;
+
 	if (!fs::create_dir(local_path))
 	{
 		if (fs::is_dir(local_path))
 		{
-			if (QMessageBox::question(this, tr("PKG Decrypter / Installer"), tr("Another installation found. Do you want to overwrite it?"),	
-				QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
+			QMessageBox box(QMessageBox::Question, tr("PKG Decrypter / Installer"), tr("Another installation found. Do you want to overwrite it or resume an incomplete installation?"),
+				QMessageBox::Yes | QMessageBox::No, this);
+			QPushButton* resume_button = box.addButton(tr("Resume"), QMessageBox::AcceptRole);
+			box.setDefaultButton(QMessageBox::No);
+			box.exec();
+
+			if (box.clickedButton() == resume_button)
+			{
+				resume = true;
+			}
+			else if (box.standardButton(box.clickedButton()) != QMessageBox::Yes)
 			{
 				LOG_ERROR(LOADER, "PKG: Cancelled installation to existing directory %s", local_path);
 				return;
@@ -322,11 +335,12 @@ void main_window::InstallPkg()
 
 	// Synchronization variable
 	atomic_t<double> progress(0.);
+	pkg_install_stats stats;
 	{
 		// Run PKG unpacking asynchronously
 		scope_thread worker("PKG Installer", [&]
 		{
-			if (pkg_install(pkg_f, local_path + '/', progress))
+			if (pkg_install(pkg_f, local_path + '/', progress, &stats, resume))
 			{
 				progress = 1.;
 				return;
@@ -335,6 +349,10 @@ void main_window::InstallPkg()
 			// TODO: Ask user to delete files on cancellation/failure?
 			progress = -1.;
 		});
+		// Throughput measurement
+		auto speed_time = std::chrono::steady_clock::now();
+		u64 speed_bytes = 0;
+
 		// Wait for the completion
 		while (std::this_thread::sleep_for(5ms), std::abs(progress) < 1.)
 		{
@@ -357,6 +375,17 @@ void main_window::InstallPkg()
 			}
 			// Update progress window
 			pdlg.setValue(static_cast<int>(progress * pdlg.maximum()));
+
+			const auto now = std::chrono::steady_clock::now();
+
+			if (now - speed_time >= 1s)
+			{
+				const u64 bytes = stats.bytes_written;
+				const double rate = (bytes - speed_bytes) / std::chrono::duration<double>(now - speed_time).count();
+				pdlg.setLabelText(tr("Installing package ... please wait ... (%1 MB/s)").arg(rate / 1000000., 0, 'f', 1));
+				speed_time = now;
+				speed_bytes = bytes;
+			}
 #ifdef _WIN32
 			taskbar_progress->setValue(static_cast<int>(progress * taskbar_progress->maximum()));
 #endif